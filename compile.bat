@@ -8,7 +8,7 @@ set "FLAGS=%FLAGS% /std:c++17"
 set "FLAGS=%FLAGS% /W3"
 set "FLAGS=%FLAGS% /O2"
 
-set "SOURCE_FILES=./src/glad.c ./src/main.cpp ./src/logging.cpp ./src/shader_utils.cpp ./src/file_utils.cpp ./src/texture_utils.cpp"
+set "SOURCE_FILES=./src/glad.c ./src/main.cpp ./src/logging.cpp ./src/job_system.cpp ./src/frame_arena.cpp ./src/profiler.cpp ./src/shader_utils.cpp ./src/shader_cache.cpp ./src/shader_program.cpp ./src/shader_permutations.cpp ./src/shader_watcher.cpp ./src/file_utils.cpp ./src/texture_utils.cpp ./src/texture_loader.cpp ./src/texture_pack.cpp ./src/materials.cpp ./src/light_soa.cpp ./src/light_buffer.cpp ./src/light_culling.cpp ./src/cpu_lighting.cpp ./src/gbuffer.cpp ./src/sprite_batch.cpp ./src/quad_instances.cpp ./src/render_queue.cpp ./src/frame_pacer.cpp ./src/headless_context.cpp ./src/image_writer.cpp ./src/frame_recorder.cpp ./src/benchmarks.cpp"
 set "OUT_FILENAME=./game/bin/main.exe"
 
 set "LIB_TARGETS=shell32.lib SDL2.lib SDL2main.lib"
@@ -0,0 +1,27 @@
+#!/bin/sh
+# Copyright (c) 2024, Ivan Reshetnikov - All rights reserved.
+
+# Linux build with the headless EGL backend, for machines without a display or GPU (Mesa llvmpipe)
+# Needs g++, SDL2 and libEGL: apt install g++ libsdl2-dev libegl-dev libegl-mesa0
+# Run from `game/bin`: ./main --headless 1920x1080 --frames 600
+
+# Add -DENGINE_DEBUG_HEAP_CHECK to abort on steady state frames that allocate
+FLAGS="-std=c++17 -Wall -O2 -DENGINE_HEADLESS_EGL"
+
+# Same translation units as `compile.bat`
+SOURCE_FILES=$(sed -n 's/^set "SOURCE_FILES=\(.*\)"/\1/p' compile.bat | tr -d '\r')
+OUT_FILENAME=./game/bin/main
+
+LIB_TARGETS="$(sdl2-config --libs) -lEGL -lpthread -ldl"
+
+echo "[compile.sh] Cleaning up (shallow)"
+rm -f $OUT_FILENAME
+
+if g++ $FLAGS -I"./include" $SOURCE_FILES -o $OUT_FILENAME $LIB_TARGETS; then
+    echo
+    echo "[compile.sh] Compilation finished!"
+else
+    echo
+    echo "[compile.sh] Compilation failed!"
+    exit 1
+fi
@@ -0,0 +1,26 @@
+@echo off
+:: Copyright (c) 2024, Ivan Reshetnikov - All rights reserved.
+
+call lib_color.bat
+
+set "FLAGS="
+set "FLAGS=%FLAGS% /std:c++17"
+set "FLAGS=%FLAGS% /W3"
+set "FLAGS=%FLAGS% /O2"
+
+:: texture_cook.exe - run from `game/bin`: texture_cook.exe ../assets/textures ../assets/textures.pack
+set "SOURCE_FILES=./src/tools/texture_cook.cpp ./src/logging.cpp"
+set "OUT_FILENAME=./game/bin/texture_cook.exe"
+
+echo %COLOR_VIVID%[compile_tools.bat] Cleaning up (shallow)%COLOR_RESET%
+del %OUT_FILENAME%
+
+cl %FLAGS% /I"./include" %SOURCE_FILES% /Fo"./obj/" /EHsc /link /out:%OUT_FILENAME% /subsystem:console
+
+if %ERRORLEVEL% EQU 0 (
+    echo.
+    echo %COLOR_VIVID%[compile_tools.bat] %COLOR_FG_GREEN%Compilation finished!%COLOR_RESET%
+) else (
+    echo.
+    echo %COLOR_VIVID%[compile_tools.bat] %COLOR_FG_RED%Compilation failed!%COLOR_RESET%
+)
\ No newline at end of file
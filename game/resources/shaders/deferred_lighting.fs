@@ -0,0 +1,32 @@
+#version 330 core
+
+// Generated from the C++ constants, see `get_light_shader_header` in `light_buffer.cpp`
+#include "engine/lights.glsl"
+#include "point_lighting.glsl"
+
+out vec4 FragColor;
+
+uniform sampler2D u_gbuffer_albedo;
+uniform sampler2D u_gbuffer_surface;
+
+uniform vec3 u_ambient_light;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 albedo_value = texelFetch(u_gbuffer_albedo, pixel, 0);
+    vec4 surface_value = texelFetch(u_gbuffer_surface, pixel, 0);
+    if (albedo_value.a == 0.0) discard;  // Nothing was drawn here
+
+    vec2 normal_value = surface_value.xy * 2.0 - 1.0;
+    float ao_value = surface_value.z;
+
+    // Screen space is top-down, same as the orthographic projection of the geometry pass
+    vec2 screen_pos = vec2(gl_FragCoord.x, u_viewport_size.y - gl_FragCoord.y);
+    vec2 frag_pos = screen_pos + u_camera_pos;
+
+    vec3 light_value = add_point_lights(u_ambient_light, frag_pos, normal_value, ao_value);
+
+    // Final
+    FragColor = albedo_value * vec4(light_value, 1.0);
+}
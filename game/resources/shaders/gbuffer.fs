@@ -0,0 +1,22 @@
+#version 330 core
+
+in vec2 v_UV;
+in vec2 v_frag_pos;
+in float v_material_layer;
+in vec4 v_tint;
+
+// See `gbuffer.h` for the attachment layout
+layout (location = 0) out vec4 GBufferAlbedo;
+layout (location = 1) out vec4 GBufferSurface;
+
+// See `materials.h` for the layouts, the surface layout matches attachment 1
+uniform sampler2DArray u_albedo_array;
+uniform sampler2DArray u_surface_array;
+
+void main()
+{
+    vec3 material_UV = vec3(fract(v_UV), v_material_layer);
+
+    GBufferAlbedo = texture(u_albedo_array, material_UV) * v_tint;
+    GBufferSurface = texture(u_surface_array, material_UV);
+}
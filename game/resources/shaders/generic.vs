@@ -3,18 +3,37 @@
 layout (location = 0) in vec2 a_pos;
 layout (location = 1) in vec2 a_UV;
 
+// Per instance, mirrored by `QuadInstance` in `quad_instances.h`
+layout (location = 2) in vec2 a_instance_position;
+layout (location = 3) in vec2 a_instance_scale;
+layout (location = 4) in float a_instance_rotation;
+layout (location = 5) in float a_instance_material_layer;
+layout (location = 6) in vec4 a_instance_uv_rect;  // (min, max), may exceed 1 to tile the material
+layout (location = 7) in vec4 a_instance_tint;
+
 out vec2 v_UV;
 out vec2 v_frag_pos;
+out float v_material_layer;
+out vec4 v_tint;
 
-uniform mat4 u_model_matrix;
 uniform mat4 u_view_matrix;
 uniform mat4 u_projection_matrix;
 
 void main()
 {
-    v_UV = a_UV;
-    
-    v_frag_pos = (u_view_matrix * u_model_matrix * vec4(a_pos.x, a_pos.y, 0.0, 1.0)).xy;
+    v_UV = mix(a_instance_uv_rect.xy, a_instance_uv_rect.zw, a_UV);
+    v_material_layer = a_instance_material_layer;
+    v_tint = a_instance_tint;
+
+    // Model transform: scale, rotate around the center, translate
+    vec2 local_pos = (a_pos - 0.5) * a_instance_scale;
+    float rotation_cos = cos(a_instance_rotation);
+    float rotation_sin = sin(a_instance_rotation);
+    vec2 world_pos = a_instance_position + a_instance_scale * 0.5 + vec2(
+        local_pos.x * rotation_cos - local_pos.y * rotation_sin,
+        local_pos.x * rotation_sin + local_pos.y * rotation_cos);
+
+    v_frag_pos = (u_view_matrix * vec4(world_pos, 0.0, 1.0)).xy;
 
-    gl_Position = u_projection_matrix * u_view_matrix * u_model_matrix * vec4(a_pos.x, a_pos.y, 0.0, 1.0);
+    gl_Position = u_projection_matrix * u_view_matrix * vec4(world_pos, 0.0, 1.0);
 }
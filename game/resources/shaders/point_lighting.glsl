@@ -0,0 +1,85 @@
+// Tiled point lighting shared by `generic.fs` and `deferred_lighting.fs`, expects "engine/lights.glsl" first
+
+// Injected after `#version` by `shader_permutations.h`, these fallbacks are the unspecialised shader
+#ifndef POINT_LIGHT_BUCKET
+#define POINT_LIGHT_BUCKET MAX_POINT_LIGHT_COUNT
+#define ENABLE_LIGHT_MASK 0
+#define ENABLE_SPECULAR 1
+#define ENABLE_NORMAL_MAPPING 1
+#endif
+
+#if ENABLE_LIGHT_MASK
+uniform sampler2D u_light_mask;
+#endif
+
+// Sized to the bucket, the buffer behind it always holds `MAX_POINT_LIGHT_COUNT`
+#if POINT_LIGHT_BUCKET > 0
+layout (std140) uniform PointLightBlock {
+    int u_point_light_count;
+    PointLight u_point_lights[POINT_LIGHT_BUCKET];
+};
+#endif
+
+// Per-tile (offset, count) into `u_light_tile_indices`, see `light_culling.h`
+uniform usamplerBuffer u_light_tile_ranges;
+uniform usamplerBuffer u_light_tile_indices;
+uniform int u_light_tile_count_x;
+
+uniform vec2 u_camera_pos;
+uniform vec2 u_viewport_size;
+
+vec3 process_point_light(PointLight point_light, vec2 frag_pos, vec2 frag_normal, float ao_value)
+{
+    // Attenuation
+    float distance = length(frag_pos - point_light.position);
+    // https://wiki.ogre3d.org/tiki-index.php?page=-Point+Light+Attenuation
+    float attenuation = 1.0 / (1.0 + point_light.attenuation_linear * distance + point_light.attenuation_quadratic * (distance * distance));
+    // Fade to zero at `radius` so culled tiles do not show a seam
+    float radius_window = clamp(1.0 - pow(distance / point_light.radius, 4.0), 0.0, 1.0);
+    attenuation *= radius_window * radius_window;
+
+    // Normal map
+#if ENABLE_NORMAL_MAPPING
+    vec3 normal = vec3(frag_normal.xy, 1.0);
+#else
+    vec3 normal = vec3(0.0, 0.0, 1.0);
+#endif
+    vec3 light_dir = normalize(vec3(point_light.position, point_light.height) - vec3(frag_pos, 0.0));
+    float normal_difference = max(dot(normal, light_dir), 0.0);
+
+    // Light mask
+#if ENABLE_LIGHT_MASK
+    vec2 mask_UV = (frag_pos - point_light.position + 512.0) / 512.0 * 0.5;
+    if (mask_UV.x < 0.0 || mask_UV.x > 1.0 || mask_UV.y < 0.0 || mask_UV.y > 1.0) return vec3(0.0);
+    vec3 mask_value = texture(u_light_mask, mask_UV).rgb;
+#else
+    vec3 mask_value = vec3(1.0);
+#endif
+
+#if ENABLE_SPECULAR
+    vec3 view_dir = normalize(vec3(u_camera_pos.x + u_viewport_size.x * 0.5, u_camera_pos.y + u_viewport_size.y * 0.5, 128.0) - vec3(frag_pos, 0.0));
+    vec3 reflecttion_dir = reflect(-light_dir, normal);
+    float specular_factor = max(dot(view_dir, reflecttion_dir), 0.0);  // No `pow()` yet
+    vec3 specular_value = specular_factor * point_light.color;
+#else
+    vec3 specular_value = vec3(0.0);
+#endif
+
+    return (point_light.color + specular_value) * point_light.energy * ao_value * normal_difference * mask_value * attenuation;
+}
+
+// Adds the point lights binned into this fragment's tile to `light_value`, no tile holds more than the bucket
+vec3 add_point_lights(vec3 light_value, vec2 frag_pos, vec2 frag_normal, float ao_value)
+{
+#if POINT_LIGHT_BUCKET > 0
+    ivec2 tile = ivec2(gl_FragCoord.x, u_viewport_size.y - gl_FragCoord.y) / LIGHT_TILE_SIZE;
+    uvec2 tile_range = texelFetch(u_light_tile_ranges, tile.y * u_light_tile_count_x + tile.x).xy;
+
+    for (uint i = 0u; i < uint(POINT_LIGHT_BUCKET); i++) {
+        if (i >= tile_range.y) break;
+        int light_index = int(texelFetch(u_light_tile_indices, int(tile_range.x + i)).r);
+        light_value += process_point_light(u_point_lights[light_index], frag_pos, frag_normal, ao_value);
+    }
+#endif
+    return light_value;
+}
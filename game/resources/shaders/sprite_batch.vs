@@ -0,0 +1,25 @@
+#version 330 core
+
+// Mirrored by `SpriteVertex` in `sprite_batch.h`, positions are already in world space
+layout (location = 0) in vec2 a_pos;
+layout (location = 1) in vec2 a_UV;
+layout (location = 2) in float a_material_layer;
+
+out vec2 v_UV;
+out vec2 v_frag_pos;
+out float v_material_layer;
+out vec4 v_tint;
+
+uniform mat4 u_view_matrix;
+uniform mat4 u_projection_matrix;
+
+void main()
+{
+    v_UV = a_UV;
+    v_material_layer = a_material_layer;
+    v_tint = vec4(1.0);
+
+    v_frag_pos = (u_view_matrix * vec4(a_pos.x, a_pos.y, 0.0, 1.0)).xy;
+
+    gl_Position = u_projection_matrix * u_view_matrix * vec4(a_pos.x, a_pos.y, 0.0, 1.0);
+}
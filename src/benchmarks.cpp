@@ -0,0 +1,991 @@
+#include "benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+#include <SDL2/SDL.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "shader_program.h"
+#include "lights.h"
+#include "light_buffer.h"
+#include "light_culling.h"
+#include "light_soa.h"
+#include "shader_permutations.h"
+#include "gbuffer.h"
+#include "profiler.h"
+#include "cpu_lighting.h"
+#include "sprite_batch.h"
+#include "quad_instances.h"
+#include "file_utils.h"
+#include "job_system.h"
+#include "frame_arena.h"
+
+#define BENCHMARK_LIGHT_COUNT 32
+
+namespace Engine
+{
+    // Same uniform layout as `generic.fs` at the time the benchmark was written, kept inline so the benchmark
+    // keeps measuring the per-field path even when the real shaders move on
+    static const char* s_uniform_benchmark_vs = R"(#version 330 core
+layout (location = 0) in vec2 a_pos;
+uniform mat4 u_model_matrix;
+uniform mat4 u_view_matrix;
+uniform mat4 u_projection_matrix;
+void main() { gl_Position = u_projection_matrix * u_view_matrix * u_model_matrix * vec4(a_pos, 0.0, 1.0); }
+)";
+
+    static const char* s_uniform_benchmark_fs = R"(#version 330 core
+struct PointLight {
+    vec3 color;
+    vec2 position;
+    float energy;
+    float height;
+    float attenuation_linear;
+    float attenuation_quadratic;
+};
+out vec4 FragColor;
+uniform sampler2D u_diffuse_texture;
+uniform sampler2D u_normal_texture;
+uniform sampler2D u_ao_texture;
+uniform sampler2D u_roughness_texture;
+uniform sampler2D u_light_mask;
+uniform vec3 u_ambient_light;
+uniform PointLight[32] u_point_lights;
+uniform vec2 u_camera_pos;
+uniform vec2 u_viewport_size;
+void main()
+{
+    vec3 value = u_ambient_light + vec3(u_camera_pos, 0.0) + vec3(u_viewport_size, 0.0);
+    value += texture(u_diffuse_texture, vec2(0.0)).rgb + texture(u_normal_texture, vec2(0.0)).rgb;
+    value += texture(u_ao_texture, vec2(0.0)).rgb + texture(u_roughness_texture, vec2(0.0)).rgb + texture(u_light_mask, vec2(0.0)).rgb;
+    for (int i = 0; i < 32; i++) {
+        PointLight l = u_point_lights[i];
+        value += l.color * l.energy + vec3(l.position, l.height) * (l.attenuation_linear + l.attenuation_quadratic);
+    }
+    FragColor = vec4(value, 1.0);
+}
+)";
+
+    // Flat shaded, so the benchmark measures submission and vertex streaming rather than lighting
+    static const char* s_sprite_benchmark_vs = R"(#version 330 core
+layout (location = 0) in vec2 a_pos;
+layout (location = 1) in vec2 a_UV;
+layout (location = 2) in float a_material_layer;
+out vec3 v_color;
+uniform mat4 u_projection_matrix;
+void main() { v_color = vec3(a_UV, a_material_layer / 8.0); gl_Position = u_projection_matrix * vec4(a_pos, 0.0, 1.0); }
+)";
+
+    static const char* s_sprite_benchmark_fs = R"(#version 330 core
+in vec3 v_color;
+out vec4 FragColor;
+uniform vec3 u_tint;
+void main() { FragColor = vec4(v_color * u_tint, 1.0); }
+)";
+
+    // The pre-instancing `generic.vs`, one draw per quad with its transform in uniforms
+    static const char* s_per_draw_benchmark_vs = R"(#version 330 core
+layout (location = 0) in vec2 a_pos;
+layout (location = 1) in vec2 a_UV;
+out vec2 v_UV;
+out float v_material_layer;
+out vec4 v_tint;
+uniform mat4 u_model_matrix;
+uniform mat4 u_projection_matrix;
+uniform vec4 u_uv_rect;
+uniform float u_material_layer;
+uniform vec4 u_tint;
+void main() {
+    v_UV = mix(u_uv_rect.xy, u_uv_rect.zw, a_UV);
+    v_material_layer = u_material_layer;
+    v_tint = u_tint;
+    gl_Position = u_projection_matrix * u_model_matrix * vec4(a_pos, 0.0, 1.0);
+}
+)";
+
+    static const char* s_instancing_benchmark_fs = R"(#version 330 core
+in vec2 v_UV;
+in float v_material_layer;
+in vec4 v_tint;
+out vec4 FragColor;
+void main() { FragColor = vec4(fract(v_UV), v_material_layer / 8.0, 1.0) * v_tint; }
+)";
+
+    // Uniform handles of a single `PointLight` element of a uniform array, the per-field path the light block replaced
+    struct PointLightUniforms {
+        UniformHandle color = INVALID_UNIFORM_HANDLE;
+        UniformHandle position = INVALID_UNIFORM_HANDLE;
+        UniformHandle energy = INVALID_UNIFORM_HANDLE;
+        UniformHandle height = INVALID_UNIFORM_HANDLE;
+        UniformHandle attenuation_linear = INVALID_UNIFORM_HANDLE;
+        UniformHandle attenuation_quadratic = INVALID_UNIFORM_HANDLE;
+    };
+
+    static PointLightUniforms get_point_light_uniforms(const ShaderProgram& program, const std::string& array_name, uintmax_t index)
+    {
+        const std::string uniform_prefix = array_name + "[" + std::to_string(index) + "]";
+
+        PointLightUniforms uniforms;
+        uniforms.color = get_uniform_handle(program, uniform_prefix + ".color");
+        uniforms.position = get_uniform_handle(program, uniform_prefix + ".position");
+        uniforms.energy = get_uniform_handle(program, uniform_prefix + ".energy");
+        uniforms.height = get_uniform_handle(program, uniform_prefix + ".height");
+        uniforms.attenuation_linear = get_uniform_handle(program, uniform_prefix + ".attenuation_linear");
+        uniforms.attenuation_quadratic = get_uniform_handle(program, uniform_prefix + ".attenuation_quadratic");
+
+        return uniforms;
+    }
+
+    static void set_point_light_uniforms(ShaderProgram& program, const PointLightUniforms& uniforms, const PointLight& point_light)
+    {
+        set_uniform(program, uniforms.color, point_light.color);
+        set_uniform(program, uniforms.position, point_light.position);
+        set_uniform(program, uniforms.energy, point_light.energy);
+        set_uniform(program, uniforms.height, point_light.height);
+        set_uniform(program, uniforms.attenuation_linear, point_light.attenuation.linear);
+        set_uniform(program, uniforms.attenuation_quadratic, point_light.attenuation.quadratic);
+    }
+
+    static double get_elapsed_ms(uint64_t start_counter)
+    {
+        return (double)(SDL_GetPerformanceCounter() - start_counter) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+    }
+
+    static void animate_benchmark_lights(std::vector<PointLight>& point_lights, uintmax_t frame)
+    {
+        for (uintmax_t i = 0; i < point_lights.size(); i++) {
+            point_lights[i].energy = (float)(sin((double)(frame + i * 7) * 0.05) + 2.0) * 0.5f;
+        }
+    }
+
+    void run_uniform_benchmark(uintmax_t frame_count)
+    {
+        log_info("[BENCH] Uniform setup, " + std::to_string(frame_count) + " frames, " + std::to_string(BENCHMARK_LIGHT_COUNT) + " point lights");
+
+        ShaderProgram program = create_shader_program(s_uniform_benchmark_vs, s_uniform_benchmark_fs);
+        glUseProgram(program.id);
+
+        std::vector<PointLight> point_lights(BENCHMARK_LIGHT_COUNT);
+        for (uintmax_t i = 0; i < point_lights.size(); i++) {
+            point_lights[i].position = glm::vec2((float)i * 60.0f, 256.0f);
+        }
+
+        glm::mat4 model_matrix(1.0f);
+        glm::mat4 view_matrix(1.0f);
+        glm::mat4 projection_matrix(1.0f);
+
+        // Before: string building and `glGetUniformLocation` for every uniform, every frame
+        glFinish();
+        uint64_t start_counter = SDL_GetPerformanceCounter();
+        for (uintmax_t frame = 0; frame < frame_count; frame++) {
+            animate_benchmark_lights(point_lights, frame);
+
+            glUniformMatrix4fv(glGetUniformLocation(program.id, "u_model_matrix"), 1, GL_FALSE, &model_matrix[0][0]);
+            glUniformMatrix4fv(glGetUniformLocation(program.id, "u_view_matrix"), 1, GL_FALSE, &view_matrix[0][0]);
+            glUniformMatrix4fv(glGetUniformLocation(program.id, "u_projection_matrix"), 1, GL_FALSE, &projection_matrix[0][0]);
+            glUniform1i(glGetUniformLocation(program.id, "u_diffuse_texture"), 0);
+            glUniform1i(glGetUniformLocation(program.id, "u_normal_texture"), 1);
+            glUniform1i(glGetUniformLocation(program.id, "u_ao_texture"), 2);
+            glUniform1i(glGetUniformLocation(program.id, "u_roughness_texture"), 3);
+            glUniform1i(glGetUniformLocation(program.id, "u_light_mask"), 4);
+            glUniform3fv(glGetUniformLocation(program.id, "u_ambient_light"), 1, &glm::vec3(0.0f)[0]);
+
+            int i = 0;
+            for (PointLight& point_light : point_lights) {
+                const std::string uniform_prefix = "u_point_lights[" + std::to_string(i) + "]";
+                glUniform3fv(glGetUniformLocation(program.id, (uniform_prefix + ".color").c_str()), 1, &point_light.color[0]);
+                glUniform2fv(glGetUniformLocation(program.id, (uniform_prefix + ".position").c_str()), 1, &point_light.position[0]);
+                glUniform1f(glGetUniformLocation(program.id, (uniform_prefix + ".energy").c_str()), point_light.energy);
+                glUniform1f(glGetUniformLocation(program.id, (uniform_prefix + ".height").c_str()), point_light.height);
+                glUniform1f(glGetUniformLocation(program.id, (uniform_prefix + ".attenuation_linear").c_str()), point_light.attenuation.linear);
+                glUniform1f(glGetUniformLocation(program.id, (uniform_prefix + ".attenuation_quadratic").c_str()), point_light.attenuation.quadratic);
+                i++;
+            }
+
+            glUniform2fv(glGetUniformLocation(program.id, "u_camera_pos"), 1, &glm::vec2(0.0f)[0]);
+            glUniform2fv(glGetUniformLocation(program.id, "u_viewport_size"), 1, &glm::vec2(1920.0f, 1080.0f)[0]);
+        }
+        glFinish();
+        double legacy_ms = get_elapsed_ms(start_counter);
+
+        // After: handles resolved once, redundant uploads skipped
+        UniformHandle model_matrix_handle = get_uniform_handle(program, "u_model_matrix");
+        UniformHandle view_matrix_handle = get_uniform_handle(program, "u_view_matrix");
+        UniformHandle projection_matrix_handle = get_uniform_handle(program, "u_projection_matrix");
+        UniformHandle texture_handles[5] = {
+            get_uniform_handle(program, "u_diffuse_texture"),
+            get_uniform_handle(program, "u_normal_texture"),
+            get_uniform_handle(program, "u_ao_texture"),
+            get_uniform_handle(program, "u_roughness_texture"),
+            get_uniform_handle(program, "u_light_mask"),
+        };
+        UniformHandle ambient_light_handle = get_uniform_handle(program, "u_ambient_light");
+        UniformHandle camera_pos_handle = get_uniform_handle(program, "u_camera_pos");
+        UniformHandle viewport_size_handle = get_uniform_handle(program, "u_viewport_size");
+
+        std::vector<PointLightUniforms> light_handles(BENCHMARK_LIGHT_COUNT);
+        for (uintmax_t i = 0; i < light_handles.size(); i++) {
+            light_handles[i] = get_point_light_uniforms(program, "u_point_lights", i);
+        }
+
+        glFinish();
+        start_counter = SDL_GetPerformanceCounter();
+        for (uintmax_t frame = 0; frame < frame_count; frame++) {
+            animate_benchmark_lights(point_lights, frame);
+
+            set_uniform(program, model_matrix_handle, model_matrix);
+            set_uniform(program, view_matrix_handle, view_matrix);
+            set_uniform(program, projection_matrix_handle, projection_matrix);
+            for (GLint unit = 0; unit < 5; unit++) set_uniform(program, texture_handles[unit], unit);
+            set_uniform(program, ambient_light_handle, glm::vec3(0.0f));
+
+            for (uintmax_t i = 0; i < point_lights.size(); i++) {
+                set_point_light_uniforms(program, light_handles[i], point_lights[i]);
+            }
+
+            set_uniform(program, camera_pos_handle, glm::vec2(0.0f));
+            set_uniform(program, viewport_size_handle, glm::vec2(1920.0f, 1080.0f));
+        }
+        glFinish();
+        double cached_ms = get_elapsed_ms(start_counter);
+
+        // Lights through a single uniform buffer upload, the rest through cached handles
+        PointLightBuffer point_light_buffer;
+        create_point_light_buffer(point_light_buffer);
+
+        glFinish();
+        start_counter = SDL_GetPerformanceCounter();
+        for (uintmax_t frame = 0; frame < frame_count; frame++) {
+            animate_benchmark_lights(point_lights, frame);
+
+            set_uniform(program, model_matrix_handle, model_matrix);
+            set_uniform(program, view_matrix_handle, view_matrix);
+            set_uniform(program, projection_matrix_handle, projection_matrix);
+            for (GLint unit = 0; unit < 5; unit++) set_uniform(program, texture_handles[unit], unit);
+            set_uniform(program, ambient_light_handle, glm::vec3(0.0f));
+
+            upload_point_lights(point_light_buffer, point_lights);
+
+            set_uniform(program, camera_pos_handle, glm::vec2(0.0f));
+            set_uniform(program, viewport_size_handle, glm::vec2(1920.0f, 1080.0f));
+        }
+        glFinish();
+        double uniform_buffer_ms = get_elapsed_ms(start_counter);
+
+        destroy_point_light_buffer(point_light_buffer);
+
+        log_info("[BENCH] Per-field lookup:  " + std::to_string(legacy_ms * 1000.0 / (double)frame_count) + " us/frame");
+        log_info("[BENCH] Cached handles:    " + std::to_string(cached_ms * 1000.0 / (double)frame_count) + " us/frame");
+        log_info("[BENCH] Uniform buffer:    " + std::to_string(uniform_buffer_ms * 1000.0 / (double)frame_count) + " us/frame");
+        log_info("[BENCH] Speedup (cached):  " + std::to_string(legacy_ms / cached_ms) + "x");
+        log_info("[BENCH] Speedup (buffer):  " + std::to_string(legacy_ms / uniform_buffer_ms) + "x");
+
+        destroy_shader_program(program);
+    }
+
+    void run_light_culling_benchmark()
+    {
+        const uintmax_t viewport_size_x = 1920;
+        const uintmax_t viewport_size_y = 1080;
+        const uintmax_t iteration_count = 100;
+        const uintmax_t hardware_thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+        log_info("[BENCH] Light culling, " + std::to_string(viewport_size_x) + "x" + std::to_string(viewport_size_y) + ", " + std::to_string(LIGHT_TILE_SIZE) + "px tiles, " + std::to_string(iteration_count) + " iterations");
+
+        std::mt19937 random(1337);
+        std::uniform_real_distribution<float> random_x(0.0f, (float)viewport_size_x);
+        std::uniform_real_distribution<float> random_y(0.0f, (float)viewport_size_y);
+        std::uniform_real_distribution<float> random_radius(32.0f, 256.0f);
+
+        std::vector<uintmax_t> thread_counts = { 1 };
+        if (hardware_thread_count > 1) thread_counts.push_back(hardware_thread_count);
+
+        LightTileGrid grid;
+        FrameArena arena;
+        create_frame_arena(arena, 16 * 1024 * 1024);
+        for (uintmax_t light_count = 32; light_count <= 4096; light_count *= 2) {
+            std::vector<PointLight> point_lights(light_count);
+            for (PointLight& point_light : point_lights) {
+                point_light.position = glm::vec2(random_x(random), random_y(random));
+                point_light.radius = random_radius(random);
+            }
+
+            for (uintmax_t thread_count : thread_counts) {
+                JobSystem jobs;
+                start_job_system(jobs, thread_count);
+
+                auto start = std::chrono::steady_clock::now();
+                for (uintmax_t iteration = 0; iteration < iteration_count; iteration++) {
+                    reset_frame_arena(arena);
+                    bin_point_lights(grid, point_lights.data(), light_count, glm::vec2(0.0f), viewport_size_x, viewport_size_y, jobs, arena);
+                }
+                double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                stop_job_system(jobs);
+
+                uintmax_t tile_count = grid.tile_count_x * grid.tile_count_y;
+                uint32_t max_tile_light_count = 0;
+                for (uintmax_t tile = 0; tile < tile_count; tile++) max_tile_light_count = std::max(max_tile_light_count, grid.tile_ranges[tile * 2 + 1]);
+
+                log_info("[BENCH] " + std::to_string(light_count) + " lights, " + std::to_string(thread_count) + " threads: " +
+                    std::to_string(elapsed_ms / (double)iteration_count) + " ms/frame, " +
+                    std::to_string((double)grid.light_indices.size() / (double)tile_count) + " avg lights/tile, " +
+                    std::to_string(max_tile_light_count) + " max lights/tile (vs " + std::to_string(light_count) + " unculled)");
+            }
+        }
+        destroy_frame_arena(arena);
+    }
+
+    void run_sprite_batch_benchmark(uintmax_t sprite_count, uintmax_t frame_count)
+    {
+        const float viewport_size_x = 1920.0f;
+        const float viewport_size_y = 1080.0f;
+
+        log_info("[BENCH] Sprite batch, " + std::to_string(sprite_count) + " sprites, " + std::to_string(frame_count) + " frames");
+
+        // Two programs and eight material layers so sorting and run splitting are part of the measurement
+        ShaderProgram programs[2] = {
+            create_shader_program(s_sprite_benchmark_vs, s_sprite_benchmark_fs),
+            create_shader_program(s_sprite_benchmark_vs, s_sprite_benchmark_fs),
+        };
+        glm::mat4 projection_matrix = glm::ortho(0.0f, viewport_size_x, viewport_size_y, 0.0f, -128.0f, 128.0f);
+        for (uintmax_t i = 0; i < 2; i++) {
+            glUseProgram(programs[i].id);
+            set_uniform(programs[i], get_uniform_handle(programs[i], "u_projection_matrix"), projection_matrix);
+            set_uniform(programs[i], get_uniform_handle(programs[i], "u_tint"), i == 0 ? glm::vec3(1.0f) : glm::vec3(1.0f, 0.5f, 0.5f));
+        }
+
+        std::mt19937 random(1337);
+        std::uniform_real_distribution<float> random_x(0.0f, viewport_size_x);
+        std::uniform_real_distribution<float> random_y(0.0f, viewport_size_y);
+        std::uniform_int_distribution<int> random_layer(0, 7);
+
+        std::vector<Sprite> sprites(sprite_count);
+        std::vector<GLuint> sprite_programs(sprite_count);
+        for (uintmax_t i = 0; i < sprite_count; i++) {
+            sprites[i].position = glm::vec2(random_x(random), random_y(random));
+            sprites[i].size = glm::vec2(16.0f);
+            sprites[i].material_layer = (float)random_layer(random);
+            sprite_programs[i] = programs[random_layer(random) % 2].id;
+        }
+
+        JobSystem jobs;
+        start_job_system(jobs, 0);
+
+        SpriteBatch batch;
+        create_sprite_batch(batch, sprite_count);
+
+        double submit_ms = 0.0;
+        uintmax_t draw_call_count = 0;
+
+        glFinish();
+        uint64_t start_counter = SDL_GetPerformanceCounter();
+        for (uintmax_t frame = 0; frame < frame_count; frame++) {
+            uint64_t submit_start_counter = SDL_GetPerformanceCounter();
+            begin_sprite_batch(batch);
+            for (uintmax_t i = 0; i < sprite_count; i++) {
+                sprites[i].rotation = (float)frame * 0.01f + (float)i;
+                submit_sprite(batch, sprites[i], sprite_programs[i]);
+            }
+            submit_ms += get_elapsed_ms(submit_start_counter);
+
+            for (const SpriteDrawRun& run : flush_sprite_batch(batch, jobs)) {
+                glUseProgram(run.program);
+                draw_sprite_run(batch, run);
+                draw_call_count++;
+            }
+            end_sprite_batch(batch);
+            glFlush();
+        }
+        glFinish();
+        double total_ms = get_elapsed_ms(start_counter);
+
+        destroy_sprite_batch(batch);
+        for (ShaderProgram& program : programs) destroy_shader_program(program);
+        stop_job_system(jobs);
+
+        double total_sprite_count = (double)(sprite_count * frame_count);
+        log_info("[BENCH] Submitted: " + std::to_string(total_sprite_count / (submit_ms / 1000.0) / 1000000.0) + " M sprites/s");
+        log_info("[BENCH] Drawn:     " + std::to_string(total_sprite_count / (total_ms / 1000.0) / 1000000.0) + " M sprites/s (submit, sort, stream and GPU)");
+        log_info("[BENCH] Frame:     " + std::to_string(total_ms / (double)frame_count) + " ms, " + std::to_string((double)draw_call_count / (double)frame_count) + " draw calls");
+    }
+
+    void run_instancing_benchmark(uintmax_t sprite_count, uintmax_t frame_count)
+    {
+        const float viewport_size_x = 1920.0f;
+        const float viewport_size_y = 1080.0f;
+
+        log_info("[BENCH] Quad instancing, " + std::to_string(sprite_count) + " quads, " + std::to_string(frame_count) + " frames");
+
+        // The instanced path runs the real `generic.vs`, the per-draw path its uniform based predecessor
+        ShaderProgram per_draw_program = create_shader_program(s_per_draw_benchmark_vs, s_instancing_benchmark_fs);
+        ShaderProgram instanced_program = create_shader_program(read_text_file("../resources/shaders/generic.vs").c_str(), s_instancing_benchmark_fs);
+
+        glm::mat4 projection_matrix = glm::ortho(0.0f, viewport_size_x, viewport_size_y, 0.0f, -128.0f, 128.0f);
+
+        UniformHandle model_matrix_handle = get_uniform_handle(per_draw_program, "u_model_matrix");
+        UniformHandle uv_rect_handle = get_uniform_handle(per_draw_program, "u_uv_rect");
+        UniformHandle material_layer_handle = get_uniform_handle(per_draw_program, "u_material_layer");
+        UniformHandle tint_handle = get_uniform_handle(per_draw_program, "u_tint");
+        glUseProgram(per_draw_program.id);
+        set_uniform(per_draw_program, get_uniform_handle(per_draw_program, "u_projection_matrix"), projection_matrix);
+
+        glUseProgram(instanced_program.id);
+        set_uniform(instanced_program, get_uniform_handle(instanced_program, "u_view_matrix"), glm::mat4(1.0f));
+        set_uniform(instanced_program, get_uniform_handle(instanced_program, "u_projection_matrix"), projection_matrix);
+
+        std::mt19937 random(1337);
+        std::uniform_real_distribution<float> random_x(0.0f, viewport_size_x);
+        std::uniform_real_distribution<float> random_y(0.0f, viewport_size_y);
+        std::uniform_int_distribution<int> random_layer(0, 7);
+        std::uniform_real_distribution<float> random_tint(0.5f, 1.0f);
+
+        std::vector<Sprite> sprites(sprite_count);
+        std::vector<glm::vec4> tints(sprite_count);
+        for (uintmax_t i = 0; i < sprite_count; i++) {
+            sprites[i].position = glm::vec2(random_x(random), random_y(random));
+            sprites[i].size = glm::vec2(16.0f);
+            sprites[i].material_layer = (float)random_layer(random);
+            tints[i] = glm::vec4(random_tint(random), random_tint(random), random_tint(random), 1.0f);
+        }
+
+        QuadInstances quads;
+        create_quad_instances(quads, sprite_count);
+
+        // Per-draw uniforms: model matrix, UV rect, layer and tint per quad
+        glUseProgram(per_draw_program.id);
+        glBindVertexArray(quads.VAO);
+        glFinish();
+        uint64_t start_counter = SDL_GetPerformanceCounter();
+        for (uintmax_t frame = 0; frame < frame_count; frame++) {
+            for (uintmax_t i = 0; i < sprite_count; i++) {
+                const Sprite& sprite = sprites[i];
+                float rotation = (float)frame * 0.01f + (float)i;
+
+                glm::mat4 model_matrix(1.0f);
+                model_matrix = glm::translate(model_matrix, glm::vec3(sprite.position + sprite.size * 0.5f, 0.0f));
+                model_matrix = glm::rotate(model_matrix, rotation, glm::vec3(0.0f, 0.0f, 1.0f));
+                model_matrix = glm::scale(model_matrix, glm::vec3(sprite.size, 1.0f));
+                model_matrix = glm::translate(model_matrix, glm::vec3(-0.5f, -0.5f, 0.0f));
+
+                set_uniform(per_draw_program, model_matrix_handle, model_matrix);
+                set_uniform(per_draw_program, uv_rect_handle, sprite.uv_rect);
+                set_uniform(per_draw_program, material_layer_handle, sprite.material_layer);
+                set_uniform(per_draw_program, tint_handle, tints[i]);
+                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            }
+            glFlush();
+        }
+        glFinish();
+        double per_draw_ms = get_elapsed_ms(start_counter);
+
+        // Instanced: one record per quad, one draw
+        glUseProgram(instanced_program.id);
+        glFinish();
+        start_counter = SDL_GetPerformanceCounter();
+        for (uintmax_t frame = 0; frame < frame_count; frame++) {
+            clear_quad_instances(quads);
+            for (uintmax_t i = 0; i < sprite_count; i++) {
+                sprites[i].rotation = (float)frame * 0.01f + (float)i;
+                add_quad_instance(quads, sprites[i], tints[i]);
+            }
+            upload_quad_instances(quads);
+            draw_quad_instances(quads);
+            glFlush();
+        }
+        glFinish();
+        double instanced_ms = get_elapsed_ms(start_counter);
+
+        destroy_quad_instances(quads);
+        destroy_shader_program(per_draw_program);
+        destroy_shader_program(instanced_program);
+
+        uintmax_t per_draw_bytes = sizeof(glm::mat4) + sizeof(glm::vec4) + sizeof(float) + sizeof(glm::vec4);
+        double total_sprite_count = (double)(sprite_count * frame_count);
+        log_info("[BENCH] Per-draw uniforms: " + std::to_string(per_draw_ms / (double)frame_count) + " ms/frame, " +
+            std::to_string(total_sprite_count / (per_draw_ms / 1000.0) / 1000000.0) + " M quads/s, " + std::to_string(per_draw_bytes) + " bytes/quad");
+        log_info("[BENCH] Instanced:         " + std::to_string(instanced_ms / (double)frame_count) + " ms/frame, " +
+            std::to_string(total_sprite_count / (instanced_ms / 1000.0) / 1000000.0) + " M quads/s, " + std::to_string(sizeof(QuadInstance)) + " bytes/quad");
+        log_info("[BENCH] CPU expansion (--bench sprites) streams " + std::to_string(4 * sizeof(SpriteVertex)) + " bytes/quad");
+        log_info("[BENCH] Speedup:           " + std::to_string(per_draw_ms / instanced_ms) + "x");
+    }
+
+    // Fills `point_lights` with lights of one radius spread evenly over `spread` times the viewport in each direction
+    static void place_density_benchmark_lights(std::vector<PointLight>& point_lights, uintmax_t light_count, float spread, float viewport_size_x, float viewport_size_y, std::mt19937& random)
+    {
+        std::uniform_real_distribution<float> random_x(0.0f, viewport_size_x * spread);
+        std::uniform_real_distribution<float> random_y(0.0f, viewport_size_y * spread);
+
+        point_lights.assign(light_count, PointLight());
+        for (PointLight& point_light : point_lights) {
+            point_light.position = glm::vec2(random_x(random), random_y(random));
+            point_light.radius = 96.0f;
+        }
+    }
+
+    void run_light_density_benchmark(uintmax_t frame_count, const std::string& trace_path)
+    {
+        const uintmax_t on_screen_light_count = 16;  // At fixed density, the lights the viewport holds at every total
+
+        GLint viewport[4] = {};
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLint target_framebuffer = 0;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target_framebuffer);
+        uintmax_t viewport_size_x = (uintmax_t)viewport[2];
+        uintmax_t viewport_size_y = (uintmax_t)viewport[3];
+
+        log_info("[BENCH] Deferred lighting pass, " + std::to_string(viewport_size_x) + "x" + std::to_string(viewport_size_y) + ", " + std::to_string(frame_count) +
+            " frames per light count, GPU time from profiler zones");
+
+        // The real lighting shader, with the largest bucket at every light count so only the light data changes
+        ShaderPreprocessor preprocessor;
+        add_generated_shader_file(preprocessor, "engine/lights.glsl", get_light_shader_header());
+        ShaderPermutations permutations;
+        create_shader_permutations(permutations, "deferred lighting", "../resources/shaders/deferred_lighting.vs", "../resources/shaders/deferred_lighting.fs", {}, preprocessor, nullptr);
+        ShaderVariant& variant = get_shader_variant(permutations, MAX_POINT_LIGHT_COUNT, DEFAULT_SHADER_FEATURES);
+        ShaderProgram& program = variant.program;
+
+        // Every pixel covered by a flat surface, so every pixel runs its tile's lights
+        GBuffer gbuffer;
+        if (!create_gbuffer(gbuffer, viewport_size_x, viewport_size_y)) {
+            destroy_shader_permutations(permutations);
+            return;
+        }
+        const float albedo_value[4] = { 0.5f, 0.5f, 0.5f, 1.0f };
+        const float surface_value[4] = { 0.5f, 0.5f, 1.0f, 0.0f };
+        glBindFramebuffer(GL_FRAMEBUFFER, gbuffer.framebuffer);
+        glClearBufferfv(GL_COLOR, 0, albedo_value);
+        glClearBufferfv(GL_COLOR, 1, surface_value);
+        glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)target_framebuffer);
+
+        PointLightBuffer point_light_buffer;
+        create_point_light_buffer(point_light_buffer);
+        LightTileBuffers light_tile_buffers;
+        create_light_tile_buffers(light_tile_buffers);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, gbuffer.albedo_texture);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, gbuffer.surface_texture);
+        glActiveTexture(GL_TEXTURE5);
+        glBindTexture(GL_TEXTURE_BUFFER, light_tile_buffers.tile_range_texture);
+        glActiveTexture(GL_TEXTURE6);
+        glBindTexture(GL_TEXTURE_BUFFER, light_tile_buffers.light_index_texture);
+        glActiveTexture(GL_TEXTURE0);
+
+        glUseProgram(program.id);
+        set_uniform(program, get_uniform_handle(program, "u_gbuffer_albedo"), 0);
+        set_uniform(program, get_uniform_handle(program, "u_gbuffer_surface"), 1);
+        set_uniform(program, get_uniform_handle(program, "u_light_tile_ranges"), 5);
+        set_uniform(program, get_uniform_handle(program, "u_light_tile_indices"), 6);
+        set_uniform(program, get_uniform_handle(program, "u_ambient_light"), glm::vec3(0.0f));
+        set_uniform(program, get_uniform_handle(program, "u_camera_pos"), glm::vec2(0.0f));
+        set_uniform(program, get_uniform_handle(program, "u_viewport_size"), glm::vec2((float)viewport_size_x, (float)viewport_size_y));
+        UniformHandle tile_count_x_handle = get_uniform_handle(program, "u_light_tile_count_x");
+
+        GLuint empty_VAO;
+        glGenVertexArrays(1, &empty_VAO);
+        glBindVertexArray(empty_VAO);
+
+        JobSystem jobs;
+        start_job_system(jobs, 1);
+        FrameArena arena;
+        create_frame_arena(arena, 16 * 1024 * 1024);
+        LightTileGrid grid;
+        std::vector<PointLight> point_lights;
+        std::mt19937 random(1337);
+
+        // Fixed density spreads the lights over an area growing with their count, the viewport keeps seeing about the
+        // same lights per tile. Every light on screen is the density growing with the count, for comparison
+        start_profiler(get_job_thread_count(jobs));
+        for (bool fixed_density : { true, false }) {
+            for (uintmax_t light_count = on_screen_light_count; light_count <= MAX_POINT_LIGHT_COUNT; light_count *= 2) {
+                float spread = fixed_density ? std::sqrt((float)light_count / (float)on_screen_light_count) : 1.0f;
+                place_density_benchmark_lights(point_lights, light_count, spread, (float)viewport_size_x, (float)viewport_size_y, random);
+
+                reset_frame_arena(arena);
+                bin_point_lights(grid, point_lights.data(), light_count, glm::vec2(0.0f), viewport_size_x, viewport_size_y, jobs, arena);
+                upload_point_lights(point_light_buffer, point_lights);
+                upload_light_tiles(light_tile_buffers, grid);
+                set_uniform(program, tile_count_x_handle, (GLint)grid.tile_count_x);
+
+                uintmax_t previous_zone_count = 0;
+                double previous_ms = get_profile_gpu_zone_ms("Light density pass", previous_zone_count);
+                for (uintmax_t frame = 0; frame < frame_count; frame++) {
+                    begin_profile_frame();
+                    {
+                        PROFILE_GPU_ZONE("Light density pass");
+                        glDrawArrays(GL_TRIANGLES, 0, 3);
+                        glFlush();  // Inside the zone, drivers that only rasterise on a flush would time nothing otherwise
+                    }
+                    end_profile_frame();
+                }
+                // Empty frames until the last zones are read back
+                for (uintmax_t frame = 0; frame < PROFILER_GPU_LATENCY; frame++) {
+                    begin_profile_frame();
+                    end_profile_frame();
+                }
+
+                uintmax_t zone_count = 0;
+                double gpu_ms = get_profile_gpu_zone_ms("Light density pass", zone_count) - previous_ms;
+                zone_count -= previous_zone_count;
+                if (zone_count == 0) {
+                    log_warning("[BENCH] No GPU zones were read back, needs timestamp queries and a build without ENGINE_DISABLE_PROFILER");
+                    break;
+                }
+
+                uintmax_t tile_count = grid.tile_count_x * grid.tile_count_y;
+                uint32_t max_tile_light_count = 0;
+                for (uintmax_t tile = 0; tile < tile_count; tile++) max_tile_light_count = std::max(max_tile_light_count, grid.tile_ranges[tile * 2 + 1]);
+
+                log_info("[BENCH] " + std::string(fixed_density ? "Fixed density, " : "All on screen, ") + std::to_string(light_count) + " lights: " +
+                    std::to_string(gpu_ms / (double)zone_count) + " ms/frame GPU, " +
+                    std::to_string((double)grid.light_indices.size() / (double)tile_count) + " avg lights/tile, " +
+                    std::to_string(max_tile_light_count) + " max lights/tile");
+            }
+        }
+        stop_profiler(trace_path);
+
+        destroy_frame_arena(arena);
+        stop_job_system(jobs);
+        glDeleteVertexArrays(1, &empty_VAO);
+        destroy_light_tile_buffers(light_tile_buffers);
+        destroy_point_light_buffer(point_light_buffer);
+        destroy_gbuffer(gbuffer);
+        destroy_shader_permutations(permutations);
+    }
+
+    void run_cpu_lighting_benchmark()
+    {
+        const uintmax_t image_size_x = 1280;
+        const uintmax_t image_size_y = 720;
+        const uintmax_t material_size = 256;
+        const uintmax_t hardware_thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+        log_info("[BENCH] CPU lighting, " + std::to_string(image_size_x) + "x" + std::to_string(image_size_y));
+
+        // Noisy normals and AO so every term of the lighting is exercised
+        std::mt19937 random(1337);
+        std::uniform_int_distribution<int> random_byte(0, 255);
+        std::vector<unsigned char> albedo(material_size * material_size * 4);
+        std::vector<unsigned char> surface(material_size * material_size * 4);
+        for (unsigned char& value : albedo) value = (unsigned char)random_byte(random);
+        for (unsigned char& value : surface) value = (unsigned char)random_byte(random);
+
+        CpuMaterialImage material;
+        material.size_x = material_size;
+        material.size_y = material_size;
+        material.albedo = albedo.data();
+        material.surface = surface.data();
+
+        CpuLightingParams params;
+        params.size_x = image_size_x;
+        params.size_y = image_size_y;
+        params.ambient_light = glm::vec3(0.05f);
+
+        std::uniform_real_distribution<float> random_x(0.0f, (float)image_size_x);
+        std::uniform_real_distribution<float> random_y(0.0f, (float)image_size_y);
+        std::uniform_real_distribution<float> random_radius(64.0f, 512.0f);
+        std::uniform_real_distribution<float> random_unit(0.0f, 1.0f);
+
+        std::vector<uintmax_t> thread_counts = { 1 };
+        if (hardware_thread_count > 1) thread_counts.push_back(hardware_thread_count);
+
+        CpuLightingKernel kernels[] = { CPU_LIGHTING_KERNEL_SCALAR, CPU_LIGHTING_KERNEL_SSE, CPU_LIGHTING_KERNEL_AVX2 };
+        std::vector<unsigned char> reference_pixels(image_size_x * image_size_y * 4);
+        std::vector<unsigned char> pixels(image_size_x * image_size_y * 4);
+
+        for (uintmax_t light_count = 16; light_count <= 256; light_count *= 2) {
+            std::vector<PointLight> point_lights(light_count);
+            for (PointLight& point_light : point_lights) {
+                point_light.position = glm::vec2(random_x(random), random_y(random));
+                point_light.radius = random_radius(random);
+                point_light.color = glm::vec3(random_unit(random), random_unit(random), random_unit(random));
+            }
+
+            render_cpu_lighting(params, material, point_lights.data(), light_count, reference_pixels.data(), CPU_LIGHTING_KERNEL_SCALAR, 0);
+
+            for (CpuLightingKernel kernel : kernels) {
+                if (!is_cpu_lighting_kernel_supported(kernel)) continue;
+
+                for (uintmax_t thread_count : thread_counts) {
+                    // At least 3 runs and 0.25 s
+                    uintmax_t iteration_count = 0;
+                    auto start = std::chrono::steady_clock::now();
+                    double elapsed_ms = 0.0;
+                    while (iteration_count < 3 || elapsed_ms < 250.0) {
+                        render_cpu_lighting(params, material, point_lights.data(), light_count, pixels.data(), kernel, thread_count);
+                        iteration_count++;
+                        elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                    }
+
+                    int max_difference = 0;
+                    for (uintmax_t i = 0; i < pixels.size(); i++) max_difference = std::max(max_difference, std::abs((int)pixels[i] - (int)reference_pixels[i]));
+
+                    double megapixels = (double)(image_size_x * image_size_y * iteration_count) / 1000000.0;
+                    log_info("[BENCH] " + std::to_string(light_count) + " lights, " + get_cpu_lighting_kernel_name(kernel) + ", " + std::to_string(thread_count) + " threads: " +
+                        std::to_string(megapixels / (elapsed_ms / 1000.0)) + " MP/s, max difference to scalar " + std::to_string(max_difference));
+                }
+            }
+        }
+    }
+
+    void run_light_soa_benchmark()
+    {
+        const uintmax_t light_count = 100000;
+        const float viewport_size_x = 1920.0f;
+        const float viewport_size_y = 1080.0f;
+        const float world_size = 8192.0f;  // Most lights are off screen
+
+        log_info("[BENCH] Light SoA, " + std::to_string(light_count) + " lights with " + std::to_string(LIGHT_FLICKER_TERM_COUNT) + " flicker terms, 1 thread");
+
+        std::mt19937 random(1337);
+        std::uniform_real_distribution<float> random_position(0.0f, world_size);
+        std::uniform_real_distribution<float> random_radius(32.0f, 512.0f);
+        std::uniform_real_distribution<float> random_frequency(0.001f, 0.01f);
+        std::uniform_real_distribution<float> random_phase(0.0f, 6.2831853f);
+        std::uniform_real_distribution<float> random_weight(0.0f, 0.5f);
+
+        std::vector<PointLight> point_lights(light_count);
+        std::vector<LightFlicker> flickers(light_count);
+        LightSoA lights;
+        reserve_light_soa(lights, light_count);
+        for (uintmax_t i = 0; i < light_count; i++) {
+            point_lights[i].position = glm::vec2(random_position(random), random_position(random));
+            point_lights[i].radius = random_radius(random);
+            flickers[i].base = 2.0f;
+            for (uintmax_t term = 0; term < LIGHT_FLICKER_TERM_COUNT; term++) {
+                flickers[i].frequency[term] = random_frequency(random);
+                flickers[i].phase[term] = random_phase(random);
+                flickers[i].weight[term] = random_weight(random);
+            }
+            add_light(lights, point_lights[i], flickers[i]);
+        }
+
+        const glm::vec2 viewport_min = glm::vec2(world_size * 0.5f);
+        const glm::vec2 viewport_max = viewport_min + glm::vec2(viewport_size_x, viewport_size_y);
+        std::vector<uint32_t> visible_indices(lights.capacity);
+        std::vector<GPUPointLight> gpu_lights(light_count);
+
+        // Array of structs with `std::sin`, what the SoA kernels replace
+        uintmax_t reference_visible_count = 0;
+        float reference_time_ms = 0.0f;  // Of the energies the reference loop left, the kernels are compared there
+        {
+            uintmax_t iteration_count = 0;
+            auto start = std::chrono::steady_clock::now();
+            double elapsed_ms = 0.0;
+            while (iteration_count < 3 || elapsed_ms < 250.0) {
+                float time_ms = (float)iteration_count * 16.0f;
+                reference_time_ms = time_ms;
+                reference_visible_count = 0;
+                for (uintmax_t i = 0; i < light_count; i++) {
+                    PointLight& point_light = point_lights[i];
+                    const LightFlicker& flicker = flickers[i];
+
+                    float energy = flicker.base;
+                    for (uintmax_t term = 0; term < LIGHT_FLICKER_TERM_COUNT; term++) energy += flicker.weight[term] * std::sin(time_ms * flicker.frequency[term] + flicker.phase[term]);
+                    point_light.energy = energy;
+
+                    if (energy > 0.0f &&
+                        point_light.position.x + point_light.radius >= viewport_min.x && point_light.position.x - point_light.radius <= viewport_max.x &&
+                        point_light.position.y + point_light.radius >= viewport_min.y && point_light.position.y - point_light.radius <= viewport_max.y) {
+                        visible_indices[reference_visible_count++] = (uint32_t)i;
+                    }
+                }
+                iteration_count++;
+                elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+            log_info("[BENCH] AoS std::sin, animate + cull: " + std::to_string(elapsed_ms / (double)iteration_count) + " ms/frame, " + std::to_string(reference_visible_count) + " visible");
+        }
+
+        LightSoAKernel kernels[] = { LIGHT_SOA_KERNEL_SCALAR, LIGHT_SOA_KERNEL_SSE };
+        for (LightSoAKernel kernel : kernels) {
+            if (!is_light_soa_kernel_supported(kernel)) continue;
+
+            uintmax_t iteration_count = 0;
+            uintmax_t visible_count = 0;
+            double animate_ms = 0.0, cull_ms = 0.0, pack_ms = 0.0;
+            auto start = std::chrono::steady_clock::now();
+            double elapsed_ms = 0.0;
+            while (iteration_count < 3 || elapsed_ms < 250.0) {
+                float time_ms = (float)iteration_count * 16.0f;
+
+                auto animate_start = std::chrono::steady_clock::now();
+                animate_light_soa(lights, time_ms, kernel);
+                auto cull_start = std::chrono::steady_clock::now();
+                visible_count = cull_light_soa(lights, viewport_min, viewport_max, visible_indices.data(), kernel);
+                auto pack_start = std::chrono::steady_clock::now();
+                pack_light_soa(lights, visible_indices.data(), visible_count, gpu_lights.data(), kernel);
+                auto pack_end = std::chrono::steady_clock::now();
+
+                animate_ms += std::chrono::duration<double, std::milli>(cull_start - animate_start).count();
+                cull_ms += std::chrono::duration<double, std::milli>(pack_start - cull_start).count();
+                pack_ms += std::chrono::duration<double, std::milli>(pack_end - pack_start).count();
+                iteration_count++;
+                elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+
+            animate_light_soa(lights, reference_time_ms, kernel);
+            float max_difference = 0.0f;
+            for (uintmax_t i = 0; i < light_count; i++) max_difference = std::max(max_difference, std::abs(lights.energy[i] - point_lights[i].energy));
+
+            log_info("[BENCH] SoA " + std::string(get_light_soa_kernel_name(kernel)) + ": animate " + std::to_string(animate_ms / (double)iteration_count) +
+                " ms, cull " + std::to_string(cull_ms / (double)iteration_count) + " ms, pack " + std::to_string(pack_ms / (double)iteration_count) +
+                " ms per frame, " + std::to_string(visible_count) + " visible, max energy difference to std::sin " + std::to_string(max_difference));
+        }
+
+        destroy_light_soa(lights);
+    }
+
+    // Runs `function` at least 3 times and for 0.25 s, returns ms per run
+    static double time_job_benchmark(const std::function<void()>& function)
+    {
+        uintmax_t iteration_count = 0;
+        auto start = std::chrono::steady_clock::now();
+        double elapsed_ms = 0.0;
+        while (iteration_count < 3 || elapsed_ms < 250.0) {
+            function();
+            iteration_count++;
+            elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        return elapsed_ms / (double)iteration_count;
+    }
+
+    static void empty_benchmark_job(void* data)
+    {
+    }
+
+    void run_job_system_benchmark()
+    {
+        const uintmax_t hardware_thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+        const uintmax_t empty_job_count = 65536;
+        const uintmax_t animated_light_count = 1 << 20;
+        const uintmax_t binned_light_count = 4096;
+
+        log_info("[BENCH] Job system scaling, 1 to " + std::to_string(hardware_thread_count) + " threads");
+
+        // Every count up to 8, then powers of two and the hardware count
+        std::vector<uintmax_t> thread_counts;
+        for (uintmax_t thread_count = 1; thread_count <= hardware_thread_count; thread_count = (thread_count < 8) ? thread_count + 1 : thread_count * 2) {
+            thread_counts.push_back(thread_count);
+        }
+        if (thread_counts.back() != hardware_thread_count) thread_counts.push_back(hardware_thread_count);
+
+        std::mt19937 random(1337);
+        std::uniform_real_distribution<float> random_x(0.0f, 1920.0f);
+        std::uniform_real_distribution<float> random_y(0.0f, 1080.0f);
+        std::uniform_real_distribution<float> random_radius(32.0f, 256.0f);
+
+        std::vector<PointLight> animated_lights(animated_light_count);
+        std::vector<PointLight> binned_lights(binned_light_count);
+        for (PointLight& point_light : binned_lights) {
+            point_light.position = glm::vec2(random_x(random), random_y(random));
+            point_light.radius = random_radius(random);
+        }
+        LightTileGrid grid;
+        FrameArena arena;
+        create_frame_arena(arena, 16 * 1024 * 1024);
+
+        double base_empty_ms = 0.0, base_animation_ms = 0.0, base_binning_ms = 0.0;
+        for (uintmax_t thread_count : thread_counts) {
+            JobSystem jobs;
+            start_job_system(jobs, thread_count);
+
+            // Scheduling overhead only
+            double empty_ms = time_job_benchmark([&jobs, empty_job_count] {
+                JobCounter counter;
+                for (uintmax_t i = 0; i < empty_job_count; i++) submit_job(jobs, empty_benchmark_job, nullptr, &counter);
+                wait_for_counter(jobs, counter);
+            });
+
+            // The `mainLoop` flicker over many lights
+            double animation_ms = time_job_benchmark([&jobs, &animated_lights] {
+                parallel_for(jobs, animated_lights.size(), 4096, [&animated_lights](uintmax_t begin, uintmax_t end) {
+                    for (uintmax_t i = begin; i < end; i++) {
+                        animated_lights[i].energy = (
+                            (sin(((float)i * 120.0f) * 0.004f) + 2.0f) * 0.2f +
+                            (sin(((float)i * 300.0f) * 0.005f) + 2.0f) * 0.3f +
+                            (sin(((float)i * 60.0f) * 0.007f) + 2.0f) * 0.5f +
+                            (sin(((float)i * 400.0f) * 0.0045f) + 2.0f) * 0.2f
+                        );
+                    }
+                });
+            });
+
+            double binning_ms = time_job_benchmark([&jobs, &grid, &binned_lights, &arena] {
+                reset_frame_arena(arena);
+                bin_point_lights(grid, binned_lights.data(), binned_lights.size(), glm::vec2(0.0f), 1920, 1080, jobs, arena);
+            });
+
+            stop_job_system(jobs);
+
+            if (thread_count == 1) {
+                base_empty_ms = empty_ms;
+                base_animation_ms = animation_ms;
+                base_binning_ms = binning_ms;
+            }
+            log_info("[BENCH] " + std::to_string(thread_count) + " threads: " +
+                std::to_string((double)empty_job_count / (empty_ms / 1000.0) / 1000000.0) + " M empty jobs/s (" + std::to_string(base_empty_ms / empty_ms) + "x), " +
+                std::to_string(animated_light_count) + " lights animated in " + std::to_string(animation_ms) + " ms (" + std::to_string(base_animation_ms / animation_ms) + "x), " +
+                std::to_string(binned_light_count) + " lights binned in " + std::to_string(binning_ms) + " ms (" + std::to_string(base_binning_ms / binning_ms) + "x)");
+        }
+        destroy_frame_arena(arena);
+    }
+
+    // Times `calls` bursts that fit the log queue, flushing between bursts outside the timing, returns ns per call
+    static double time_log_benchmark(const std::function<void(uintmax_t)>& calls)
+    {
+        const uintmax_t burst_size = LOG_QUEUE_CAPACITY / 2;
+        uintmax_t call_count = 0;
+        double elapsed_ms = 0.0;
+        while (call_count < burst_size * 8 || elapsed_ms < 250.0) {
+            flush_log();
+            auto start = std::chrono::steady_clock::now();
+            calls(burst_size);
+            elapsed_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            call_count += burst_size;
+        }
+        flush_log();
+        return elapsed_ms * 1000000.0 / (double)call_count;
+    }
+
+    void run_logging_benchmark()
+    {
+        log_info("[BENCH] Logging cost on the calling thread, lines are formatted but not printed");
+        flush_log();
+        set_log_output_enabled(false);
+
+        // Limits off, every call reaches the queue
+        static LogSite numbers_site;
+        static LogSite string_site;
+        numbers_site.limit = 0;
+        string_site.limit = 0;
+        std::string texture_path = "../assets/textures/brick/diffuse.png";
+
+        double numbers_ns = time_log_benchmark([](uintmax_t count) {
+            for (uintmax_t i = 0; i < count; i++) log_at_site(numbers_site, LOG_LEVEL_DEBUG, "[BENCH] Frame {} took {} ms", i, 16.6);
+        });
+        double string_ns = time_log_benchmark([&texture_path](uintmax_t count) {
+            for (uintmax_t i = 0; i < count; i++) log_at_site(string_site, LOG_LEVEL_DEBUG, "[BENCH] `{}` uploaded in {} ms", texture_path, 0.25);
+        });
+        double suppressed_ns = time_log_benchmark([](uintmax_t count) {
+            for (uintmax_t i = 0; i < count; i++) LOG_DEBUG("[BENCH] Frame {} took {} ms", i, 16.6);
+        });
+        double preformatted_ns = time_log_benchmark([](uintmax_t count) {
+            for (uintmax_t i = 0; i < count; i++) log_debug("[BENCH] Frame " + std::to_string(i) + " took " + std::to_string(16.6) + " ms");
+        });
+
+        set_log_output_enabled(true);
+        log_info("[BENCH] LOG_DEBUG, two numbers: " + std::to_string(numbers_ns) + " ns");
+        log_info("[BENCH] LOG_DEBUG, string and number: " + std::to_string(string_ns) + " ns");
+        log_info("[BENCH] LOG_DEBUG, rate limited: " + std::to_string(suppressed_ns) + " ns");
+        log_info("[BENCH] log_debug, string built at the call site: " + std::to_string(preformatted_ns) + " ns");
+    }
+}
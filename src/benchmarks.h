@@ -0,0 +1,24 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <string>
+
+#include "logging.h"
+
+namespace Engine
+{
+    // Expects a current OpenGL context
+    void run_uniform_benchmark(uintmax_t frame_count);
+    void run_sprite_batch_benchmark(uintmax_t sprite_count, uintmax_t frame_count);
+    void run_instancing_benchmark(uintmax_t sprite_count, uintmax_t frame_count);
+    // Times the deferred lighting pass through GPU profiler zones, the capture is written to `trace_path` if it is not empty
+    void run_light_density_benchmark(uintmax_t frame_count, const std::string& trace_path);
+
+    // Headless
+    void run_light_culling_benchmark();
+    void run_cpu_lighting_benchmark();
+    void run_light_soa_benchmark();
+    void run_job_system_benchmark();
+    void run_logging_benchmark();
+}
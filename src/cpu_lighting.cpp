@@ -0,0 +1,418 @@
+#include "cpu_lighting.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_LIGHTING_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC accepts AVX intrinsics anywhere, GCC and Clang only inside functions built for the target
+#if defined(__GNUC__) || defined(__clang__)
+#define CPU_LIGHTING_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define CPU_LIGHTING_AVX2_TARGET
+#endif
+
+// Row buffers are padded so the widest kernel never needs a scalar tail
+#define CPU_LIGHTING_MAX_WIDTH 8
+
+namespace Engine
+{
+    // Everything a kernel needs for one scanline, per pixel arrays are `padded_size_x` long
+    struct CpuLightingRow {
+        uintmax_t padded_size_x = 0;
+        float frag_y = 0.0f;
+
+        float* frag_x = nullptr;
+        float* normal_x = nullptr;
+        float* normal_y = nullptr;
+        float* ao = nullptr;
+        float* view_x = nullptr;  // Normalized view direction, independent of the lights
+        float* view_y = nullptr;
+        float* view_z = nullptr;
+
+        float* light_r = nullptr;  // Accumulated light, starts at the ambient light
+        float* light_g = nullptr;
+        float* light_b = nullptr;
+
+        const uint32_t* light_indices = nullptr;  // Lights whose radius reaches this row
+        uintmax_t light_count = 0;
+    };
+
+    // `process_point_light` from `point_lighting.glsl`, one pixel at a time
+    static void accumulate_lights_scalar(const CpuLightingRow& row, const CpuLightSoA& lights)
+    {
+        for (uintmax_t x = 0; x < row.padded_size_x; x++) {
+            for (uintmax_t i = 0; i < row.light_count; i++) {
+                uint32_t light = row.light_indices[i];
+
+                // Attenuation, with the radius window
+                float delta_x = row.frag_x[x] - lights.position_x[light];
+                float delta_y = row.frag_y - lights.position_y[light];
+                float distance_squared = delta_x * delta_x + delta_y * delta_y;
+                float radius_squared = lights.radius[light] * lights.radius[light];
+                if (distance_squared >= radius_squared) continue;
+
+                float distance = sqrtf(distance_squared);
+                float attenuation = 1.0f / (1.0f + lights.attenuation_linear[light] * distance + lights.attenuation_quadratic[light] * distance_squared);
+                float distance_ratio_squared = distance_squared / radius_squared;
+                float radius_window = std::max(1.0f - distance_ratio_squared * distance_ratio_squared, 0.0f);
+                attenuation *= radius_window * radius_window;
+
+                // Normal map, `normal` is (normal.xy, 1) and not normalized, like in the shader
+                float light_dir_x = -delta_x;
+                float light_dir_y = -delta_y;
+                float light_dir_z = lights.height[light];
+                float light_dir_length = sqrtf(light_dir_x * light_dir_x + light_dir_y * light_dir_y + light_dir_z * light_dir_z);
+                light_dir_x /= light_dir_length;
+                light_dir_y /= light_dir_length;
+                light_dir_z /= light_dir_length;
+
+                float normal_dot_light = row.normal_x[x] * light_dir_x + row.normal_y[x] * light_dir_y + light_dir_z;
+                float normal_difference = std::max(normal_dot_light, 0.0f);
+
+                // Specular, `reflect(-light_dir, normal)`
+                float reflection_x = -light_dir_x + 2.0f * normal_dot_light * row.normal_x[x];
+                float reflection_y = -light_dir_y + 2.0f * normal_dot_light * row.normal_y[x];
+                float reflection_z = -light_dir_z + 2.0f * normal_dot_light;
+                float specular_factor = std::max(row.view_x[x] * reflection_x + row.view_y[x] * reflection_y + row.view_z[x] * reflection_z, 0.0f);
+
+                float factor = (1.0f + specular_factor) * lights.energy[light] * row.ao[x] * normal_difference * attenuation;
+                row.light_r[x] += lights.color_r[light] * factor;
+                row.light_g[x] += lights.color_g[light] * factor;
+                row.light_b[x] += lights.color_b[light] * factor;
+            }
+        }
+    }
+
+#ifdef CPU_LIGHTING_X86
+    static void accumulate_lights_sse(const CpuLightingRow& row, const CpuLightSoA& lights)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        const __m128 frag_y = _mm_set1_ps(row.frag_y);
+
+        for (uintmax_t x = 0; x < row.padded_size_x; x += 4) {
+            __m128 frag_x = _mm_loadu_ps(&row.frag_x[x]);
+            __m128 normal_x = _mm_loadu_ps(&row.normal_x[x]);
+            __m128 normal_y = _mm_loadu_ps(&row.normal_y[x]);
+            __m128 ao = _mm_loadu_ps(&row.ao[x]);
+            __m128 view_x = _mm_loadu_ps(&row.view_x[x]);
+            __m128 view_y = _mm_loadu_ps(&row.view_y[x]);
+            __m128 view_z = _mm_loadu_ps(&row.view_z[x]);
+            __m128 light_r = _mm_loadu_ps(&row.light_r[x]);
+            __m128 light_g = _mm_loadu_ps(&row.light_g[x]);
+            __m128 light_b = _mm_loadu_ps(&row.light_b[x]);
+
+            float span_min_x = row.frag_x[x] - 0.5f;
+            float span_max_x = row.frag_x[x + 3] + 0.5f;
+
+            for (uintmax_t i = 0; i < row.light_count; i++) {
+                uint32_t light = row.light_indices[i];
+                float radius = lights.radius[light];
+                if (lights.position_x[light] + radius <= span_min_x || lights.position_x[light] - radius >= span_max_x) continue;
+
+                __m128 delta_x = _mm_sub_ps(frag_x, _mm_set1_ps(lights.position_x[light]));
+                __m128 delta_y = _mm_sub_ps(frag_y, _mm_set1_ps(lights.position_y[light]));
+                __m128 distance_squared = _mm_add_ps(_mm_mul_ps(delta_x, delta_x), _mm_mul_ps(delta_y, delta_y));
+                __m128 distance = _mm_sqrt_ps(distance_squared);
+
+                __m128 attenuation = _mm_div_ps(one, _mm_add_ps(one, _mm_add_ps(
+                    _mm_mul_ps(_mm_set1_ps(lights.attenuation_linear[light]), distance),
+                    _mm_mul_ps(_mm_set1_ps(lights.attenuation_quadratic[light]), distance_squared))));
+                __m128 distance_ratio_squared = _mm_div_ps(distance_squared, _mm_set1_ps(radius * radius));
+                __m128 radius_window = _mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(distance_ratio_squared, distance_ratio_squared)), zero);
+                attenuation = _mm_mul_ps(attenuation, _mm_mul_ps(radius_window, radius_window));
+
+                __m128 light_dir_x = _mm_sub_ps(zero, delta_x);
+                __m128 light_dir_y = _mm_sub_ps(zero, delta_y);
+                __m128 light_dir_z = _mm_set1_ps(lights.height[light]);
+                __m128 light_dir_length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(light_dir_x, light_dir_x), _mm_mul_ps(light_dir_y, light_dir_y)), _mm_mul_ps(light_dir_z, light_dir_z)));
+                light_dir_x = _mm_div_ps(light_dir_x, light_dir_length);
+                light_dir_y = _mm_div_ps(light_dir_y, light_dir_length);
+                light_dir_z = _mm_div_ps(light_dir_z, light_dir_length);
+
+                __m128 normal_dot_light = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normal_x, light_dir_x), _mm_mul_ps(normal_y, light_dir_y)), light_dir_z);
+                __m128 normal_difference = _mm_max_ps(normal_dot_light, zero);
+
+                __m128 twice_normal_dot_light = _mm_mul_ps(two, normal_dot_light);
+                __m128 reflection_x = _mm_sub_ps(_mm_mul_ps(twice_normal_dot_light, normal_x), light_dir_x);
+                __m128 reflection_y = _mm_sub_ps(_mm_mul_ps(twice_normal_dot_light, normal_y), light_dir_y);
+                __m128 reflection_z = _mm_sub_ps(twice_normal_dot_light, light_dir_z);
+                __m128 specular_factor = _mm_max_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(view_x, reflection_x), _mm_mul_ps(view_y, reflection_y)), _mm_mul_ps(view_z, reflection_z)), zero);
+
+                __m128 factor = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(one, specular_factor), _mm_set1_ps(lights.energy[light])), _mm_mul_ps(_mm_mul_ps(ao, normal_difference), attenuation));
+                light_r = _mm_add_ps(light_r, _mm_mul_ps(_mm_set1_ps(lights.color_r[light]), factor));
+                light_g = _mm_add_ps(light_g, _mm_mul_ps(_mm_set1_ps(lights.color_g[light]), factor));
+                light_b = _mm_add_ps(light_b, _mm_mul_ps(_mm_set1_ps(lights.color_b[light]), factor));
+            }
+
+            _mm_storeu_ps(&row.light_r[x], light_r);
+            _mm_storeu_ps(&row.light_g[x], light_g);
+            _mm_storeu_ps(&row.light_b[x], light_b);
+        }
+    }
+
+    CPU_LIGHTING_AVX2_TARGET static void accumulate_lights_avx2(const CpuLightingRow& row, const CpuLightSoA& lights)
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 two = _mm256_set1_ps(2.0f);
+        const __m256 frag_y = _mm256_set1_ps(row.frag_y);
+
+        for (uintmax_t x = 0; x < row.padded_size_x; x += 8) {
+            __m256 frag_x = _mm256_loadu_ps(&row.frag_x[x]);
+            __m256 normal_x = _mm256_loadu_ps(&row.normal_x[x]);
+            __m256 normal_y = _mm256_loadu_ps(&row.normal_y[x]);
+            __m256 ao = _mm256_loadu_ps(&row.ao[x]);
+            __m256 view_x = _mm256_loadu_ps(&row.view_x[x]);
+            __m256 view_y = _mm256_loadu_ps(&row.view_y[x]);
+            __m256 view_z = _mm256_loadu_ps(&row.view_z[x]);
+            __m256 light_r = _mm256_loadu_ps(&row.light_r[x]);
+            __m256 light_g = _mm256_loadu_ps(&row.light_g[x]);
+            __m256 light_b = _mm256_loadu_ps(&row.light_b[x]);
+
+            float span_min_x = row.frag_x[x] - 0.5f;
+            float span_max_x = row.frag_x[x + 7] + 0.5f;
+
+            for (uintmax_t i = 0; i < row.light_count; i++) {
+                uint32_t light = row.light_indices[i];
+                float radius = lights.radius[light];
+                if (lights.position_x[light] + radius <= span_min_x || lights.position_x[light] - radius >= span_max_x) continue;
+
+                __m256 delta_x = _mm256_sub_ps(frag_x, _mm256_set1_ps(lights.position_x[light]));
+                __m256 delta_y = _mm256_sub_ps(frag_y, _mm256_set1_ps(lights.position_y[light]));
+                __m256 distance_squared = _mm256_add_ps(_mm256_mul_ps(delta_x, delta_x), _mm256_mul_ps(delta_y, delta_y));
+                __m256 distance = _mm256_sqrt_ps(distance_squared);
+
+                __m256 attenuation = _mm256_div_ps(one, _mm256_add_ps(one, _mm256_add_ps(
+                    _mm256_mul_ps(_mm256_set1_ps(lights.attenuation_linear[light]), distance),
+                    _mm256_mul_ps(_mm256_set1_ps(lights.attenuation_quadratic[light]), distance_squared))));
+                __m256 distance_ratio_squared = _mm256_div_ps(distance_squared, _mm256_set1_ps(radius * radius));
+                __m256 radius_window = _mm256_max_ps(_mm256_sub_ps(one, _mm256_mul_ps(distance_ratio_squared, distance_ratio_squared)), zero);
+                attenuation = _mm256_mul_ps(attenuation, _mm256_mul_ps(radius_window, radius_window));
+
+                __m256 light_dir_x = _mm256_sub_ps(zero, delta_x);
+                __m256 light_dir_y = _mm256_sub_ps(zero, delta_y);
+                __m256 light_dir_z = _mm256_set1_ps(lights.height[light]);
+                __m256 light_dir_length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(light_dir_x, light_dir_x), _mm256_mul_ps(light_dir_y, light_dir_y)), _mm256_mul_ps(light_dir_z, light_dir_z)));
+                light_dir_x = _mm256_div_ps(light_dir_x, light_dir_length);
+                light_dir_y = _mm256_div_ps(light_dir_y, light_dir_length);
+                light_dir_z = _mm256_div_ps(light_dir_z, light_dir_length);
+
+                __m256 normal_dot_light = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(normal_x, light_dir_x), _mm256_mul_ps(normal_y, light_dir_y)), light_dir_z);
+                __m256 normal_difference = _mm256_max_ps(normal_dot_light, zero);
+
+                __m256 twice_normal_dot_light = _mm256_mul_ps(two, normal_dot_light);
+                __m256 reflection_x = _mm256_sub_ps(_mm256_mul_ps(twice_normal_dot_light, normal_x), light_dir_x);
+                __m256 reflection_y = _mm256_sub_ps(_mm256_mul_ps(twice_normal_dot_light, normal_y), light_dir_y);
+                __m256 reflection_z = _mm256_sub_ps(twice_normal_dot_light, light_dir_z);
+                __m256 specular_factor = _mm256_max_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(view_x, reflection_x), _mm256_mul_ps(view_y, reflection_y)), _mm256_mul_ps(view_z, reflection_z)), zero);
+
+                __m256 factor = _mm256_mul_ps(_mm256_mul_ps(_mm256_add_ps(one, specular_factor), _mm256_set1_ps(lights.energy[light])), _mm256_mul_ps(_mm256_mul_ps(ao, normal_difference), attenuation));
+                light_r = _mm256_add_ps(light_r, _mm256_mul_ps(_mm256_set1_ps(lights.color_r[light]), factor));
+                light_g = _mm256_add_ps(light_g, _mm256_mul_ps(_mm256_set1_ps(lights.color_g[light]), factor));
+                light_b = _mm256_add_ps(light_b, _mm256_mul_ps(_mm256_set1_ps(lights.color_b[light]), factor));
+            }
+
+            _mm256_storeu_ps(&row.light_r[x], light_r);
+            _mm256_storeu_ps(&row.light_g[x], light_g);
+            _mm256_storeu_ps(&row.light_b[x], light_b);
+        }
+    }
+
+    static bool detect_avx2()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) return false;
+
+        // AVX needs the OS to save the YMM registers
+        __cpuid(info, 1);
+        bool avx = (info[2] & (1 << 28)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        if (!avx || !osxsave || (_xgetbv(0) & 6) != 6) return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) || defined(__clang__)
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    }
+#endif
+
+    bool is_cpu_lighting_kernel_supported(CpuLightingKernel kernel)
+    {
+#ifdef CPU_LIGHTING_X86
+        static const bool avx2_supported = detect_avx2();
+        if (kernel == CPU_LIGHTING_KERNEL_AVX2) return avx2_supported;
+        return true;
+#else
+        return kernel == CPU_LIGHTING_KERNEL_SCALAR || kernel == CPU_LIGHTING_KERNEL_BEST;
+#endif
+    }
+
+    const char* get_cpu_lighting_kernel_name(CpuLightingKernel kernel)
+    {
+        switch (kernel) {
+            case CPU_LIGHTING_KERNEL_SCALAR: return "scalar";
+            case CPU_LIGHTING_KERNEL_SSE:    return "SSE";
+            case CPU_LIGHTING_KERNEL_AVX2:   return "AVX2";
+            case CPU_LIGHTING_KERNEL_BEST:   return "best";
+            default:                         return "unknown";
+        }
+    }
+
+    static void build_light_soa(CpuLightSoA& soa, const PointLight* point_lights, uintmax_t point_light_count)
+    {
+        std::vector<float>* fields[] = {
+            &soa.position_x, &soa.position_y, &soa.height, &soa.radius, &soa.attenuation_linear, &soa.attenuation_quadratic,
+            &soa.color_r, &soa.color_g, &soa.color_b, &soa.energy,
+        };
+        for (std::vector<float>* field : fields) field->resize(point_light_count);
+
+        for (uintmax_t i = 0; i < point_light_count; i++) {
+            const PointLight& point_light = point_lights[i];
+            soa.position_x[i] = point_light.position.x;
+            soa.position_y[i] = point_light.position.y;
+            soa.height[i] = point_light.height;
+            soa.radius[i] = point_light.radius;
+            soa.attenuation_linear[i] = point_light.attenuation.linear;
+            soa.attenuation_quadratic[i] = point_light.attenuation.quadratic;
+            soa.color_r[i] = point_light.color.r;
+            soa.color_g[i] = point_light.color.g;
+            soa.color_b[i] = point_light.color.b;
+            soa.energy[i] = point_light.energy;
+        }
+    }
+
+    static inline unsigned char to_unorm8(float value)
+    {
+        return (unsigned char)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+
+    typedef void (*AccumulateLightsFunction)(const CpuLightingRow& row, const CpuLightSoA& lights);
+
+    // Pulls rows off `next_row` until the image is done
+    static void render_cpu_lighting_rows(const CpuLightingParams& params, const CpuMaterialImage& material, const CpuLightSoA& lights,
+        AccumulateLightsFunction accumulate_lights, std::atomic<uintmax_t>* next_row, unsigned char* pixels)
+    {
+        uintmax_t padded_size_x = (params.size_x + CPU_LIGHTING_MAX_WIDTH - 1) / CPU_LIGHTING_MAX_WIDTH * CPU_LIGHTING_MAX_WIDTH;
+        std::vector<float> row_data(padded_size_x * 10);
+        std::vector<uint32_t> light_indices;
+        light_indices.reserve(lights.radius.size());
+
+        CpuLightingRow row;
+        row.padded_size_x = padded_size_x;
+        row.frag_x = &row_data[padded_size_x * 0];
+        row.normal_x = &row_data[padded_size_x * 1];
+        row.normal_y = &row_data[padded_size_x * 2];
+        row.ao = &row_data[padded_size_x * 3];
+        row.view_x = &row_data[padded_size_x * 4];
+        row.view_y = &row_data[padded_size_x * 5];
+        row.view_z = &row_data[padded_size_x * 6];
+        row.light_r = &row_data[padded_size_x * 7];
+        row.light_g = &row_data[padded_size_x * 8];
+        row.light_b = &row_data[padded_size_x * 9];
+
+        // Same point the shader aims the view direction at
+        float eye_x = params.camera_pos.x + (float)params.size_x * 0.5f;
+        float eye_y = params.camera_pos.y + (float)params.size_y * 0.5f;
+
+        for (uintmax_t y = next_row->fetch_add(1); y < params.size_y; y = next_row->fetch_add(1)) {
+            row.frag_y = (float)y + 0.5f;
+
+            // Lights whose radius reaches this row, the kernels only test the horizontal extent
+            light_indices.clear();
+            for (uintmax_t i = 0; i < lights.radius.size(); i++) {
+                if (fabsf(lights.position_y[i] - row.frag_y) < lights.radius[i]) light_indices.push_back((uint32_t)i);
+            }
+            row.light_indices = light_indices.data();
+            row.light_count = light_indices.size();
+
+            // Material, sampled at texel centers like the 1:1 background quad so nearest matches the GPU filtering
+            const unsigned char* surface_row = material.surface + (y % material.size_y) * material.size_x * 4;
+            for (uintmax_t x = 0; x < padded_size_x; x++) {
+                const unsigned char* surface = surface_row + (x % material.size_x) * 4;
+                float frag_x = (float)x + 0.5f;
+
+                row.frag_x[x] = frag_x;
+                row.normal_x[x] = (float)surface[0] / 255.0f * 2.0f - 1.0f;
+                row.normal_y[x] = (float)surface[1] / 255.0f * 2.0f - 1.0f;
+                row.ao[x] = (float)surface[2] / 255.0f;
+
+                float view_x = eye_x - frag_x;
+                float view_y = eye_y - row.frag_y;
+                float view_length = sqrtf(view_x * view_x + view_y * view_y + 128.0f * 128.0f);
+                row.view_x[x] = view_x / view_length;
+                row.view_y[x] = view_y / view_length;
+                row.view_z[x] = 128.0f / view_length;
+
+                row.light_r[x] = params.ambient_light.r;
+                row.light_g[x] = params.ambient_light.g;
+                row.light_b[x] = params.ambient_light.b;
+            }
+
+            accumulate_lights(row, lights);
+
+            // Final
+            const unsigned char* albedo_row = material.albedo + (y % material.size_y) * material.size_x * 4;
+            unsigned char* pixel_row = pixels + y * params.size_x * 4;
+            for (uintmax_t x = 0; x < params.size_x; x++) {
+                const unsigned char* albedo = albedo_row + (x % material.size_x) * 4;
+                pixel_row[x * 4 + 0] = to_unorm8((float)albedo[0] / 255.0f * row.light_r[x]);
+                pixel_row[x * 4 + 1] = to_unorm8((float)albedo[1] / 255.0f * row.light_g[x]);
+                pixel_row[x * 4 + 2] = to_unorm8((float)albedo[2] / 255.0f * row.light_b[x]);
+                pixel_row[x * 4 + 3] = albedo[3];
+            }
+        }
+    }
+
+    void render_cpu_lighting(const CpuLightingParams& params, const CpuMaterialImage& material, const PointLight* point_lights, uintmax_t point_light_count,
+        unsigned char* pixels, CpuLightingKernel kernel, uintmax_t thread_count)
+    {
+        if (params.size_x == 0 || params.size_y == 0 || material.size_x == 0 || material.size_y == 0) return;
+
+        if (kernel == CPU_LIGHTING_KERNEL_BEST) {
+            kernel = is_cpu_lighting_kernel_supported(CPU_LIGHTING_KERNEL_AVX2) ? CPU_LIGHTING_KERNEL_AVX2
+                : is_cpu_lighting_kernel_supported(CPU_LIGHTING_KERNEL_SSE) ? CPU_LIGHTING_KERNEL_SSE : CPU_LIGHTING_KERNEL_SCALAR;
+        }
+        if (!is_cpu_lighting_kernel_supported(kernel)) {
+            log_warning("[CPU LIGHTING] " + (std::string)get_cpu_lighting_kernel_name(kernel) + " kernel is not supported, using scalar");
+            kernel = CPU_LIGHTING_KERNEL_SCALAR;
+        }
+
+        AccumulateLightsFunction accumulate_lights = accumulate_lights_scalar;
+#ifdef CPU_LIGHTING_X86
+        if (kernel == CPU_LIGHTING_KERNEL_SSE) accumulate_lights = accumulate_lights_sse;
+        if (kernel == CPU_LIGHTING_KERNEL_AVX2) accumulate_lights = accumulate_lights_avx2;
+#endif
+
+        CpuLightSoA lights;
+        build_light_soa(lights, point_lights, point_light_count);
+
+        if (thread_count == 0) thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+        thread_count = std::min(thread_count, params.size_y);
+
+        std::atomic<uintmax_t> next_row{ 0 };
+        std::vector<std::thread> threads;
+        for (uintmax_t i = 1; i < thread_count; i++) {
+            threads.emplace_back(render_cpu_lighting_rows, std::cref(params), std::cref(material), std::cref(lights), accumulate_lights, &next_row, pixels);
+        }
+        render_cpu_lighting_rows(params, material, lights, accumulate_lights, &next_row, pixels);
+        for (std::thread& thread : threads) thread.join();
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "logging.h"
+#include "lights.h"
+
+namespace Engine
+{
+    enum CpuLightingKernel {
+        CPU_LIGHTING_KERNEL_SCALAR,
+        CPU_LIGHTING_KERNEL_SSE,   // 4 pixels per iteration
+        CPU_LIGHTING_KERNEL_AVX2,  // 8 pixels per iteration, picked at runtime when the CPU supports it
+        CPU_LIGHTING_KERNEL_BEST,
+    };
+
+    // RGBA8 in atlas row order (flipped on load, like the texture loader), row 0 lands on the top of the viewport.
+    // `surface` uses the `MaterialAtlas` layout (normal.xy, ao, roughness)
+    struct CpuMaterialImage {
+        uintmax_t size_x = 0;
+        uintmax_t size_y = 0;
+        const unsigned char* albedo = nullptr;
+        const unsigned char* surface = nullptr;
+    };
+
+    // Mirrors the `generic.fs` uniforms, pixel (0, 0) is the top left of the viewport at world position (0, 0)
+    struct CpuLightingParams {
+        uintmax_t size_x = 0;
+        uintmax_t size_y = 0;
+        glm::vec3 ambient_light = glm::vec3(0.0f);
+        glm::vec2 camera_pos = glm::vec2(0.0f);
+    };
+
+    // Light data split per field, built once per call and shared by every kernel
+    struct CpuLightSoA {
+        std::vector<float> position_x, position_y, height, radius;
+        std::vector<float> attenuation_linear, attenuation_quadratic;
+        std::vector<float> color_r, color_g, color_b, energy;
+    };
+
+    // Reference for `generic.fs` without a GPU, the material tiles from the viewport origin like the background quad.
+    // Writes `size_x * size_y` RGBA8 pixels, top row first. `thread_count` of 0 uses all hardware threads
+    void render_cpu_lighting(const CpuLightingParams& params, const CpuMaterialImage& material, const PointLight* point_lights, uintmax_t point_light_count,
+        unsigned char* pixels, CpuLightingKernel kernel, uintmax_t thread_count);
+
+    bool is_cpu_lighting_kernel_supported(CpuLightingKernel kernel);
+    const char* get_cpu_lighting_kernel_name(CpuLightingKernel kernel);
+}
@@ -0,0 +1,126 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#ifdef ENGINE_COUNT_HEAP_ALLOCATIONS
+static thread_local uint64_t t_heap_allocation_count = 0;
+static thread_local bool t_heap_allocation_count_shared = false;
+static std::atomic<uint64_t> g_shared_heap_allocation_count{ 0 };
+
+// Replaces the global allocation functions, array and nothrow forms forward here. Over-aligned allocations are not counted
+void* operator new(size_t size)
+{
+    t_heap_allocation_count++;
+    if (t_heap_allocation_count_shared) g_shared_heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) size = 1;
+
+    while (true) {
+        void* pointer = std::malloc(size);
+        if (pointer) return pointer;
+
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t size) noexcept
+{
+    std::free(pointer);
+}
+#endif
+
+namespace Engine
+{
+    void create_frame_arena(FrameArena& arena, uintmax_t capacity)
+    {
+        arena.memory = (unsigned char*)std::malloc(capacity);
+        arena.capacity = arena.memory ? capacity : 0;
+        arena.offset = 0;
+        arena.overflow_blocks.reserve(FRAME_ARENA_OVERFLOW_BLOCK_CAPACITY);
+        if (!arena.memory) log_error("[ARENA] Failed to reserve " + std::to_string(capacity) + " bytes, every frame allocation goes to the heap");
+    }
+
+    void destroy_frame_arena(FrameArena& arena)
+    {
+        reset_frame_arena(arena);
+        log_debug("[ARENA] Peak frame usage " + std::to_string(arena.peak_size) + " of " + std::to_string(arena.capacity) + " bytes");
+        if (arena.total_overflow_count > 0) {
+            log_warning("[ARENA] " + std::to_string(arena.total_overflow_count) + " allocations overflowed to the heap, peak " + std::to_string(arena.peak_overflow_size) + " bytes in one frame");
+        }
+
+        std::free(arena.memory);
+        arena.memory = nullptr;
+        arena.capacity = 0;
+    }
+
+    void reset_frame_arena(FrameArena& arena)
+    {
+        arena.peak_size = std::max(arena.peak_size, std::min(arena.offset.load(std::memory_order_relaxed), arena.capacity));
+        arena.offset.store(0, std::memory_order_relaxed);
+
+        if (arena.overflow_blocks.empty()) return;
+
+        // Formatted on the writer thread, a reset on a checked frame must not allocate
+        if (arena.overflow_size > arena.peak_overflow_size) {
+            arena.peak_overflow_size = arena.overflow_size;
+            LOG_WARNING("[ARENA] Frame arena overflowed by {} bytes in {} allocations, raise its capacity above {}", arena.overflow_size, arena.overflow_blocks.size(), arena.capacity);
+        }
+        arena.total_overflow_count += arena.overflow_blocks.size();
+        for (void* block : arena.overflow_blocks) std::free(block);
+        arena.overflow_blocks.clear();
+        arena.overflow_size = 0;
+    }
+
+    void* allocate_from_frame_arena(FrameArena& arena, uintmax_t size, uintmax_t alignment)
+    {
+        // Worst case padding is reserved up front so the bump stays a single atomic add
+        uintmax_t reserved_size = size + alignment - 1;
+        uintmax_t offset = arena.offset.fetch_add(reserved_size, std::memory_order_relaxed);
+        if (offset + reserved_size <= arena.capacity) {
+            uintptr_t address = (uintptr_t)(arena.memory + offset);
+            return (void*)((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+        }
+
+        // malloc aligns for every fundamental type, larger alignments are not needed by frame data
+        std::lock_guard<std::mutex> lock(arena.overflow_mutex);
+        void* block = std::malloc(size > 0 ? size : 1);
+        if (!block) throw std::bad_alloc();
+        arena.overflow_blocks.push_back(block);
+        arena.overflow_size += size;
+        return block;
+    }
+
+    uint64_t get_heap_allocation_count()
+    {
+#ifdef ENGINE_COUNT_HEAP_ALLOCATIONS
+        return t_heap_allocation_count;
+#else
+        return 0;
+#endif
+    }
+
+    void share_heap_allocation_count()
+    {
+#ifdef ENGINE_COUNT_HEAP_ALLOCATIONS
+        t_heap_allocation_count_shared = true;
+#endif
+    }
+
+    uint64_t get_shared_heap_allocation_count()
+    {
+#ifdef ENGINE_COUNT_HEAP_ALLOCATIONS
+        return g_shared_heap_allocation_count.load(std::memory_order_relaxed);
+#else
+        return 0;
+#endif
+    }
+}
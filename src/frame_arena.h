@@ -0,0 +1,106 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include "logging.h"
+
+// Counts global `operator new` calls so the frame loop can check it and its jobs stay off the heap. A debug aid, only
+// built with ENGINE_DEBUG_HEAP_CHECK, which neither build script defines
+#ifdef ENGINE_DEBUG_HEAP_CHECK
+#define ENGINE_COUNT_HEAP_ALLOCATIONS
+#endif
+
+// Frames that may still grow persistent buffers before the frame loop counts as steady, a steady frame that allocates aborts
+#define FRAME_HEAP_CHECK_WARMUP_FRAMES 16
+
+// Overflow blocks one frame can take before tracking them allocates
+#define FRAME_ARENA_OVERFLOW_BLOCK_CAPACITY 256
+
+namespace Engine
+{
+    // Linear allocator for data that only lives until the end of the frame. Allocating is one atomic add so job
+    // threads can use it too, nothing is freed individually and `reset_frame_arena` drops everything at once
+    struct FrameArena {
+        unsigned char* memory = nullptr;
+        uintmax_t capacity = 0;
+        std::atomic<uintmax_t> offset{ 0 };
+        uintmax_t peak_size = 0;
+
+        // Requests past `capacity` fall back to `malloc` until the next reset, reported then as an overflow. The block
+        // list is reserved up front so an overflow does not also go through `operator new`
+        std::mutex overflow_mutex;
+        std::vector<void*> overflow_blocks;
+        uintmax_t overflow_size = 0;
+        uintmax_t peak_overflow_size = 0;
+        uintmax_t total_overflow_count = 0;  // Blocks over the arena's lifetime
+    };
+
+    void create_frame_arena(FrameArena& arena, uintmax_t capacity);
+    void destroy_frame_arena(FrameArena& arena);
+
+    // Invalidates everything allocated since the last reset
+    void reset_frame_arena(FrameArena& arena);
+
+    // `alignment` must be a power of two
+    void* allocate_from_frame_arena(FrameArena& arena, uintmax_t size, uintmax_t alignment);
+
+    template<typename T>
+    T* allocate_frame_array(FrameArena& arena, uintmax_t count)
+    {
+        return (T*)allocate_from_frame_arena(arena, count * sizeof(T), alignof(T));
+    }
+
+    // Standard allocator over a frame arena, `deallocate` is a no-op. Default constructed ones have no arena and must
+    // be replaced through `begin_frame_vector` before they allocate. Containers take the arena of the one assigned to them
+    template<typename T>
+    struct FrameAllocator {
+        typedef T value_type;
+        typedef std::true_type propagate_on_container_copy_assignment;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        FrameArena* arena;
+
+        FrameAllocator() : arena(nullptr) {}
+        FrameAllocator(FrameArena& arena) : arena(&arena) {}
+        template<typename U> FrameAllocator(const FrameAllocator<U>& other) : arena(other.arena) {}
+
+        T* allocate(size_t count) { return allocate_frame_array<T>(*arena, count); }
+        void deallocate(T* pointer, size_t count) {}
+    };
+
+    template<typename T, typename U>
+    bool operator==(const FrameAllocator<T>& a, const FrameAllocator<U>& b) { return a.arena == b.arena; }
+    template<typename T, typename U>
+    bool operator!=(const FrameAllocator<T>& a, const FrameAllocator<U>& b) { return a.arena != b.arena; }
+
+    // Transient list, must not outlive the frame it was filled in
+    template<typename T>
+    using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+    // Empties `vector` into a fresh block of `arena` as large as its last one, so a list that kept its size last frame
+    // does not grow again. The old contents are dropped untouched, their arena may have been reset since
+    template<typename T>
+    void begin_frame_vector(FrameVector<T>& vector, FrameArena& arena)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "FrameVector elements are never destroyed");
+        size_t capacity = vector.capacity();
+        vector = FrameVector<T>(FrameAllocator<T>(arena));
+        vector.reserve(capacity);
+    }
+
+    // Global `operator new` calls made by the calling thread so far, always 0 without ENGINE_COUNT_HEAP_ALLOCATIONS
+    uint64_t get_heap_allocation_count();
+
+    // Adds the calling thread's allocations to a count shared with other threads, job threads join it so the frame
+    // loop also sees the work it hands off
+    void share_heap_allocation_count();
+    // Made by every sharing thread so far, always 0 without ENGINE_COUNT_HEAP_ALLOCATIONS
+    uint64_t get_shared_heap_allocation_count();
+}
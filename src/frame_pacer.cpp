@@ -0,0 +1,122 @@
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <string>
+
+namespace Engine
+{
+    void start_frame_pacer(FramePacer& pacer, FramePacingMode mode, double target_fps)
+    {
+        pacer.mode = mode;
+        pacer.target_fps = target_fps > 0.0 ? target_fps : 60.0;
+        pacer.frequency = SDL_GetPerformanceFrequency();
+        pacer.frame_period = (uint64_t)((double)pacer.frequency / pacer.target_fps);
+        pacer.frame_times.reserve(FRAME_PACER_HISTORY_SIZE);
+
+        int swap_interval = 0;
+        if (mode == FRAME_PACING_VSYNC) swap_interval = 1;
+        else if (mode == FRAME_PACING_ADAPTIVE) swap_interval = -1;
+
+        if (!SDL_GL_GetCurrentContext()) {
+            // Headless, there is no swap chain and the mode only decides whether the limiter runs
+            if (mode == FRAME_PACING_VSYNC || mode == FRAME_PACING_ADAPTIVE) pacer.mode = FRAME_PACING_UNCAPPED;
+        } else if (SDL_GL_SetSwapInterval(swap_interval) != 0) {
+            if (mode == FRAME_PACING_ADAPTIVE) {
+                log_warning("[PACER] Adaptive sync unsupported, using vsync\n SDL Error: " + (std::string)SDL_GetError());
+                pacer.mode = FRAME_PACING_VSYNC;
+                SDL_GL_SetSwapInterval(1);
+            } else {
+                log_warning("[PACER] Failed to set swap interval " + std::to_string(swap_interval) + "\n SDL Error: " + (std::string)SDL_GetError());
+            }
+        }
+
+        pacer.last_frame_counter = SDL_GetPerformanceCounter();
+        pacer.next_deadline = pacer.last_frame_counter + pacer.frame_period;
+
+        std::string mode_name = get_frame_pacing_mode_name(pacer.mode);
+        if (pacer.mode == FRAME_PACING_LIMITED) mode_name += " " + std::to_string(pacer.target_fps) + " fps";
+        log_info("[PACER] Frame pacing: " + mode_name);
+    }
+
+    static void wait_until(const FramePacer& pacer, uint64_t deadline)
+    {
+        // Coarse sleep while far away, the scheduler may oversleep by a couple of milliseconds
+        uint64_t now = SDL_GetPerformanceCounter();
+        while (now < deadline) {
+            double remaining_ms = (double)(deadline - now) * 1000.0 / (double)pacer.frequency;
+            if (remaining_ms <= FRAME_PACER_SPIN_MARGIN_MS) break;
+            SDL_Delay((Uint32)(remaining_ms - FRAME_PACER_SPIN_MARGIN_MS));
+            now = SDL_GetPerformanceCounter();
+        }
+
+        // Spin the rest for sub-millisecond accuracy
+        while (SDL_GetPerformanceCounter() < deadline);
+    }
+
+    void pace_frame(FramePacer& pacer)
+    {
+        PROFILE_ZONE("Frame pacing");
+        if (pacer.mode == FRAME_PACING_LIMITED) {
+            wait_until(pacer, pacer.next_deadline);
+
+            // Deadlines advance by whole periods so the average rate holds, a long hitch resets them instead of bursting
+            uint64_t now = SDL_GetPerformanceCounter();
+            pacer.next_deadline += pacer.frame_period;
+            if (now > pacer.next_deadline) pacer.next_deadline = now + pacer.frame_period;
+        }
+
+        uint64_t now = SDL_GetPerformanceCounter();
+        double frame_time_ms = (double)(now - pacer.last_frame_counter) * 1000.0 / (double)pacer.frequency;
+        pacer.last_frame_counter = now;
+
+        if (pacer.frame_times.size() < FRAME_PACER_HISTORY_SIZE) {
+            pacer.frame_times.push_back(frame_time_ms);
+        } else {
+            pacer.frame_times[pacer.next_frame_time] = frame_time_ms;
+        }
+        pacer.next_frame_time = (pacer.next_frame_time + 1) % FRAME_PACER_HISTORY_SIZE;
+    }
+
+    FramePacerStats get_frame_pacer_stats(const FramePacer& pacer)
+    {
+        FramePacerStats stats;
+        stats.frame_count = pacer.frame_times.size();
+        if (stats.frame_count == 0) return stats;
+
+        std::vector<double> sorted_frame_times = pacer.frame_times;
+        std::sort(sorted_frame_times.begin(), sorted_frame_times.end());
+
+        double total_ms = 0.0;
+        for (double frame_time_ms : sorted_frame_times) total_ms += frame_time_ms;
+
+        stats.mean_ms = total_ms / (double)stats.frame_count;
+        stats.p99_ms = sorted_frame_times[std::min(stats.frame_count - 1, (stats.frame_count * 99) / 100)];
+        stats.max_ms = sorted_frame_times.back();
+        return stats;
+    }
+
+    void log_frame_pacer_stats(const FramePacer& pacer)
+    {
+        FramePacerStats stats = get_frame_pacer_stats(pacer);
+        if (stats.frame_count == 0) return;
+
+        LOG_INFO("[PACER] {} frames: mean {} ms ({} fps), p99 {} ms, max {} ms", stats.frame_count, stats.mean_ms, 1000.0 / stats.mean_ms, stats.p99_ms, stats.max_ms);
+    }
+
+    void reset_frame_pacer_stats(FramePacer& pacer)
+    {
+        pacer.frame_times.clear();
+        pacer.next_frame_time = 0;
+    }
+
+    const char* get_frame_pacing_mode_name(FramePacingMode mode)
+    {
+        switch (mode) {
+            case FRAME_PACING_VSYNC:    return "vsync";
+            case FRAME_PACING_ADAPTIVE: return "adaptive";
+            case FRAME_PACING_UNCAPPED: return "uncapped";
+            case FRAME_PACING_LIMITED:  return "limited";
+            default:                    return "unknown";
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+#include "logging.h"
+#include "profiler.h"
+
+// Frame times kept for the statistics
+#define FRAME_PACER_HISTORY_SIZE 1024
+// The limiter sleeps until this close to the deadline, then spins. Covers the scheduler granularity
+#define FRAME_PACER_SPIN_MARGIN_MS 2.0
+
+namespace Engine
+{
+    enum FramePacingMode {
+        FRAME_PACING_VSYNC,     // Swap interval 1
+        FRAME_PACING_ADAPTIVE,  // Swap interval -1, tears instead of stalling on a missed vblank. Falls back to vsync
+        FRAME_PACING_UNCAPPED,  // Swap interval 0, for throughput benchmarks
+        FRAME_PACING_LIMITED,   // Swap interval 0 with a sleep/spin limiter at `target_fps`
+    };
+
+    struct FramePacerStats {
+        uintmax_t frame_count = 0;  // Frames in the window, at most `FRAME_PACER_HISTORY_SIZE`
+        double mean_ms = 0.0;
+        double p99_ms = 0.0;
+        double max_ms = 0.0;
+    };
+
+    struct FramePacer {
+        FramePacingMode mode = FRAME_PACING_VSYNC;
+        double target_fps = 60.0;
+
+        uint64_t frequency = 0;
+        uint64_t frame_period = 0;       // Counter ticks, limiter only
+        uint64_t next_deadline = 0;
+        uint64_t last_frame_counter = 0;
+
+        std::vector<double> frame_times;  // Ring of the last frame times in ms
+        uintmax_t next_frame_time = 0;
+    };
+
+    // Expects a current OpenGL context, sets the swap interval for `mode`
+    void start_frame_pacer(FramePacer& pacer, FramePacingMode mode, double target_fps);
+
+    // Call once per frame right after the swap, waits when limiting and records the frame time
+    void pace_frame(FramePacer& pacer);
+
+    FramePacerStats get_frame_pacer_stats(const FramePacer& pacer);
+    void log_frame_pacer_stats(const FramePacer& pacer);
+    void reset_frame_pacer_stats(FramePacer& pacer);
+
+    const char* get_frame_pacing_mode_name(FramePacingMode mode);
+}
@@ -0,0 +1,190 @@
+#include "frame_recorder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#include <SDL2/SDL.h>
+
+#include "image_writer.h"
+
+namespace Engine
+{
+    static double get_elapsed_ms(uint64_t start_counter)
+    {
+        return (double)(SDL_GetPerformanceCounter() - start_counter) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+    }
+
+    static std::string get_frame_path(const FrameRecorder& recorder, uintmax_t frame_index)
+    {
+        std::string number = std::to_string(frame_index);
+        if (number.size() < 6) number.insert(0, 6 - number.size(), '0');
+
+        return recorder.output_directory + "/frame_" + number + (recorder.format == FRAME_FORMAT_PNG ? ".png" : ".raw");
+    }
+
+    static void frame_writer_worker(FrameRecorder* recorder)
+    {
+        while (true) {
+            RecordedFrame frame;
+            {
+                std::unique_lock<std::mutex> lock(recorder->queue_mutex);
+                recorder->queue_condition.wait(lock, [recorder]() { return recorder->stopping || recorder->queue_count > 0; });
+                if (recorder->queue_count == 0) return;  // Stopping and drained
+
+                frame = std::move(recorder->queue[recorder->queue_head]);
+                recorder->queue_head = (recorder->queue_head + 1) % FRAME_RECORDER_MAX_QUEUED_FRAMES;
+                recorder->queue_count--;
+            }
+            recorder->space_condition.notify_one();
+
+            std::string path = get_frame_path(*recorder, frame.frame_index);
+            bool written = (recorder->format == FRAME_FORMAT_PNG)
+                ? write_png_image(path, recorder->size_x, recorder->size_y, frame.pixels.data(), true)
+                : write_raw_image(path, recorder->size_x, recorder->size_y, frame.pixels.data(), true);
+
+            if (written) recorder->written_count++;
+            else recorder->failed_count++;
+
+            std::lock_guard<std::mutex> lock(recorder->queue_mutex);
+            recorder->free_pixels.push_back(std::move(frame.pixels));
+        }
+    }
+
+    bool start_frame_recorder(FrameRecorder& recorder, uintmax_t size_x, uintmax_t size_y, const std::string& output_directory, FrameFormat format, uintmax_t thread_count)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(output_directory, error);
+        if (error) {
+            log_error("[RECORD] Failed to create `" + output_directory + "`: " + error.message());
+            return false;
+        }
+
+        recorder.size_x = size_x;
+        recorder.size_y = size_y;
+        recorder.output_directory = output_directory;
+        recorder.format = format;
+
+        uintmax_t frame_size = size_x * size_y * 4;
+        glGenBuffers(FRAME_RECORDER_PBO_COUNT, recorder.pixel_buffers);
+        for (GLuint pixel_buffer : recorder.pixel_buffers) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)frame_size, NULL, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        if (thread_count == 0) thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+        // As many as can be in flight at once: a full queue, one per writer and the one the GL thread is retiring.
+        // Capturing then never allocates, however far the writers fall behind
+        uintmax_t pixel_buffer_count = FRAME_RECORDER_MAX_QUEUED_FRAMES + thread_count + 1;
+        recorder.free_pixels.reserve(pixel_buffer_count);
+        for (uintmax_t i = 0; i < pixel_buffer_count; i++) recorder.free_pixels.emplace_back(frame_size);
+
+        for (uintmax_t i = 0; i < thread_count; i++) {
+            recorder.workers.emplace_back(frame_writer_worker, &recorder);
+        }
+
+        recorder.start_counter = SDL_GetPerformanceCounter();
+
+        log_info("[RECORD] Recording " + std::to_string(size_x) + "x" + std::to_string(size_y) + " " + (format == FRAME_FORMAT_PNG ? "PNG" : "raw RGBA8") +
+            " frames to `" + output_directory + "` with " + std::to_string(thread_count) + " writer threads");
+        return true;
+    }
+
+    // Copies the readback in `slot` out of its pixel buffer and hands it to the writers
+    static void retire_pixel_buffer(FrameRecorder& recorder, uintmax_t slot)
+    {
+        GLsync& fence = recorder.fences[slot];
+        if (!fence) return;
+
+        uint64_t wait_start_counter = SDL_GetPerformanceCounter();
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+        glDeleteSync(fence);
+        fence = 0;
+
+        // Recycled, `start_frame_recorder` made one for every frame that can be in flight
+        RecordedFrame frame;
+        frame.frame_index = recorder.frame_indices[slot];
+        {
+            std::lock_guard<std::mutex> lock(recorder.queue_mutex);
+            if (!recorder.free_pixels.empty()) {
+                frame.pixels = std::move(recorder.free_pixels.back());
+                recorder.free_pixels.pop_back();
+            }
+        }
+        frame.pixels.resize(recorder.size_x * recorder.size_y * 4);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, recorder.pixel_buffers[slot]);
+        const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)frame.pixels.size(), GL_MAP_READ_BIT);
+        if (pixels) {
+            memcpy(frame.pixels.data(), pixels, frame.pixels.size());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        } else {
+            LOG_ERROR("[RECORD] Failed to map the readback of frame {}", frame.frame_index);
+            recorder.failed_count++;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        recorder.readback_wait_ms += get_elapsed_ms(wait_start_counter);
+
+        if (!pixels) return;
+
+        uint64_t queue_start_counter = SDL_GetPerformanceCounter();
+        {
+            std::unique_lock<std::mutex> lock(recorder.queue_mutex);
+            recorder.space_condition.wait(lock, [&recorder]() { return recorder.queue_count < FRAME_RECORDER_MAX_QUEUED_FRAMES; });
+            recorder.queue[(recorder.queue_head + recorder.queue_count) % FRAME_RECORDER_MAX_QUEUED_FRAMES] = std::move(frame);
+            recorder.queue_count++;
+        }
+        recorder.queue_condition.notify_one();
+        recorder.queue_wait_ms += get_elapsed_ms(queue_start_counter);
+    }
+
+    void capture_frame(FrameRecorder& recorder, GLuint framebuffer, uintmax_t frame_index)
+    {
+        PROFILE_ZONE("Frame capture");
+        uintmax_t slot = recorder.next_pixel_buffer;
+        recorder.next_pixel_buffer = (slot + 1) % FRAME_RECORDER_PBO_COUNT;
+
+        // Issued `FRAME_RECORDER_PBO_COUNT` frames ago, normally finished already
+        retire_pixel_buffer(recorder, slot);
+
+        // Into the pixel buffer, `glReadPixels` returns without waiting for the GPU
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, recorder.pixel_buffers[slot]);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, (GLsizei)recorder.size_x, (GLsizei)recorder.size_y, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        recorder.fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        recorder.frame_indices[slot] = frame_index;
+        recorder.captured_count++;
+    }
+
+    void stop_frame_recorder(FrameRecorder& recorder)
+    {
+        // Oldest first so the writers receive the frames in order
+        for (uintmax_t i = 0; i < FRAME_RECORDER_PBO_COUNT; i++) {
+            retire_pixel_buffer(recorder, (recorder.next_pixel_buffer + i) % FRAME_RECORDER_PBO_COUNT);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(recorder.queue_mutex);
+            recorder.stopping = true;
+        }
+        recorder.queue_condition.notify_all();
+        for (std::thread& worker : recorder.workers) worker.join();
+        recorder.workers.clear();
+
+        glDeleteBuffers(FRAME_RECORDER_PBO_COUNT, recorder.pixel_buffers);
+        std::fill(std::begin(recorder.pixel_buffers), std::end(recorder.pixel_buffers), 0);
+
+        double elapsed_ms = get_elapsed_ms(recorder.start_counter);
+        log_info("[RECORD] " + std::to_string(recorder.written_count.load()) + "/" + std::to_string(recorder.captured_count) + " frames written in " +
+            std::to_string(elapsed_ms / 1000.0) + " s (" + std::to_string((double)recorder.written_count.load() * 1000.0 / elapsed_ms) + " fps)");
+        log_info("[RECORD] GL thread blocked " + std::to_string(recorder.readback_wait_ms) + " ms on readbacks, " + std::to_string(recorder.queue_wait_ms) + " ms on the writers");
+        if (recorder.failed_count.load() > 0) {
+            log_error("[RECORD] " + std::to_string(recorder.failed_count.load()) + " frames failed");
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "logging.h"
+#include "profiler.h"
+
+// Frames between `glReadPixels` and the CPU copy, the copy only blocks if the GPU is this many frames behind
+#define FRAME_RECORDER_PBO_COUNT 4
+// Copied frames waiting on the writers before capturing blocks, bounds memory when the disk is the bottleneck
+#define FRAME_RECORDER_MAX_QUEUED_FRAMES 16
+
+namespace Engine
+{
+    enum FrameFormat {
+        FRAME_FORMAT_PNG,
+        FRAME_FORMAT_RAW,  // RGBA8, top row first, no header
+    };
+
+    struct RecordedFrame {
+        uintmax_t frame_index = 0;
+        std::vector<unsigned char> pixels;  // Bottom row first, as read back
+    };
+
+    struct FrameRecorder {
+        uintmax_t size_x = 0;
+        uintmax_t size_y = 0;
+        std::string output_directory;
+        FrameFormat format = FRAME_FORMAT_PNG;
+
+        // Readback ring, GL thread only
+        GLuint pixel_buffers[FRAME_RECORDER_PBO_COUNT] = {};
+        GLsync fences[FRAME_RECORDER_PBO_COUNT] = {};
+        uintmax_t frame_indices[FRAME_RECORDER_PBO_COUNT] = {};
+        uintmax_t next_pixel_buffer = 0;
+
+        // Writers
+        std::vector<std::thread> workers;
+        std::mutex queue_mutex;
+        std::condition_variable queue_condition;  // Writers wait for frames
+        std::condition_variable space_condition;  // GL thread waits for room in the queue
+        RecordedFrame queue[FRAME_RECORDER_MAX_QUEUED_FRAMES];  // Ring
+        uintmax_t queue_head = 0;
+        uintmax_t queue_count = 0;
+        std::vector<std::vector<unsigned char>> free_pixels;  // Buffers handed back by the writers, reused for later frames
+        bool stopping = false;
+
+        std::atomic<uintmax_t> written_count{ 0 };
+        std::atomic<uintmax_t> failed_count{ 0 };
+
+        // Statistics, GL thread only
+        uintmax_t captured_count = 0;
+        uint64_t start_counter = 0;
+        double readback_wait_ms = 0.0;
+        double queue_wait_ms = 0.0;
+    };
+
+    // `thread_count` of 0 uses all hardware threads. Expects a current OpenGL context
+    bool start_frame_recorder(FrameRecorder& recorder, uintmax_t size_x, uintmax_t size_y, const std::string& output_directory, FrameFormat format, uintmax_t thread_count);
+
+    // Queues an asynchronous readback of `framebuffer`, call after the frame is drawn and before presenting
+    void capture_frame(FrameRecorder& recorder, GLuint framebuffer, uintmax_t frame_index);
+
+    // Finishes every readback and waits for the writers
+    void stop_frame_recorder(FrameRecorder& recorder);
+}
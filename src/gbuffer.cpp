@@ -0,0 +1,57 @@
+#include "gbuffer.h"
+
+#include <string>
+
+namespace Engine
+{
+    static GLuint create_gbuffer_attachment(uintmax_t size_x, uintmax_t size_y, GLenum attachment)
+    {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, (GLsizei)size_x, (GLsizei)size_y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+
+        return texture;
+    }
+
+    bool create_gbuffer(GBuffer& gbuffer, uintmax_t size_x, uintmax_t size_y)
+    {
+        log_debug("[GBUFFER] Creating " + std::to_string(size_x) + "x" + std::to_string(size_y) + " G-buffer");
+
+        gbuffer.size_x = size_x;
+        gbuffer.size_y = size_y;
+
+        glGenFramebuffers(1, &gbuffer.framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, gbuffer.framebuffer);
+
+        gbuffer.albedo_texture = create_gbuffer_attachment(size_x, size_y, GL_COLOR_ATTACHMENT0);
+        gbuffer.surface_texture = create_gbuffer_attachment(size_x, size_y, GL_COLOR_ATTACHMENT1);
+
+        const GLenum draw_buffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, draw_buffers);
+
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            log_error("[GBUFFER] Framebuffer is incomplete (status " + std::to_string(status) + ")");
+            destroy_gbuffer(gbuffer);
+            return false;
+        }
+
+        return true;
+    }
+
+    void destroy_gbuffer(GBuffer& gbuffer)
+    {
+        glDeleteFramebuffers(1, &gbuffer.framebuffer);
+        glDeleteTextures(1, &gbuffer.albedo_texture);
+        glDeleteTextures(1, &gbuffer.surface_texture);
+        gbuffer = GBuffer();
+    }
+}
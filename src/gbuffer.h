@@ -0,0 +1,23 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <glad/glad.h>
+
+#include "logging.h"
+
+namespace Engine
+{
+    // Attachment 0, RGBA8: albedo.rgb, alpha (0 where nothing was drawn)
+    // Attachment 1, RGBA8: normal.xy in [0, 1] encoding, ao, roughness
+    struct GBuffer {
+        uintmax_t size_x = 0;
+        uintmax_t size_y = 0;
+        GLuint framebuffer = 0;
+        GLuint albedo_texture = 0;
+        GLuint surface_texture = 0;
+    };
+
+    bool create_gbuffer(GBuffer& gbuffer, uintmax_t size_x, uintmax_t size_y);
+    void destroy_gbuffer(GBuffer& gbuffer);
+}
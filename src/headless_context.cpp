@@ -0,0 +1,153 @@
+#include "headless_context.h"
+
+#include <cstring>
+#include <string>
+
+#ifdef ENGINE_HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace Engine
+{
+#ifdef ENGINE_HEADLESS_EGL
+    static bool has_egl_extension(const char* extensions, const char* name)
+    {
+        if (!extensions) return false;
+
+        uintmax_t name_length = strlen(name);
+        for (const char* match = strstr(extensions, name); match; match = strstr(match + name_length, name)) {
+            bool starts = (match == extensions || match[-1] == ' ');
+            bool ends = (match[name_length] == ' ' || match[name_length] == '\0');
+            if (starts && ends) return true;
+        }
+        return false;
+    }
+
+    static EGLDisplay get_headless_display()
+    {
+        // Mesa surfaceless needs neither a display server nor a GPU, llvmpipe is picked when no DRI device is present
+        const char* client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (has_egl_extension(client_extensions, "EGL_MESA_platform_surfaceless")) {
+            PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+            if (get_platform_display) {
+                EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+                if (display != EGL_NO_DISPLAY) return display;
+            }
+        }
+
+        log_debug("[HEADLESS] Surfaceless platform unavailable, using the default EGL display");
+        return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    bool create_headless_context(HeadlessContext& context, uintmax_t size_x, uintmax_t size_y)
+    {
+        EGLDisplay display = get_headless_display();
+        EGLint major_version = 0, minor_version = 0;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major_version, &minor_version)) {
+            log_critical("[HEADLESS] Failed to initialize EGL (EGL error " + std::to_string(eglGetError()) + ")");
+            return false;
+        }
+        log_debug("[HEADLESS] EGL " + std::to_string(major_version) + "." + std::to_string(minor_version) + ", " + (std::string)eglQueryString(display, EGL_VENDOR));
+
+        if (!has_egl_extension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")) {
+            log_critical("[HEADLESS] EGL_KHR_surfaceless_context is not supported");
+            eglTerminate(display);
+            return false;
+        }
+
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            log_critical("[HEADLESS] Desktop OpenGL is not available through EGL");
+            eglTerminate(display);
+            return false;
+        }
+
+        const EGLint config_attributes[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_SURFACE_TYPE, 0,
+            EGL_NONE
+        };
+        EGLConfig config;
+        EGLint config_count = 0;
+        if (!eglChooseConfig(display, config_attributes, &config, 1, &config_count) || config_count == 0) {
+            log_critical("[HEADLESS] No EGL config with desktop OpenGL support");
+            eglTerminate(display);
+            return false;
+        }
+
+        // Same version and profile as the windowed context
+        const EGLint context_attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        EGLContext egl_context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+        if (egl_context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context)) {
+            log_critical("[HEADLESS] Failed to create an OpenGL 3.3 core context (EGL error " + std::to_string(eglGetError()) + ")");
+            if (egl_context != EGL_NO_CONTEXT) eglDestroyContext(display, egl_context);
+            eglTerminate(display);
+            return false;
+        }
+
+        context.display = display;
+        context.context = egl_context;
+
+        if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+            log_critical("[HEADLESS] Failed to initialize GLAD OpenGL loader!");
+            destroy_headless_context(context);
+            return false;
+        }
+        context.load_proc = (GLADloadproc)eglGetProcAddress;
+        log_info("[HEADLESS] " + (std::string)(const char*)glGetString(GL_RENDERER) + ", " + (std::string)(const char*)glGetString(GL_VERSION));
+
+        // Stands in for the default framebuffer, there is no surface to draw to
+        context.size_x = size_x;
+        context.size_y = size_y;
+
+        glGenRenderbuffers(1, &context.color_renderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, context.color_renderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, (GLsizei)size_x, (GLsizei)size_y);
+
+        glGenFramebuffers(1, &context.framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, context.framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, context.color_renderbuffer);
+
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            log_critical("[HEADLESS] Offscreen framebuffer is incomplete (status " + std::to_string(status) + ")");
+            destroy_headless_context(context);
+            return false;
+        }
+
+        glViewport(0, 0, (GLsizei)size_x, (GLsizei)size_y);
+        log_info("[HEADLESS] Rendering offscreen at " + std::to_string(size_x) + "x" + std::to_string(size_y));
+        return true;
+    }
+
+    void destroy_headless_context(HeadlessContext& context)
+    {
+        if (context.context) {
+            if (context.framebuffer) glDeleteFramebuffers(1, &context.framebuffer);
+            if (context.color_renderbuffer) glDeleteRenderbuffers(1, &context.color_renderbuffer);
+
+            eglMakeCurrent((EGLDisplay)context.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext((EGLDisplay)context.display, (EGLContext)context.context);
+        }
+        if (context.display) eglTerminate((EGLDisplay)context.display);
+
+        context = HeadlessContext();
+    }
+#else
+    bool create_headless_context(HeadlessContext& context, uintmax_t size_x, uintmax_t size_y)
+    {
+        log_critical("[HEADLESS] Built without ENGINE_HEADLESS_EGL, headless rendering is unavailable");
+        return false;
+    }
+
+    void destroy_headless_context(HeadlessContext& context)
+    {
+        context = HeadlessContext();
+    }
+#endif
+}
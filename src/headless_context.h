@@ -0,0 +1,26 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <glad/glad.h>
+
+#include "logging.h"
+
+// Build with `ENGINE_HEADLESS_EGL` defined and link `libEGL` to enable, see `compile.sh`
+namespace Engine
+{
+    // OpenGL 3.3 core context without a window, rendering into an offscreen framebuffer
+    struct HeadlessContext {
+        void* display = nullptr;  // EGLDisplay
+        void* context = nullptr;  // EGLContext
+        uintmax_t size_x = 0;
+        uintmax_t size_y = 0;
+        GLuint framebuffer = 0;
+        GLuint color_renderbuffer = 0;
+        GLADloadproc load_proc = nullptr;  // eglGetProcAddress, for entry points GLAD does not load
+    };
+
+    // Makes the context current and loads OpenGL through GLAD
+    bool create_headless_context(HeadlessContext& context, uintmax_t size_x, uintmax_t size_y);
+    void destroy_headless_context(HeadlessContext& context);
+}
@@ -0,0 +1,135 @@
+#include "image_writer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#define PNG_MAX_STORED_BLOCK_SIZE 65535
+
+namespace Engine
+{
+    static uint32_t s_crc_table[256];
+
+    static uint32_t update_crc(uint32_t crc, const unsigned char* data, uintmax_t size)
+    {
+        for (uintmax_t i = 0; i < size; i++) crc = s_crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return crc;
+    }
+
+    static void append_u32_be(std::vector<unsigned char>& bytes, uint32_t value)
+    {
+        bytes.push_back((unsigned char)(value >> 24));
+        bytes.push_back((unsigned char)(value >> 16));
+        bytes.push_back((unsigned char)(value >> 8));
+        bytes.push_back((unsigned char)value);
+    }
+
+    static void append_png_chunk(std::vector<unsigned char>& bytes, const char* type, const std::vector<unsigned char>& data)
+    {
+        append_u32_be(bytes, (uint32_t)data.size());
+
+        uintmax_t type_offset = bytes.size();
+        bytes.insert(bytes.end(), type, type + 4);
+        bytes.insert(bytes.end(), data.begin(), data.end());
+
+        uint32_t crc = update_crc(0xFFFFFFFFu, &bytes[type_offset], 4 + data.size());
+        append_u32_be(bytes, crc ^ 0xFFFFFFFFu);
+    }
+
+    bool write_png_image(const std::string& path, uintmax_t size_x, uintmax_t size_y, const unsigned char* pixels, bool bottom_up)
+    {
+        // Filled once, writers on several threads would race on the first call otherwise
+        static const bool crc_table_ready = []() {
+            for (uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                s_crc_table[n] = c;
+            }
+            return true;
+        }();
+        (void)crc_table_ready;
+
+        // Scanlines, each prefixed with filter type 0 (none)
+        uintmax_t row_size = size_x * 4;
+        std::vector<unsigned char> scanlines((row_size + 1) * size_y);
+        for (uintmax_t y = 0; y < size_y; y++) {
+            const unsigned char* row = pixels + (bottom_up ? (size_y - 1 - y) : y) * row_size;
+            unsigned char* scanline = &scanlines[y * (row_size + 1)];
+            scanline[0] = 0;
+            memcpy(scanline + 1, row, row_size);
+        }
+
+        // zlib stream of stored deflate blocks
+        std::vector<unsigned char> image_data;
+        image_data.reserve(scanlines.size() + scanlines.size() / PNG_MAX_STORED_BLOCK_SIZE * 5 + 16);
+        image_data.push_back(0x78);
+        image_data.push_back(0x01);
+
+        uint32_t adler_a = 1, adler_b = 0;
+        uintmax_t offset = 0;
+        do {
+            uintmax_t block_size = std::min((uintmax_t)PNG_MAX_STORED_BLOCK_SIZE, (uintmax_t)scanlines.size() - offset);
+            bool last_block = offset + block_size == scanlines.size();
+
+            image_data.push_back(last_block ? 1 : 0);
+            image_data.push_back((unsigned char)block_size);
+            image_data.push_back((unsigned char)(block_size >> 8));
+            image_data.push_back((unsigned char)~block_size);
+            image_data.push_back((unsigned char)(~block_size >> 8));
+            image_data.insert(image_data.end(), scanlines.begin() + offset, scanlines.begin() + offset + block_size);
+
+            // 5552 bytes is the most that can be summed before the 32-bit sums may overflow
+            for (uintmax_t chunk = offset; chunk < offset + block_size; chunk += 5552) {
+                uintmax_t chunk_end = std::min(chunk + 5552, offset + block_size);
+                for (uintmax_t i = chunk; i < chunk_end; i++) {
+                    adler_a += scanlines[i];
+                    adler_b += adler_a;
+                }
+                adler_a %= 65521;
+                adler_b %= 65521;
+            }
+            offset += block_size;
+        } while (offset < scanlines.size());
+        append_u32_be(image_data, (adler_b << 16) | adler_a);
+
+        std::vector<unsigned char> header;
+        append_u32_be(header, (uint32_t)size_x);
+        append_u32_be(header, (uint32_t)size_y);
+        header.push_back(8);  // Bit depth
+        header.push_back(6);  // RGBA
+        header.push_back(0);  // Compression, filter and interlace methods
+        header.push_back(0);
+        header.push_back(0);
+
+        std::vector<unsigned char> bytes = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        bytes.reserve(image_data.size() + 64);
+        append_png_chunk(bytes, "IHDR", header);
+        append_png_chunk(bytes, "IDAT", image_data);
+        append_png_chunk(bytes, "IEND", std::vector<unsigned char>());
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file) {
+            LOG_ERROR("[IMAGE] Failed to open `{}` for writing", path);
+            return false;
+        }
+        file.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+        return (bool)file;
+    }
+
+    bool write_raw_image(const std::string& path, uintmax_t size_x, uintmax_t size_y, const unsigned char* pixels, bool bottom_up)
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file) {
+            LOG_ERROR("[IMAGE] Failed to open `{}` for writing", path);
+            return false;
+        }
+
+        uintmax_t row_size = size_x * 4;
+        for (uintmax_t y = 0; y < size_y; y++) {
+            const unsigned char* row = pixels + (bottom_up ? (size_y - 1 - y) : y) * row_size;
+            file.write((const char*)row, (std::streamsize)row_size);
+        }
+        return (bool)file;
+    }
+}
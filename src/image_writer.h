@@ -0,0 +1,18 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <string>
+
+#include "logging.h"
+
+namespace Engine
+{
+    // RGBA8 rows, `bottom_up` for rows as returned by `glReadPixels`. Returns false if the file could not be written
+
+    // Stored (uncompressed) deflate, cheap to encode so the writers stay IO bound
+    bool write_png_image(const std::string& path, uintmax_t size_x, uintmax_t size_y, const unsigned char* pixels, bool bottom_up);
+
+    // Headerless, top row first
+    bool write_raw_image(const std::string& path, uintmax_t size_x, uintmax_t size_y, const unsigned char* pixels, bool bottom_up);
+}
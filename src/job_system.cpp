@@ -0,0 +1,353 @@
+#include "job_system.h"
+#include "frame_arena.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <string>
+
+namespace Engine
+{
+    // The system and deque of the current thread, null on threads the system does not own
+    static thread_local JobSystem* t_job_system = nullptr;
+    static thread_local JobWorker* t_job_worker = nullptr;
+
+    static bool push_job(JobDeque& deque, const Job& job)
+    {
+        intmax_t bottom = deque.bottom.load(std::memory_order_relaxed);
+        intmax_t top = deque.top.load(std::memory_order_acquire);
+        if (bottom - top >= JOB_SYSTEM_DEQUE_CAPACITY) return false;
+
+        JobSlot& slot = deque.slots[bottom & (JOB_SYSTEM_DEQUE_CAPACITY - 1)];
+        slot.function.store(job.function, std::memory_order_relaxed);
+        slot.data.store(job.data, std::memory_order_relaxed);
+        slot.counter.store(job.counter, std::memory_order_relaxed);
+
+        deque.bottom.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    static inline void read_job_slot(const JobSlot& slot, Job& job)
+    {
+        job.function = slot.function.load(std::memory_order_relaxed);
+        job.data = slot.data.load(std::memory_order_relaxed);
+        job.counter = slot.counter.load(std::memory_order_relaxed);
+    }
+
+    // Owner only
+    static bool pop_job(JobDeque& deque, Job& job)
+    {
+        intmax_t bottom = deque.bottom.load(std::memory_order_relaxed) - 1;
+        deque.bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        intmax_t top = deque.top.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            deque.bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        read_job_slot(deque.slots[bottom & (JOB_SYSTEM_DEQUE_CAPACITY - 1)], job);
+        if (top < bottom) return true;
+
+        // Last job, race the thieves for it
+        bool won = deque.top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        deque.bottom.store(bottom + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    static bool steal_job(JobDeque& deque, Job& job)
+    {
+        intmax_t top = deque.top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        intmax_t bottom = deque.bottom.load(std::memory_order_acquire);
+        if (top >= bottom) return false;
+
+        read_job_slot(deque.slots[top & (JOB_SYSTEM_DEQUE_CAPACITY - 1)], job);
+        return deque.top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    static bool pop_background_job(JobSystem& system, Job& job)
+    {
+        if (system.background_pending.load(std::memory_order_acquire) == 0) return false;
+
+        std::lock_guard<std::mutex> lock(system.background_mutex);
+        if (system.background_count == 0) return false;
+
+        job = system.background_jobs[system.background_head];
+        system.background_head = (system.background_head + 1) % JOB_SYSTEM_BACKGROUND_CAPACITY;
+        system.background_count--;
+        system.background_pending.store(system.background_count, std::memory_order_release);
+        return true;
+    }
+
+    static bool find_job(JobSystem& system, JobWorker& worker, Job& job)
+    {
+        if (pop_job(worker.deque, job)) return true;
+        if (worker.index != 0 && pop_background_job(system, job)) return true;
+
+        // Random victims, xorshift
+        uintmax_t worker_count = system.workers.size();
+        for (uintmax_t attempt = 0; attempt < worker_count; attempt++) {
+            worker.random_state ^= worker.random_state << 13;
+            worker.random_state ^= worker.random_state >> 17;
+            worker.random_state ^= worker.random_state << 5;
+
+            JobWorker& victim = system.workers[worker.random_state % worker_count];
+            if (&victim != &worker && steal_job(victim.deque, job)) return true;
+        }
+        return false;
+    }
+
+    static void wake_workers(JobSystem& system, bool all)
+    {
+        system.work_generation.fetch_add(1, std::memory_order_seq_cst);
+        if (system.sleeping_count.load(std::memory_order_seq_cst) == 0) return;
+
+        // Taking the lock orders the notify after a sleeper's last generation check
+        { std::lock_guard<std::mutex> lock(system.sleep_mutex); }
+        if (all) system.sleep_condition.notify_all();
+        else system.sleep_condition.notify_one();
+    }
+
+    static inline void lock_counter(JobCounter& counter)
+    {
+        while (counter.locked.exchange(true, std::memory_order_acquire)) std::this_thread::yield();
+    }
+
+    static inline void unlock_counter(JobCounter& counter)
+    {
+        counter.locked.store(false, std::memory_order_release);
+    }
+
+    static void run_job(JobSystem& system, const Job& job);
+
+    // Queues on the current worker, or runs inline when the caller is not a worker or its deque is full
+    static void enqueue_job(JobSystem& system, const Job& job, bool wake)
+    {
+        if (t_job_system != &system || !push_job(t_job_worker->deque, job)) {
+            run_job(system, job);
+            return;
+        }
+        if (wake) wake_workers(system, false);
+    }
+
+    static void finish_job(JobSystem& system, JobCounter& counter)
+    {
+        std::vector<Job> ready;
+        lock_counter(counter);
+        if (counter.value.fetch_sub(1, std::memory_order_acq_rel) == 1) ready.swap(counter.dependents);
+        unlock_counter(counter);  // Last access, a waiter may destroy the counter from here on
+
+        for (const Job& job : ready) enqueue_job(system, job, true);
+    }
+
+    static void run_job(JobSystem& system, const Job& job)
+    {
+        job.function(job.data);
+        if (job.counter) finish_job(system, *job.counter);
+    }
+
+    static void job_worker(JobSystem* system, JobWorker* worker)
+    {
+        t_job_system = system;
+        t_job_worker = worker;
+        set_profile_worker_index((intmax_t)worker->index);
+        share_heap_allocation_count();
+
+        uintmax_t idle_count = 0;
+        while (!system->stopping.load(std::memory_order_acquire)) {
+            Job job;
+            if (find_job(*system, *worker, job)) {
+                run_job(*system, job);
+                idle_count = 0;
+                continue;
+            }
+            if (++idle_count < JOB_SYSTEM_SPIN_COUNT) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // Announce the sleep before the final check, `wake_workers` bumps the generation before reading the count
+            system->sleeping_count.fetch_add(1, std::memory_order_seq_cst);
+            uintmax_t generation = system->work_generation.load(std::memory_order_seq_cst);
+            if (find_job(*system, *worker, job)) {
+                system->sleeping_count.fetch_sub(1, std::memory_order_relaxed);
+                run_job(*system, job);
+                idle_count = 0;
+                continue;
+            }
+            {
+                std::unique_lock<std::mutex> lock(system->sleep_mutex);
+                system->sleep_condition.wait(lock, [system, generation] {
+                    return system->stopping.load(std::memory_order_acquire) || system->work_generation.load(std::memory_order_seq_cst) != generation;
+                });
+            }
+            system->sleeping_count.fetch_sub(1, std::memory_order_relaxed);
+            idle_count = 0;
+        }
+
+        t_job_system = nullptr;
+        t_job_worker = nullptr;
+        set_profile_worker_index(-1);
+    }
+
+    void start_job_system(JobSystem& system, uintmax_t thread_count)
+    {
+        if (thread_count == 0) thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+        log_debug("[JOBS] Starting job system with " + std::to_string(thread_count) + " threads");
+
+        system.stopping = false;
+        for (uintmax_t i = 0; i < thread_count; i++) {
+            JobWorker& worker = system.workers.emplace_back();
+            worker.index = i;
+            worker.random_state = 0x9E3779B9u * (uint32_t)(i + 1);
+        }
+
+        t_job_system = &system;
+        t_job_worker = &system.workers[0];
+        set_profile_worker_index(0);
+        for (uintmax_t i = 1; i < thread_count; i++) {
+            system.threads.emplace_back(job_worker, &system, &system.workers[i]);
+        }
+    }
+
+    void stop_job_system(JobSystem& system)
+    {
+        {
+            std::lock_guard<std::mutex> lock(system.sleep_mutex);
+            system.stopping = true;
+        }
+        system.sleep_condition.notify_all();
+        for (std::thread& thread : system.threads) thread.join();
+        system.threads.clear();
+        system.workers.clear();
+
+        if (t_job_system == &system) {
+            t_job_system = nullptr;
+            t_job_worker = nullptr;
+        }
+    }
+
+    uintmax_t get_job_thread_count(const JobSystem& system)
+    {
+        return system.workers.size();
+    }
+
+    intmax_t get_job_worker_index(const JobSystem& system)
+    {
+        return (t_job_system == &system) ? (intmax_t)t_job_worker->index : -1;
+    }
+
+    void submit_job(JobSystem& system, JobFunction function, void* data, JobCounter* counter, JobCounter* dependency)
+    {
+        Job job;
+        job.function = function;
+        job.data = data;
+        job.counter = counter;
+        if (counter) counter->value.fetch_add(1, std::memory_order_relaxed);
+
+        if (dependency) {
+            lock_counter(*dependency);
+            bool waiting = dependency->value.load(std::memory_order_acquire) > 0;
+            if (waiting) dependency->dependents.push_back(job);
+            unlock_counter(*dependency);
+            if (waiting) return;
+        }
+
+        enqueue_job(system, job, true);
+    }
+
+    void submit_background_job(JobSystem& system, JobFunction function, void* data, JobCounter* counter)
+    {
+        if (system.workers.size() < 2) {
+            submit_job(system, function, data, counter);
+            return;
+        }
+
+        bool queued = false;
+        {
+            std::lock_guard<std::mutex> lock(system.background_mutex);
+            if (system.background_count < JOB_SYSTEM_BACKGROUND_CAPACITY) {
+                if (counter) counter->value.fetch_add(1, std::memory_order_relaxed);
+                Job& job = system.background_jobs[(system.background_head + system.background_count) % JOB_SYSTEM_BACKGROUND_CAPACITY];
+                job.function = function;
+                job.data = data;
+                job.counter = counter;
+                system.background_count++;
+                system.background_pending.store(system.background_count, std::memory_order_release);
+                queued = true;
+            }
+        }
+
+        if (queued) wake_workers(system, false);
+        else submit_job(system, function, data, counter);
+    }
+
+    void wait_for_counter(JobSystem& system, JobCounter& counter)
+    {
+        JobWorker* worker = (t_job_system == &system) ? t_job_worker : nullptr;
+        while (counter.value.load(std::memory_order_acquire) > 0) {
+            Job job;
+            if (worker && find_job(system, *worker, job)) run_job(system, job);
+            else std::this_thread::yield();
+        }
+
+        // The job that brought the count to zero may still be launching dependents
+        while (counter.locked.load(std::memory_order_acquire)) std::this_thread::yield();
+    }
+
+    struct ParallelFor {
+        ParallelForFunction function;
+        void* context;
+        uintmax_t count;
+        uintmax_t batch_size;
+        uintmax_t batch_count;
+        std::atomic<uintmax_t> next_batch{ 0 };
+    };
+
+    static void run_parallel_for_batches(ParallelFor& parallel)
+    {
+        for (uintmax_t batch = parallel.next_batch.fetch_add(1, std::memory_order_relaxed); batch < parallel.batch_count; batch = parallel.next_batch.fetch_add(1, std::memory_order_relaxed)) {
+            uintmax_t begin = batch * parallel.batch_size;
+            parallel.function(parallel.context, begin, std::min(begin + parallel.batch_size, parallel.count));
+        }
+    }
+
+    static void parallel_for_job(void* data)
+    {
+        run_parallel_for_batches(*(ParallelFor*)data);
+    }
+
+    void parallel_for(JobSystem& system, uintmax_t count, uintmax_t batch_size, ParallelForFunction function, void* context)
+    {
+        batch_size = std::max(batch_size, (uintmax_t)1);
+        uintmax_t batch_count = (count + batch_size - 1) / batch_size;
+        if (batch_count <= 1 || system.workers.size() <= 1) {
+            if (count > 0) function(context, 0, count);
+            return;
+        }
+
+        ParallelFor parallel;
+        parallel.function = function;
+        parallel.context = context;
+        parallel.count = count;
+        parallel.batch_size = batch_size;
+        parallel.batch_count = batch_count;
+
+        // One helper per other worker at most, each keeps claiming batches until none are left
+        JobCounter counter;
+        uintmax_t helper_count = std::min(batch_count, (uintmax_t)system.workers.size()) - 1;
+        for (uintmax_t i = 0; i < helper_count; i++) {
+            Job job;
+            job.function = parallel_for_job;
+            job.data = &parallel;
+            job.counter = &counter;
+            counter.value.fetch_add(1, std::memory_order_relaxed);
+            enqueue_job(system, job, false);
+        }
+        wake_workers(system, true);
+
+        run_parallel_for_batches(parallel);
+        wait_for_counter(system, counter);
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "logging.h"
+
+// Per worker, a full deque runs new jobs inline instead
+#define JOB_SYSTEM_DEQUE_CAPACITY 4096
+
+// Jobs waiting for a worker other than the starting thread, more run the way `submit_job` does
+#define JOB_SYSTEM_BACKGROUND_CAPACITY 64
+
+// Failed steal rounds before an idle worker goes to sleep
+#define JOB_SYSTEM_SPIN_COUNT 64
+
+namespace Engine
+{
+    typedef void (*JobFunction)(void* data);
+    typedef void (*ParallelForFunction)(void* context, uintmax_t begin, uintmax_t end);
+
+    struct JobCounter;
+
+    struct Job {
+        JobFunction function = nullptr;
+        void* data = nullptr;
+        JobCounter* counter = nullptr;  // Decremented once `function` returns
+    };
+
+    // Unfinished job count. Jobs submitted with a counter as their dependency start once it reaches zero,
+    // so every job counted by it has to be submitted before anything depends on it
+    struct JobCounter {
+        std::atomic<uintmax_t> value{ 0 };
+
+        // Held while the count drops to zero or a dependent is added, waiters also spin on it before returning
+        std::atomic<bool> locked{ false };
+        std::vector<Job> dependents;
+    };
+
+    // Fields are atomic so a thief reading a slot the owner is reusing only sees a torn job it then discards
+    struct JobSlot {
+        std::atomic<JobFunction> function{ nullptr };
+        std::atomic<void*> data{ nullptr };
+        std::atomic<JobCounter*> counter{ nullptr };
+    };
+
+    // Chase-Lev deque, the owner pushes and pops at the bottom, other workers steal from the top
+    struct JobDeque {
+        std::atomic<intmax_t> top{ 0 };
+        std::atomic<intmax_t> bottom{ 0 };
+        JobSlot slots[JOB_SYSTEM_DEQUE_CAPACITY];
+    };
+
+    struct JobWorker {
+        uintmax_t index = 0;
+        uint32_t random_state = 0;  // Victim selection, owner only
+        JobDeque deque;
+    };
+
+    struct JobSystem {
+        std::deque<JobWorker> workers;  // Worker 0 is the thread that started the system
+        std::vector<std::thread> threads;
+        std::atomic<bool> stopping{ false };
+
+        // Idle workers sleep until the generation moves past the one they last saw empty
+        std::atomic<uintmax_t> work_generation{ 0 };
+        std::atomic<uintmax_t> sleeping_count{ 0 };
+        std::mutex sleep_mutex;
+        std::condition_variable sleep_condition;
+
+        // Only workers other than worker 0 take these, so the starting thread's waits never pick them up
+        std::mutex background_mutex;
+        Job background_jobs[JOB_SYSTEM_BACKGROUND_CAPACITY];  // Ring
+        uintmax_t background_head = 0;
+        uintmax_t background_count = 0;
+        std::atomic<uintmax_t> background_pending{ 0 };  // Lets workers skip the lock while it is empty
+    };
+
+    // `thread_count` includes the calling thread, which only runs jobs while it waits on a counter. 0 uses all hardware threads
+    void start_job_system(JobSystem& system, uintmax_t thread_count);
+    // Every counter has to be waited on before stopping
+    void stop_job_system(JobSystem& system);
+
+    uintmax_t get_job_thread_count(const JobSystem& system);
+    // Index of the calling thread in `system.workers`, -1 on threads the system does not own
+    intmax_t get_job_worker_index(const JobSystem& system);
+
+    // `counter` and `dependency` are optional. Called from outside the system's threads the job runs inline
+    void submit_job(JobSystem& system, JobFunction function, void* data, JobCounter* counter, JobCounter* dependency = nullptr);
+
+    // For long jobs that should overlap the starting thread rather than run inside its waits, like a whole frame's
+    // simulation. Runs like `submit_job` with a single worker or a full background queue
+    void submit_background_job(JobSystem& system, JobFunction function, void* data, JobCounter* counter);
+
+    // Runs other jobs until `counter` reaches zero
+    void wait_for_counter(JobSystem& system, JobCounter& counter);
+
+    // Splits [0, count) into batches of `batch_size`, the calling thread takes part and returns once every batch finished.
+    // Helper jobs claim batches from a shared counter, so nothing is allocated per call
+    void parallel_for(JobSystem& system, uintmax_t count, uintmax_t batch_size, ParallelForFunction function, void* context);
+
+    // Takes any `function(begin, end)` callable, which stays on the caller's stack
+    template<typename Function>
+    void parallel_for(JobSystem& system, uintmax_t count, uintmax_t batch_size, const Function& function)
+    {
+        parallel_for(system, count, batch_size, [](void* context, uintmax_t begin, uintmax_t end) { (*(const Function*)context)(begin, end); }, (void*)&function);
+    }
+}
@@ -0,0 +1,106 @@
+#include "light_buffer.h"
+#include "light_culling.h"
+
+#include <cstring>
+#include <string>
+
+namespace Engine
+{
+    void create_point_light_buffer(PointLightBuffer& buffer)
+    {
+        GLint max_block_size = 0;
+        glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &max_block_size);
+        if ((uintmax_t)max_block_size < sizeof(GPUPointLightBlock)) {
+            log_error("[LIGHTS] Point light block (" + std::to_string(sizeof(GPUPointLightBlock)) + " bytes) exceeds GL_MAX_UNIFORM_BLOCK_SIZE (" + std::to_string(max_block_size) + " bytes)");
+        }
+
+        buffer.data = GPUPointLightBlock{};
+
+        glGenBuffers(1, &buffer.ubo);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer.ubo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(GPUPointLightBlock), &buffer.data, GL_STREAM_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, POINT_LIGHT_BLOCK_BINDING, buffer.ubo);
+    }
+
+    void destroy_point_light_buffer(PointLightBuffer& buffer)
+    {
+        glDeleteBuffers(1, &buffer.ubo);
+        buffer.ubo = 0;
+    }
+
+    void bind_point_light_block(GLuint program)
+    {
+        GLuint block_index = glGetUniformBlockIndex(program, "PointLightBlock");
+        if (block_index == GL_INVALID_INDEX) {
+            log_warning("[LIGHTS] Program " + std::to_string(program) + " has no active `PointLightBlock`");
+            return;
+        }
+
+        glUniformBlockBinding(program, block_index, POINT_LIGHT_BLOCK_BINDING);
+    }
+
+    // Uploads only the used part of the staged block. Orphans the previous storage so the driver does not wait on draws
+    // still reading it
+    static void upload_point_light_block(PointLightBuffer& buffer, uintmax_t count)
+    {
+        GLsizeiptr upload_size = (GLsizeiptr)(offsetof(GPUPointLightBlock, lights) + count * sizeof(GPUPointLight));
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer.ubo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(GPUPointLightBlock), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, upload_size, &buffer.data);
+        PROFILE_COUNT(PROFILE_COUNTER_UNIFORM_UPLOADS, 1);
+    }
+
+    void upload_point_lights(PointLightBuffer& buffer, const std::vector<PointLight>& point_lights)
+    {
+        PROFILE_ZONE("Light upload");
+        uintmax_t count = point_lights.size() < MAX_POINT_LIGHT_COUNT ? point_lights.size() : MAX_POINT_LIGHT_COUNT;
+
+        buffer.data.count = (GLint)count;
+        for (uintmax_t i = 0; i < count; i++) {
+            const PointLight& point_light = point_lights[i];
+            GPUPointLight& gpu_light = buffer.data.lights[i];
+
+            gpu_light.color[0] = point_light.color.r;
+            gpu_light.color[1] = point_light.color.g;
+            gpu_light.color[2] = point_light.color.b;
+            gpu_light.energy = point_light.energy;
+            gpu_light.position[0] = point_light.position.x;
+            gpu_light.position[1] = point_light.position.y;
+            gpu_light.height = point_light.height;
+            gpu_light.radius = point_light.radius;
+            gpu_light.attenuation_linear = point_light.attenuation.linear;
+            gpu_light.attenuation_quadratic = point_light.attenuation.quadratic;
+        }
+
+        upload_point_light_block(buffer, count);
+    }
+
+    void upload_point_lights(PointLightBuffer& buffer, const GPUPointLight* gpu_lights, uintmax_t count)
+    {
+        PROFILE_ZONE("Light upload");
+        count = count < MAX_POINT_LIGHT_COUNT ? count : MAX_POINT_LIGHT_COUNT;
+
+        buffer.data.count = (GLint)count;
+        if (count > 0) memcpy(buffer.data.lights, gpu_lights, count * sizeof(GPUPointLight));
+
+        upload_point_light_block(buffer, count);
+    }
+
+    std::string get_light_shader_header()
+    {
+        std::string header;
+        header += "#define MAX_POINT_LIGHT_COUNT " + std::to_string(MAX_POINT_LIGHT_COUNT) + "\n";
+        header += "#define LIGHT_TILE_SIZE " + std::to_string(LIGHT_TILE_SIZE) + "\n";
+        header +=
+            "struct PointLight {\n"
+            "    vec3 color;\n"
+            "    float energy;\n"
+            "    vec2 position;\n"
+            "    float height;\n"
+            "    float radius;\n"
+            "    float attenuation_linear;\n"
+            "    float attenuation_quadratic;\n"
+            "};\n";
+        return header;
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "logging.h"
+#include "profiler.h"
+#include "lights.h"
+
+// Reaches the shaders through `get_light_shader_header`
+#define MAX_POINT_LIGHT_COUNT 256
+#define POINT_LIGHT_BLOCK_BINDING 0
+
+namespace Engine
+{
+    // std140, `get_light_shader_header` emits the matching GLSL struct
+    struct GPUPointLight {
+        float color[3];
+        float energy;
+        float position[2];
+        float height;
+        float radius;
+        float attenuation_linear;
+        float attenuation_quadratic;
+        float padding[2];
+    };
+
+    static_assert(offsetof(GPUPointLight, color) == 0, "std140: vec3 color");
+    static_assert(offsetof(GPUPointLight, energy) == 12, "std140: float energy packs after vec3");
+    static_assert(offsetof(GPUPointLight, position) == 16, "std140: vec2 position");
+    static_assert(offsetof(GPUPointLight, height) == 24, "std140: float height");
+    static_assert(offsetof(GPUPointLight, radius) == 28, "std140: float radius");
+    static_assert(offsetof(GPUPointLight, attenuation_linear) == 32, "std140: float attenuation_linear");
+    static_assert(offsetof(GPUPointLight, attenuation_quadratic) == 36, "std140: float attenuation_quadratic");
+    static_assert(sizeof(GPUPointLight) == 48, "std140: struct array stride is rounded up to 16 bytes");
+
+    // std140 mirror of `PointLightBlock` in `point_lighting.glsl`
+    struct GPUPointLightBlock {
+        GLint count;
+        GLint padding[3];
+        GPUPointLight lights[MAX_POINT_LIGHT_COUNT];
+    };
+
+    static_assert(offsetof(GPUPointLightBlock, count) == 0, "std140: int count");
+    static_assert(offsetof(GPUPointLightBlock, lights) == 16, "std140: struct arrays are 16 byte aligned");
+    static_assert(sizeof(GPUPointLightBlock) == 16 + 48 * MAX_POINT_LIGHT_COUNT, "std140: block size");
+
+    struct PointLightBuffer {
+        GLuint ubo = 0;
+        GPUPointLightBlock data;  // CPU side staging copy
+    };
+
+    void create_point_light_buffer(PointLightBuffer& buffer);
+    void destroy_point_light_buffer(PointLightBuffer& buffer);
+
+    // Binds the `PointLightBlock` of `program` to `POINT_LIGHT_BLOCK_BINDING`
+    void bind_point_light_block(GLuint program);
+
+    // Packs `point_lights` and uploads only the used part of the block, lights past `MAX_POINT_LIGHT_COUNT` are dropped
+    void upload_point_lights(PointLightBuffer& buffer, const std::vector<PointLight>& point_lights);
+    // Uploads lights packed by the caller, e.g. by `pack_light_soa`
+    void upload_point_lights(PointLightBuffer& buffer, const GPUPointLight* gpu_lights, uintmax_t count);
+
+    // Served to the shaders as `#include "engine/lights.glsl"`: the light limits and `PointLight`, kept next to
+    // `GPUPointLight` so the two can only change together
+    std::string get_light_shader_header();
+}
@@ -0,0 +1,238 @@
+#include "light_culling.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace Engine
+{
+    // Closest point of the tile to the light center must lie within the radius
+    static inline bool circle_overlaps_tile(float center_x, float center_y, float radius, int32_t tile_x, int32_t tile_y)
+    {
+        float tile_min_x = (float)(tile_x * LIGHT_TILE_SIZE);
+        float tile_min_y = (float)(tile_y * LIGHT_TILE_SIZE);
+        float dx = center_x - std::clamp(center_x, tile_min_x, tile_min_x + (float)LIGHT_TILE_SIZE);
+        float dy = center_y - std::clamp(center_y, tile_min_y, tile_min_y + (float)LIGHT_TILE_SIZE);
+
+        return dx * dx + dy * dy <= radius * radius;
+    }
+
+    static inline bool circle_overlaps_bounds(const GPUPointLight& light, const LightDrawBounds& bounds)
+    {
+        float dx = light.position[0] - std::clamp(light.position[0], bounds.min.x, bounds.max.x);
+        float dy = light.position[1] - std::clamp(light.position[1], bounds.min.y, bounds.max.y);
+
+        return light.energy > 0.0f && dx * dx + dy * dy <= light.radius * light.radius;
+    }
+
+    // Counting sort over the tile rows [row_begin, row_end), offsets in `tile_ranges` are local to the band
+    static void bin_band(LightTileGrid& grid, uintmax_t light_count, uintmax_t band_index, int32_t row_begin, int32_t row_end, FrameArena& arena)
+    {
+        PROFILE_ZONE("Light binning band");
+        const int32_t tile_count_x = (int32_t)grid.tile_count_x;
+        uint32_t* tile_ranges = grid.tile_ranges.data();
+
+        for (int32_t i = row_begin * tile_count_x; i < row_end * tile_count_x; i++) {
+            tile_ranges[i * 2 + 0] = 0;
+            tile_ranges[i * 2 + 1] = 0;
+        }
+
+        // Pass 0 counts, pass 1 writes
+        uint32_t* indices = nullptr;
+        for (int pass = 0; pass < 2; pass++) {
+            for (uintmax_t light = 0; light < light_count; light++) {
+                int32_t min_y = std::max(grid.light_min_y[light], row_begin);
+                int32_t max_y = std::min(grid.light_max_y[light], row_end - 1);
+
+                for (int32_t y = min_y; y <= max_y; y++) {
+                    for (int32_t x = grid.light_min_x[light]; x <= grid.light_max_x[light]; x++) {
+                        if (!circle_overlaps_tile(grid.light_center_x[light], grid.light_center_y[light], grid.light_radius[light], x, y)) continue;
+
+                        uint32_t* range = &tile_ranges[(y * tile_count_x + x) * 2];
+                        if (pass == 1) indices[range[0] + range[1]] = (uint32_t)light;
+                        range[1]++;
+                    }
+                }
+            }
+
+            if (pass == 1) break;
+
+            uint32_t offset = 0;
+            for (int32_t i = row_begin * tile_count_x; i < row_end * tile_count_x; i++) {
+                tile_ranges[i * 2 + 0] = offset;
+                offset += tile_ranges[i * 2 + 1];
+                tile_ranges[i * 2 + 1] = 0;
+            }
+            indices = allocate_frame_array<uint32_t>(arena, offset);
+            grid.band_indices[band_index] = indices;
+            grid.band_index_counts[band_index] = offset;
+        }
+    }
+
+    static inline void get_light_circle(const PointLight& light, float& x, float& y, float& radius, float& energy)
+    {
+        x = light.position.x;
+        y = light.position.y;
+        radius = light.radius;
+        energy = light.energy;
+    }
+
+    static inline void get_light_circle(const GPUPointLight& light, float& x, float& y, float& radius, float& energy)
+    {
+        x = light.position[0];
+        y = light.position[1];
+        radius = light.radius;
+        energy = light.energy;
+    }
+
+    // Screen-space circle and tile bounds of every light, the part of binning that depends on the light layout
+    template<typename Light>
+    static void compute_light_bounds(LightTileGrid& grid, const Light* point_lights, uintmax_t light_count, const glm::vec2& camera_pos, uintmax_t viewport_size_x, uintmax_t viewport_size_y)
+    {
+        grid.tile_count_x = (viewport_size_x + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+        grid.tile_count_y = (viewport_size_y + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+        grid.tile_ranges.resize(grid.tile_count_x * grid.tile_count_y * 2);
+
+        grid.light_center_x.resize(light_count);
+        grid.light_center_y.resize(light_count);
+        grid.light_radius.resize(light_count);
+        grid.light_min_x.resize(light_count);
+        grid.light_min_y.resize(light_count);
+        grid.light_max_x.resize(light_count);
+        grid.light_max_y.resize(light_count);
+
+        // Tile bounds per light, branch free so the loop vectorizes. Empty ranges (min > max) reject the light
+        const float max_tile_x = (float)grid.tile_count_x - 1.0f;
+        const float max_tile_y = (float)grid.tile_count_y - 1.0f;
+        const float inverse_tile_size = 1.0f / (float)LIGHT_TILE_SIZE;
+        for (uintmax_t i = 0; i < light_count; i++) {
+            float position_x, position_y, light_radius, energy;
+            get_light_circle(point_lights[i], position_x, position_y, light_radius, energy);
+
+            float center_x = position_x - camera_pos.x;
+            float center_y = position_y - camera_pos.y;
+            float radius = energy > 0.0f ? light_radius : -1.0f;
+
+            float min_x = std::floor((center_x - radius) * inverse_tile_size);
+            float min_y = std::floor((center_y - radius) * inverse_tile_size);
+            float max_x = std::floor((center_x + radius) * inverse_tile_size);
+            float max_y = std::floor((center_y + radius) * inverse_tile_size);
+
+            grid.light_center_x[i] = center_x;
+            grid.light_center_y[i] = center_y;
+            grid.light_radius[i] = radius;
+            grid.light_min_x[i] = (int32_t)std::clamp(min_x, 0.0f, max_tile_x + 1.0f);
+            grid.light_min_y[i] = (int32_t)std::clamp(min_y, 0.0f, max_tile_y + 1.0f);
+            grid.light_max_x[i] = radius < 0.0f ? -1 : (int32_t)std::min(max_x, max_tile_x);
+            grid.light_max_y[i] = radius < 0.0f ? -1 : (int32_t)std::min(max_y, max_tile_y);
+        }
+    }
+
+    static void bin_light_bounds(LightTileGrid& grid, uintmax_t light_count, JobSystem& jobs, FrameArena& arena)
+    {
+        uintmax_t thread_count = (light_count < LIGHT_CULLING_PARALLEL_THRESHOLD) ? 1 : get_job_thread_count(jobs);
+        uintmax_t band_count = std::min(thread_count, grid.tile_count_y);
+        uintmax_t rows_per_band = (grid.tile_count_y + band_count - 1) / std::max(band_count, (uintmax_t)1);
+        grid.band_indices.resize(band_count);
+        grid.band_index_counts.resize(band_count);
+
+        parallel_for(jobs, band_count, 1, [&grid, light_count, rows_per_band, &arena](uintmax_t band_begin, uintmax_t band_end) {
+            for (uintmax_t band = band_begin; band < band_end; band++) {
+                int32_t row_begin = (int32_t)std::min(band * rows_per_band, grid.tile_count_y);
+                int32_t row_end = (int32_t)std::min((band + 1) * rows_per_band, grid.tile_count_y);
+                bin_band(grid, light_count, band, row_begin, row_end, arena);
+            }
+        });
+
+        // Merge band lists, rebasing their tile offsets
+        grid.light_indices.clear();
+        for (uintmax_t band = 0; band < band_count; band++) {
+            uint32_t base_offset = (uint32_t)grid.light_indices.size();
+            uintmax_t tile_begin = std::min(band * rows_per_band, grid.tile_count_y) * grid.tile_count_x;
+            uintmax_t tile_end = std::min((band + 1) * rows_per_band, grid.tile_count_y) * grid.tile_count_x;
+            for (uintmax_t tile = tile_begin; tile < tile_end; tile++) grid.tile_ranges[tile * 2] += base_offset;
+
+            grid.light_indices.insert(grid.light_indices.end(), grid.band_indices[band], grid.band_indices[band] + grid.band_index_counts[band]);
+        }
+    }
+
+    void bin_point_lights(LightTileGrid& grid, const PointLight* point_lights, uintmax_t light_count, const glm::vec2& camera_pos, uintmax_t viewport_size_x, uintmax_t viewport_size_y, JobSystem& jobs, FrameArena& arena)
+    {
+        PROFILE_ZONE("Light binning");
+        compute_light_bounds(grid, point_lights, light_count, camera_pos, viewport_size_x, viewport_size_y);
+        bin_light_bounds(grid, light_count, jobs, arena);
+    }
+
+    void bin_point_lights(LightTileGrid& grid, const GPUPointLight* point_lights, uintmax_t light_count, const glm::vec2& camera_pos, uintmax_t viewport_size_x, uintmax_t viewport_size_y, JobSystem& jobs, FrameArena& arena)
+    {
+        PROFILE_ZONE("Light binning");
+        compute_light_bounds(grid, point_lights, light_count, camera_pos, viewport_size_x, viewport_size_y);
+        bin_light_bounds(grid, light_count, jobs, arena);
+    }
+
+    void cull_lights_per_draw(LightDrawCulling& culling, const GPUPointLight* point_lights, uintmax_t light_count, const LightDrawBounds* draw_bounds, uintmax_t draw_count, JobSystem& jobs, FrameArena& arena)
+    {
+        PROFILE_ZONE("Light draw culling");
+        begin_frame_vector(culling.lit, arena);
+        culling.lit.resize(draw_count);
+        uint8_t* lit = culling.lit.data();
+
+        std::atomic<uintmax_t> lit_count{ 0 };
+        parallel_for(jobs, draw_count, 256, [point_lights, light_count, draw_bounds, lit, &lit_count](uintmax_t begin, uintmax_t end) {
+            uintmax_t batch_lit_count = 0;
+            for (uintmax_t draw = begin; draw < end; draw++) {
+                uintmax_t light = 0;
+                while (light < light_count && !circle_overlaps_bounds(point_lights[light], draw_bounds[draw])) light++;
+                lit[draw] = light < light_count ? 1 : 0;
+                batch_lit_count += lit[draw];
+            }
+            lit_count.fetch_add(batch_lit_count, std::memory_order_relaxed);
+        });
+
+        culling.lit_count = lit_count.load(std::memory_order_relaxed);
+        culling.culled_count = draw_count - culling.lit_count;
+    }
+
+    static void create_texture_buffer(GLuint& buffer, GLuint& texture, GLenum internal_format)
+    {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, sizeof(uint32_t) * 2, NULL, GL_STREAM_DRAW);
+
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, internal_format, buffer);
+    }
+
+    void create_light_tile_buffers(LightTileBuffers& buffers)
+    {
+        create_texture_buffer(buffers.tile_range_buffer, buffers.tile_range_texture, GL_RG32UI);
+        create_texture_buffer(buffers.light_index_buffer, buffers.light_index_texture, GL_R32UI);
+    }
+
+    void destroy_light_tile_buffers(LightTileBuffers& buffers)
+    {
+        glDeleteTextures(1, &buffers.tile_range_texture);
+        glDeleteTextures(1, &buffers.light_index_texture);
+        glDeleteBuffers(1, &buffers.tile_range_buffer);
+        glDeleteBuffers(1, &buffers.light_index_buffer);
+        buffers = LightTileBuffers();
+    }
+
+    void upload_light_tiles(LightTileBuffers& buffers, const LightTileGrid& grid)
+    {
+        PROFILE_ZONE("Light tile upload");
+        static const uint32_t empty_index = 0;
+
+        // Orphaning upload, an empty index list still needs storage for the texture buffer
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers.tile_range_buffer);
+        glBufferData(GL_TEXTURE_BUFFER, grid.tile_ranges.size() * sizeof(uint32_t), grid.tile_ranges.data(), GL_STREAM_DRAW);
+
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers.light_index_buffer);
+        if (grid.light_indices.empty()) {
+            glBufferData(GL_TEXTURE_BUFFER, sizeof(uint32_t), &empty_index, GL_STREAM_DRAW);
+        } else {
+            glBufferData(GL_TEXTURE_BUFFER, grid.light_indices.size() * sizeof(uint32_t), grid.light_indices.data(), GL_STREAM_DRAW);
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "logging.h"
+#include "lights.h"
+#include "light_buffer.h"
+#include "job_system.h"
+#include "frame_arena.h"
+#include "profiler.h"
+
+// Reaches the shaders through `get_light_shader_header`
+#define LIGHT_TILE_SIZE 32
+
+// Below this light count binning runs on the calling thread only
+#define LIGHT_CULLING_PARALLEL_THRESHOLD 256
+
+namespace Engine
+{
+    // Per-tile light index lists for the screen, tiles are addressed top-down in screen space
+    struct LightTileGrid {
+        uintmax_t tile_count_x = 0;
+        uintmax_t tile_count_y = 0;
+        std::vector<uint32_t> tile_ranges;  // (offset, count) into `light_indices` per tile
+        std::vector<uint32_t> light_indices;
+
+        // Screen-space circle and tile bounds per light, filled by the first binning pass
+        std::vector<float> light_center_x, light_center_y, light_radius;
+        std::vector<int32_t> light_min_x, light_min_y, light_max_x, light_max_y;
+
+        // Per-band output in the frame arena, merged into `light_indices` after binning
+        std::vector<uint32_t*> band_indices;
+        std::vector<uint32_t> band_index_counts;
+    };
+
+    // World-space rectangle one draw covers
+    struct LightDrawBounds {
+        glm::vec2 min = glm::vec2(0.0f);
+        glm::vec2 max = glm::vec2(0.0f);
+    };
+
+    // Per draw, whether any light reaches it. The shaders still take their lights from the tiles, this only lets
+    // draws out of every light's reach skip lighting
+    struct LightDrawCulling {
+        FrameVector<uint8_t> lit;  // Per draw, 1 if a light's radius reaches into its bounds
+        uintmax_t lit_count = 0;
+        uintmax_t culled_count = 0;  // Draws no light reaches
+    };
+
+    struct LightTileBuffers {
+        GLuint tile_range_buffer = 0;
+        GLuint tile_range_texture = 0;
+        GLuint light_index_buffer = 0;
+        GLuint light_index_texture = 0;
+    };
+
+    // Bins the first `light_count` lights by their `radius`, lights without energy are skipped.
+    // Tile rows are split into one band per job thread, the band lists are only valid until `arena` is reset
+    void bin_point_lights(LightTileGrid& grid, const PointLight* point_lights, uintmax_t light_count, const glm::vec2& camera_pos, uintmax_t viewport_size_x, uintmax_t viewport_size_y, JobSystem& jobs, FrameArena& arena);
+    // Same for lights already packed for upload, indices then refer to the uploaded order
+    void bin_point_lights(LightTileGrid& grid, const GPUPointLight* point_lights, uintmax_t light_count, const glm::vec2& camera_pos, uintmax_t viewport_size_x, uintmax_t viewport_size_y, JobSystem& jobs, FrameArena& arena);
+
+    // Tests each draw's bounds against the lights' radius circles until one overlaps, draws are split across the job threads.
+    // `lit` is written into `arena` and only valid until it is reset
+    void cull_lights_per_draw(LightDrawCulling& culling, const GPUPointLight* point_lights, uintmax_t light_count, const LightDrawBounds* draw_bounds, uintmax_t draw_count, JobSystem& jobs, FrameArena& arena);
+
+    void create_light_tile_buffers(LightTileBuffers& buffers);
+    void destroy_light_tile_buffers(LightTileBuffers& buffers);
+    void upload_light_tiles(LightTileBuffers& buffers, const LightTileGrid& grid);
+}
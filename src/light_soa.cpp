@@ -0,0 +1,327 @@
+#include "light_soa.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+
+// SSE2 is part of x86-64, 32-bit builds only get the kernel when they target it
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIGHT_SOA_SSE
+#include <emmintrin.h>
+#endif
+
+// Arrays in the block: 10 light fields, the flicker base and 3 arrays per flicker term
+#define LIGHT_SOA_FIELD_COUNT (11 + 3 * LIGHT_FLICKER_TERM_COUNT)
+
+#define LIGHT_SOA_TWO_PI 6.28318530717958647692f
+
+namespace Engine
+{
+    // Every array of `lights` in block order
+    static void get_light_soa_fields(LightSoA& lights, float** fields[LIGHT_SOA_FIELD_COUNT])
+    {
+        uintmax_t field = 0;
+        fields[field++] = &lights.position_x;
+        fields[field++] = &lights.position_y;
+        fields[field++] = &lights.color_r;
+        fields[field++] = &lights.color_g;
+        fields[field++] = &lights.color_b;
+        fields[field++] = &lights.energy;
+        fields[field++] = &lights.radius;
+        fields[field++] = &lights.height;
+        fields[field++] = &lights.attenuation_linear;
+        fields[field++] = &lights.attenuation_quadratic;
+        fields[field++] = &lights.flicker_base;
+        for (uintmax_t term = 0; term < LIGHT_FLICKER_TERM_COUNT; term++) {
+            fields[field++] = &lights.flicker_frequency[term];
+            fields[field++] = &lights.flicker_phase[term];
+            fields[field++] = &lights.flicker_weight[term];
+        }
+    }
+
+    void destroy_light_soa(LightSoA& lights)
+    {
+        if (lights.memory) ::operator delete(lights.memory, std::align_val_t(LIGHT_SOA_ALIGNMENT));
+        lights = LightSoA{};
+    }
+
+    void reserve_light_soa(LightSoA& lights, uintmax_t capacity)
+    {
+        capacity = (capacity + LIGHT_SOA_WIDTH - 1) / LIGHT_SOA_WIDTH * LIGHT_SOA_WIDTH;
+        if (capacity <= lights.capacity) return;
+
+        // Zeroed, so the padding lights have no energy and cull themselves
+        uintmax_t array_size = capacity * sizeof(float);
+        void* memory = ::operator new(LIGHT_SOA_FIELD_COUNT * array_size, std::align_val_t(LIGHT_SOA_ALIGNMENT));
+        memset(memory, 0, LIGHT_SOA_FIELD_COUNT * array_size);
+
+        float** fields[LIGHT_SOA_FIELD_COUNT];
+        get_light_soa_fields(lights, fields);
+        for (uintmax_t field = 0; field < LIGHT_SOA_FIELD_COUNT; field++) {
+            float* array = (float*)((unsigned char*)memory + field * array_size);
+            if (lights.count > 0) memcpy(array, *fields[field], lights.count * sizeof(float));
+            *fields[field] = array;
+        }
+
+        if (lights.memory) ::operator delete(lights.memory, std::align_val_t(LIGHT_SOA_ALIGNMENT));
+        lights.memory = memory;
+        lights.capacity = capacity;
+    }
+
+    void copy_light_soa(LightSoA& target, const LightSoA& source)
+    {
+        reserve_light_soa(target, source.capacity);
+
+        float** target_fields[LIGHT_SOA_FIELD_COUNT];
+        float** source_fields[LIGHT_SOA_FIELD_COUNT];
+        get_light_soa_fields(target, target_fields);
+        get_light_soa_fields(const_cast<LightSoA&>(source), source_fields);
+        for (uintmax_t field = 0; field < LIGHT_SOA_FIELD_COUNT; field++) {
+            if (source.capacity > 0) memcpy(*target_fields[field], *source_fields[field], source.capacity * sizeof(float));
+        }
+        target.count = source.count;
+    }
+
+    uintmax_t add_light(LightSoA& lights, const PointLight& point_light, const LightFlicker& flicker)
+    {
+        if (lights.count == lights.capacity) reserve_light_soa(lights, std::max(lights.capacity * 2, (uintmax_t)LIGHT_SOA_WIDTH));
+
+        uintmax_t i = lights.count++;
+        lights.position_x[i] = point_light.position.x;
+        lights.position_y[i] = point_light.position.y;
+        lights.color_r[i] = point_light.color.r;
+        lights.color_g[i] = point_light.color.g;
+        lights.color_b[i] = point_light.color.b;
+        lights.energy[i] = flicker.base;
+        lights.radius[i] = point_light.radius;
+        lights.height[i] = point_light.height;
+        lights.attenuation_linear[i] = point_light.attenuation.linear;
+        lights.attenuation_quadratic[i] = point_light.attenuation.quadratic;
+
+        lights.flicker_base[i] = flicker.base;
+        for (uintmax_t term = 0; term < LIGHT_FLICKER_TERM_COUNT; term++) {
+            lights.flicker_frequency[term][i] = flicker.frequency[term];
+            lights.flicker_phase[term][i] = flicker.phase[term];
+            lights.flicker_weight[term][i] = flicker.weight[term];
+        }
+        return i;
+    }
+
+    uintmax_t add_light(LightSoA& lights, const PointLight& point_light)
+    {
+        LightFlicker flicker;
+        flicker.base = point_light.energy;
+        return add_light(lights, point_light, flicker);
+    }
+
+    // Reduces to a quarter turn around 0 and evaluates the degree 9 Taylor polynomial there
+    static inline float sin_approx(float x)
+    {
+        float turns = x * (1.0f / LIGHT_SOA_TWO_PI);
+        turns -= std::nearbyint(turns);                                  // [-0.5, 0.5]
+        if (std::fabs(turns) > 0.25f) turns = std::copysign(0.5f, turns) - turns;  // sin(pi - a) = sin(a)
+
+        float z = turns * LIGHT_SOA_TWO_PI;
+        float z2 = z * z;
+        return z * (1.0f + z2 * (-1.0f / 6.0f + z2 * (1.0f / 120.0f + z2 * (-1.0f / 5040.0f + z2 * (1.0f / 362880.0f)))));
+    }
+
+    static void animate_light_soa_scalar(LightSoA& lights, float time_ms)
+    {
+        for (uintmax_t i = 0; i < lights.count; i++) {
+            float energy = lights.flicker_base[i];
+            for (uintmax_t term = 0; term < LIGHT_FLICKER_TERM_COUNT; term++) {
+                energy += lights.flicker_weight[term][i] * sin_approx(time_ms * lights.flicker_frequency[term][i] + lights.flicker_phase[term][i]);
+            }
+            lights.energy[i] = energy;
+        }
+    }
+
+    static uintmax_t cull_light_soa_scalar(const LightSoA& lights, const glm::vec2& min, const glm::vec2& max, uint32_t* visible_indices)
+    {
+        uintmax_t visible_count = 0;
+        for (uintmax_t i = 0; i < lights.count; i++) {
+            float radius = lights.radius[i];
+            bool visible = lights.energy[i] > 0.0f &&
+                lights.position_x[i] + radius >= min.x && lights.position_x[i] - radius <= max.x &&
+                lights.position_y[i] + radius >= min.y && lights.position_y[i] - radius <= max.y;
+            visible_indices[visible_count] = (uint32_t)i;
+            visible_count += visible ? 1 : 0;
+        }
+        return visible_count;
+    }
+
+    static void pack_light_soa_scalar(const LightSoA& lights, const uint32_t* indices, uintmax_t count, GPUPointLight* gpu_lights)
+    {
+        for (uintmax_t i = 0; i < count; i++) {
+            uint32_t light = indices[i];
+            GPUPointLight& gpu_light = gpu_lights[i];
+
+            gpu_light.color[0] = lights.color_r[light];
+            gpu_light.color[1] = lights.color_g[light];
+            gpu_light.color[2] = lights.color_b[light];
+            gpu_light.energy = lights.energy[light];
+            gpu_light.position[0] = lights.position_x[light];
+            gpu_light.position[1] = lights.position_y[light];
+            gpu_light.height = lights.height[light];
+            gpu_light.radius = lights.radius[light];
+            gpu_light.attenuation_linear = lights.attenuation_linear[light];
+            gpu_light.attenuation_quadratic = lights.attenuation_quadratic[light];
+            gpu_light.padding[0] = 0.0f;
+            gpu_light.padding[1] = 0.0f;
+        }
+    }
+
+#ifdef LIGHT_SOA_SSE
+    // `sin_approx` four lanes at a time. `_mm_cvtps_epi32` rounds to nearest even like `nearbyint`
+    static inline __m128 sin_approx_sse(__m128 x)
+    {
+        const __m128 sign_mask = _mm_set1_ps(-0.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 quarter = _mm_set1_ps(0.25f);
+        const __m128 two_pi = _mm_set1_ps(LIGHT_SOA_TWO_PI);
+
+        __m128 turns = _mm_mul_ps(x, _mm_set1_ps(1.0f / LIGHT_SOA_TWO_PI));
+        turns = _mm_sub_ps(turns, _mm_cvtepi32_ps(_mm_cvtps_epi32(turns)));
+
+        __m128 folded = _mm_sub_ps(_mm_or_ps(half, _mm_and_ps(turns, sign_mask)), turns);
+        __m128 fold = _mm_cmpgt_ps(_mm_andnot_ps(sign_mask, turns), quarter);
+        turns = _mm_or_ps(_mm_and_ps(fold, folded), _mm_andnot_ps(fold, turns));
+
+        __m128 z = _mm_mul_ps(turns, two_pi);
+        __m128 z2 = _mm_mul_ps(z, z);
+        __m128 polynomial = _mm_set1_ps(1.0f / 362880.0f);
+        polynomial = _mm_add_ps(_mm_mul_ps(polynomial, z2), _mm_set1_ps(-1.0f / 5040.0f));
+        polynomial = _mm_add_ps(_mm_mul_ps(polynomial, z2), _mm_set1_ps(1.0f / 120.0f));
+        polynomial = _mm_add_ps(_mm_mul_ps(polynomial, z2), _mm_set1_ps(-1.0f / 6.0f));
+        polynomial = _mm_add_ps(_mm_mul_ps(polynomial, z2), _mm_set1_ps(1.0f));
+        return _mm_mul_ps(z, polynomial);
+    }
+
+    static void animate_light_soa_sse(LightSoA& lights, float time_ms)
+    {
+        const __m128 time = _mm_set1_ps(time_ms);
+        for (uintmax_t i = 0; i < lights.count; i += 4) {
+            __m128 energy = _mm_load_ps(&lights.flicker_base[i]);
+            for (uintmax_t term = 0; term < LIGHT_FLICKER_TERM_COUNT; term++) {
+                __m128 angle = _mm_add_ps(_mm_mul_ps(time, _mm_load_ps(&lights.flicker_frequency[term][i])), _mm_load_ps(&lights.flicker_phase[term][i]));
+                energy = _mm_add_ps(energy, _mm_mul_ps(_mm_load_ps(&lights.flicker_weight[term][i]), sin_approx_sse(angle)));
+            }
+            _mm_store_ps(&lights.energy[i], energy);
+        }
+    }
+
+    // Lane indices of every 4-bit visibility mask packed to the front, and how many there are
+    static const int32_t s_compact_lanes[16][4] = {
+        { 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 1, 0, 0, 0 }, { 0, 1, 0, 0 },
+        { 2, 0, 0, 0 }, { 0, 2, 0, 0 }, { 1, 2, 0, 0 }, { 0, 1, 2, 0 },
+        { 3, 0, 0, 0 }, { 0, 3, 0, 0 }, { 1, 3, 0, 0 }, { 0, 1, 3, 0 },
+        { 2, 3, 0, 0 }, { 0, 2, 3, 0 }, { 1, 2, 3, 0 }, { 0, 1, 2, 3 },
+    };
+    static const uint32_t s_compact_counts[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+    // Branch free, every group stores all four candidates and only advances past the visible ones
+    static uintmax_t cull_light_soa_sse(const LightSoA& lights, const glm::vec2& min, const glm::vec2& max, uint32_t* visible_indices)
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 min_x = _mm_set1_ps(min.x);
+        const __m128 min_y = _mm_set1_ps(min.y);
+        const __m128 max_x = _mm_set1_ps(max.x);
+        const __m128 max_y = _mm_set1_ps(max.y);
+
+        uintmax_t visible_count = 0;
+        for (uintmax_t i = 0; i < lights.count; i += 4) {
+            __m128 x = _mm_load_ps(&lights.position_x[i]);
+            __m128 y = _mm_load_ps(&lights.position_y[i]);
+            __m128 radius = _mm_load_ps(&lights.radius[i]);
+
+            __m128 visible = _mm_cmpgt_ps(_mm_load_ps(&lights.energy[i]), zero);
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(_mm_add_ps(x, radius), min_x));
+            visible = _mm_and_ps(visible, _mm_cmple_ps(_mm_sub_ps(x, radius), max_x));
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(_mm_add_ps(y, radius), min_y));
+            visible = _mm_and_ps(visible, _mm_cmple_ps(_mm_sub_ps(y, radius), max_y));
+
+            // Padding lights have no energy, so the last group never reports lanes past `count`
+            int mask = _mm_movemask_ps(visible);
+            __m128i indices = _mm_add_epi32(_mm_loadu_si128((const __m128i*)s_compact_lanes[mask]), _mm_set1_epi32((int32_t)i));
+            _mm_storeu_si128((__m128i*)&visible_indices[visible_count], indices);
+            visible_count += s_compact_counts[mask];
+        }
+        return visible_count;
+    }
+
+    // Three 16 byte stores per light, the fields already sit in the std140 order
+    static void pack_light_soa_sse(const LightSoA& lights, const uint32_t* indices, uintmax_t count, GPUPointLight* gpu_lights)
+    {
+        for (uintmax_t i = 0; i < count; i++) {
+            uint32_t light = indices[i];
+            float* gpu_light = (float*)&gpu_lights[i];
+
+            _mm_storeu_ps(gpu_light + 0, _mm_setr_ps(lights.color_r[light], lights.color_g[light], lights.color_b[light], lights.energy[light]));
+            _mm_storeu_ps(gpu_light + 4, _mm_setr_ps(lights.position_x[light], lights.position_y[light], lights.height[light], lights.radius[light]));
+            _mm_storeu_ps(gpu_light + 8, _mm_setr_ps(lights.attenuation_linear[light], lights.attenuation_quadratic[light], 0.0f, 0.0f));
+        }
+    }
+#endif
+
+    static LightSoAKernel resolve_kernel(LightSoAKernel kernel)
+    {
+        if (kernel == LIGHT_SOA_KERNEL_BEST) return is_light_soa_kernel_supported(LIGHT_SOA_KERNEL_SSE) ? LIGHT_SOA_KERNEL_SSE : LIGHT_SOA_KERNEL_SCALAR;
+        return is_light_soa_kernel_supported(kernel) ? kernel : LIGHT_SOA_KERNEL_SCALAR;
+    }
+
+    void animate_light_soa(LightSoA& lights, float time_ms, LightSoAKernel kernel)
+    {
+        PROFILE_ZONE("Light animation");
+#ifdef LIGHT_SOA_SSE
+        if (resolve_kernel(kernel) == LIGHT_SOA_KERNEL_SSE) {
+            animate_light_soa_sse(lights, time_ms);
+            return;
+        }
+#endif
+        animate_light_soa_scalar(lights, time_ms);
+    }
+
+    uintmax_t cull_light_soa(const LightSoA& lights, const glm::vec2& min, const glm::vec2& max, uint32_t* visible_indices, LightSoAKernel kernel)
+    {
+        PROFILE_ZONE("Light viewport culling");
+#ifdef LIGHT_SOA_SSE
+        if (resolve_kernel(kernel) == LIGHT_SOA_KERNEL_SSE) return cull_light_soa_sse(lights, min, max, visible_indices);
+#endif
+        return cull_light_soa_scalar(lights, min, max, visible_indices);
+    }
+
+    void pack_light_soa(const LightSoA& lights, const uint32_t* indices, uintmax_t count, GPUPointLight* gpu_lights, LightSoAKernel kernel)
+    {
+#ifdef LIGHT_SOA_SSE
+        if (resolve_kernel(kernel) == LIGHT_SOA_KERNEL_SSE) {
+            pack_light_soa_sse(lights, indices, count, gpu_lights);
+            return;
+        }
+#endif
+        pack_light_soa_scalar(lights, indices, count, gpu_lights);
+    }
+
+    bool is_light_soa_kernel_supported(LightSoAKernel kernel)
+    {
+        switch (kernel) {
+            case LIGHT_SOA_KERNEL_SCALAR: return true;
+#ifdef LIGHT_SOA_SSE
+            case LIGHT_SOA_KERNEL_SSE:    return true;
+#endif
+            case LIGHT_SOA_KERNEL_BEST:   return true;
+            default:                      return false;
+        }
+    }
+
+    const char* get_light_soa_kernel_name(LightSoAKernel kernel)
+    {
+        switch (kernel) {
+            case LIGHT_SOA_KERNEL_SCALAR: return "scalar";
+            case LIGHT_SOA_KERNEL_SSE:    return "SSE";
+            case LIGHT_SOA_KERNEL_BEST:   return "best";
+            default:                      return "unknown";
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <glm/glm.hpp>
+
+#include "logging.h"
+#include "profiler.h"
+#include "lights.h"
+#include "light_buffer.h"
+
+// Every array starts on this boundary and holds a multiple of `LIGHT_SOA_WIDTH` lights, so the kernels never need a
+// scalar tail. The padding lights have no energy and are culled
+#define LIGHT_SOA_ALIGNMENT 32
+#define LIGHT_SOA_WIDTH 8
+
+#define LIGHT_FLICKER_TERM_COUNT 4
+
+namespace Engine
+{
+    enum LightSoAKernel {
+        LIGHT_SOA_KERNEL_SCALAR,
+        LIGHT_SOA_KERNEL_SSE,  // 4 lights per iteration, SSE2 only so every x86-64 CPU has it
+        LIGHT_SOA_KERNEL_BEST,
+    };
+
+    // Energy over time as `base + sum(weight * sin(time_ms * frequency + phase))`, no weights keeps it at `base`
+    struct LightFlicker {
+        float base = 1.0f;
+        float frequency[LIGHT_FLICKER_TERM_COUNT] = {};  // Radians per ms
+        float phase[LIGHT_FLICKER_TERM_COUNT] = {};      // Radians
+        float weight[LIGHT_FLICKER_TERM_COUNT] = {};
+    };
+
+    // `PointLight` split per field for the bulk kernels, all arrays live in one aligned block
+    struct LightSoA {
+        uintmax_t count = 0;
+        uintmax_t capacity = 0;
+        void* memory = nullptr;
+
+        float* position_x = nullptr;
+        float* position_y = nullptr;
+        float* color_r = nullptr;
+        float* color_g = nullptr;
+        float* color_b = nullptr;
+        float* energy = nullptr;  // Written by `animate_light_soa`
+        float* radius = nullptr;
+        float* height = nullptr;
+        float* attenuation_linear = nullptr;
+        float* attenuation_quadratic = nullptr;
+
+        float* flicker_base = nullptr;
+        float* flicker_frequency[LIGHT_FLICKER_TERM_COUNT] = {};
+        float* flicker_phase[LIGHT_FLICKER_TERM_COUNT] = {};
+        float* flicker_weight[LIGHT_FLICKER_TERM_COUNT] = {};
+    };
+
+    void destroy_light_soa(LightSoA& lights);
+
+    // Grows the block, existing lights are kept
+    void reserve_light_soa(LightSoA& lights, uintmax_t capacity);
+    void copy_light_soa(LightSoA& target, const LightSoA& source);
+
+    // Starts at `flicker.base` energy, `point_light.energy` is ignored
+    uintmax_t add_light(LightSoA& lights, const PointLight& point_light, const LightFlicker& flicker);
+    // Constant energy
+    uintmax_t add_light(LightSoA& lights, const PointLight& point_light);
+
+    // Evaluates the flicker of every light at `time_ms`. The sines are a polynomial approximation,
+    // within 4e-6 of `sin()` after range reduction
+    void animate_light_soa(LightSoA& lights, float time_ms, LightSoAKernel kernel = LIGHT_SOA_KERNEL_BEST);
+
+    // Writes the indices of the lights with energy whose radius reaches into [min, max] in ascending order, returns how
+    // many. `visible_indices` needs room for `capacity` indices
+    uintmax_t cull_light_soa(const LightSoA& lights, const glm::vec2& min, const glm::vec2& max, uint32_t* visible_indices, LightSoAKernel kernel = LIGHT_SOA_KERNEL_BEST);
+
+    // Writes `lights[indices[i]]` to `gpu_lights[i]` in the uniform block layout
+    void pack_light_soa(const LightSoA& lights, const uint32_t* indices, uintmax_t count, GPUPointLight* gpu_lights, LightSoAKernel kernel = LIGHT_SOA_KERNEL_BEST);
+
+    bool is_light_soa_kernel_supported(LightSoAKernel kernel);
+    const char* get_light_soa_kernel_name(LightSoAKernel kernel);
+}
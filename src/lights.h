@@ -1,3 +1,7 @@
+#pragma once
+
+#include "typedefs.h"
+
 #include <glm/glm.hpp>
 
 namespace Engine
@@ -14,4 +18,4 @@ namespace Engine
             float quadratic = 0.0001f;
         } attenuation;
     };
-}
\ No newline at end of file
+}
@@ -1,41 +1,346 @@
 #include "logging.h"
 
-#ifdef LOG_DISABLE_DEBUG
-void log_debug(std::string message) { };
-#else
-void log_debug(std::string message) {
-    std::cout << "[DEBUG]    " << message << std::endl;
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+// Vyukov's bounded queue, many producers and the writer thread as the only consumer. A record at queue position `p`
+// is free while its sequence is `p` and ready for the writer once it is `p + 1`
+struct LogRecord {
+    std::atomic<uintmax_t> sequence{ 0 };
+    LogLevel level = LOG_LEVEL_DEBUG;
+    bool truncated = false;
+    uint32_t suppressed_count = 0;
+    const char* format = nullptr;  // nullptr for preformatted text, held by the payload or `long_text`
+    char* long_text = nullptr;  // Preformatted text that did not fit the payload, freed by the writer
+    uint16_t payload_size = 0;
+    unsigned char payload[LOG_RECORD_PAYLOAD_SIZE];
+};
+
+struct LogWriter {
+    alignas(64) std::atomic<uintmax_t> enqueue_position{ 0 };
+    alignas(64) std::atomic<uintmax_t> written_position{ 0 };  // Records before it are on stdout
+    std::atomic<int64_t> clock_ms{ 0 };  // Coarse clock for the call site rate limits, advanced by the writer
+    std::atomic<uint64_t> dropped_count{ 0 };
+    std::atomic<bool> output_enabled{ true };
+    std::atomic<bool> stopping{ false };
+    std::atomic<bool> stopped{ false };
+
+    LogRecord records[LOG_QUEUE_CAPACITY];
+    std::thread thread;
+
+    // Writer thread only
+    std::chrono::steady_clock::time_point start_time;
+    std::string line;
+    std::string previous_line;
+    LogLevel previous_level = LOG_LEVEL_DEBUG;
+    uintmax_t repeat_count = 0;
+
+    LogWriter();
+    ~LogWriter();
+};
+
+static const char* s_level_labels[] = {
+    "[DEBUG]    ",
+    "[INFO]     ",
+    "[WARNING]  ",
+    "[ERROR]    ",
+    "[CRITICAL] ",
+};
+
+static void put_log_line(LogWriter& writer, LogLevel level, const std::string& text)
+{
+    if (!writer.output_enabled.load(std::memory_order_relaxed)) return;
+
+    std::fputs(s_level_labels[level], stdout);
+    std::fwrite(text.data(), 1, text.size(), stdout);
+    std::fputc('\n', stdout);
+}
+
+static void put_repeat_count(LogWriter& writer)
+{
+    if (writer.repeat_count == 0) return;
+
+    put_log_line(writer, writer.previous_level, "Previous message repeated " + std::to_string(writer.repeat_count) + " more times");
+    writer.repeat_count = 0;
+}
+
+// Appends the next argument in `payload` to `line`, false once the payload is used up
+static bool format_log_argument(std::string& line, const unsigned char* payload, uintmax_t payload_size, uintmax_t& offset)
+{
+    if (offset >= payload_size) return false;
+
+    char buffer[64];
+    LogArgumentType type = (LogArgumentType)payload[offset++];
+    switch (type) {
+        case LOG_ARGUMENT_INT: {
+            int64_t value;
+            std::memcpy(&value, payload + offset, sizeof(value));
+            offset += sizeof(value);
+            std::snprintf(buffer, sizeof(buffer), "%lld", (long long)value);
+            line += buffer;
+            break;
+        }
+        case LOG_ARGUMENT_UINT: {
+            uint64_t value;
+            std::memcpy(&value, payload + offset, sizeof(value));
+            offset += sizeof(value);
+            std::snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)value);
+            line += buffer;
+            break;
+        }
+        case LOG_ARGUMENT_DOUBLE: {
+            double value;
+            std::memcpy(&value, payload + offset, sizeof(value));
+            offset += sizeof(value);
+            line += std::to_string(value);
+            break;
+        }
+        case LOG_ARGUMENT_BOOL: {
+            bool value;
+            std::memcpy(&value, payload + offset, sizeof(value));
+            offset += sizeof(value);
+            line += value ? "true" : "false";
+            break;
+        }
+        case LOG_ARGUMENT_CHAR: {
+            line += (char)payload[offset];
+            offset += sizeof(char);
+            break;
+        }
+        case LOG_ARGUMENT_STRING: {
+            uint16_t length;
+            std::memcpy(&length, payload + offset, sizeof(length));
+            offset += sizeof(length);
+            line.append((const char*)payload + offset, length);
+            offset += length;
+            break;
+        }
+    }
+    return true;
+}
+
+static void format_log_record(std::string& line, const LogRecord& record)
+{
+    line.clear();
+    if (!record.format) {
+        if (record.long_text) line += record.long_text;
+        else line.append((const char*)record.payload, record.payload_size);
+        return;
+    }
+
+    uintmax_t offset = 0;
+    for (const char* c = record.format; *c; c++) {
+        if (c[0] == '{' && c[1] == '}') {
+            if (!format_log_argument(line, record.payload, record.payload_size, offset)) line += record.truncated ? "..." : "{?}";
+            c++;
+        } else {
+            line += *c;
+        }
+    }
+    if (record.suppressed_count > 0) line += " (" + std::to_string(record.suppressed_count) + " similar messages suppressed)";
+}
+
+static void write_log_line(LogWriter& writer, const LogRecord& record)
+{
+    format_log_record(writer.line, record);
+
+    // Identical consecutive lines collapse into a count, printed once something else is logged
+    if (writer.line == writer.previous_line && record.level == writer.previous_level) {
+        writer.repeat_count++;
+        return;
+    }
+    put_repeat_count(writer);
+    put_log_line(writer, record.level, writer.line);
+
+    std::swap(writer.line, writer.previous_line);
+    writer.previous_level = record.level;
+}
+
+static void run_log_writer(LogWriter& writer)
+{
+    uintmax_t position = 0;
+    while (true) {
+        writer.clock_ms.store(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - writer.start_time).count(), std::memory_order_relaxed);
+        bool stopping = writer.stopping.load(std::memory_order_acquire);
+
+        // Bounded so the clock keeps moving under a steady stream of records
+        uintmax_t written_count = 0;
+        while (written_count < LOG_QUEUE_CAPACITY) {
+            LogRecord& record = writer.records[position & (LOG_QUEUE_CAPACITY - 1)];
+            if (record.sequence.load(std::memory_order_acquire) != position + 1) break;
+
+            write_log_line(writer, record);
+            std::free(record.long_text);
+            record.long_text = nullptr;
+
+            record.sequence.store(position + LOG_QUEUE_CAPACITY, std::memory_order_release);
+            position++;
+            written_count++;
+        }
+
+        uint64_t dropped_count = writer.dropped_count.exchange(0, std::memory_order_relaxed);
+        if (dropped_count > 0) {
+            put_repeat_count(writer);
+            put_log_line(writer, LOG_LEVEL_WARNING, "[LOG] " + std::to_string(dropped_count) + " messages dropped, the log queue was full");
+            writer.previous_line.clear();
+        }
+
+        if (written_count > 0 || dropped_count > 0) {
+            std::fflush(stdout);
+            writer.written_position.store(position, std::memory_order_release);
+            continue;
+        }
+        if (stopping) break;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    put_repeat_count(writer);
+    std::fflush(stdout);
+}
+
+LogWriter::LogWriter()
+{
+    for (uintmax_t i = 0; i < LOG_QUEUE_CAPACITY; i++) records[i].sequence.store(i, std::memory_order_relaxed);
+    start_time = std::chrono::steady_clock::now();
+    thread = std::thread(run_log_writer, std::ref(*this));
+}
+
+LogWriter::~LogWriter()
+{
+    stopping.store(true, std::memory_order_release);
+    thread.join();
+    stopped.store(true, std::memory_order_release);
+}
+
+// Started by the first message and drained when static objects are destroyed at exit
+static LogWriter& get_log_writer()
+{
+    static LogWriter writer;
+    return writer;
+}
+
+// nullptr if the queue is full and `level` is allowed to drop
+static LogRecord* claim_log_record(LogWriter& writer, LogLevel level, uintmax_t& position)
+{
+    position = writer.enqueue_position.load(std::memory_order_relaxed);
+    while (true) {
+        LogRecord& record = writer.records[position & (LOG_QUEUE_CAPACITY - 1)];
+        intmax_t difference = (intmax_t)record.sequence.load(std::memory_order_acquire) - (intmax_t)position;
+        if (difference == 0) {
+            if (writer.enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) return &record;
+        } else if (difference < 0) {
+            if (level < LOG_LEVEL_ERROR) {
+                writer.dropped_count.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            std::this_thread::yield();
+            position = writer.enqueue_position.load(std::memory_order_relaxed);
+        } else {
+            position = writer.enqueue_position.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// The record belongs to the writer once published, so nothing of it is read afterwards
+static void publish_log_record(LogRecord& record, uintmax_t position)
+{
+    bool critical = record.level == LOG_LEVEL_CRITICAL;
+    record.sequence.store(position + 1, std::memory_order_release);
+    if (critical) flush_log();
+}
+
+int64_t acquire_log_site(LogSite& site)
+{
+    if (site.limit == 0) return 0;
+
+    int64_t now_ms = get_log_writer().clock_ms.load(std::memory_order_relaxed);
+    int64_t window_start_ms = site.window_start_ms.load(std::memory_order_relaxed);
+    if (now_ms - window_start_ms >= LOG_SITE_RATE_WINDOW_MS && site.window_start_ms.compare_exchange_strong(window_start_ms, now_ms, std::memory_order_relaxed)) {
+        site.window_count.store(0, std::memory_order_relaxed);
+    }
+
+    if (site.window_count.fetch_add(1, std::memory_order_relaxed) >= site.limit) {
+        site.suppressed_count.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+    if (site.suppressed_count.load(std::memory_order_relaxed) == 0) return 0;
+    return site.suppressed_count.exchange(0, std::memory_order_relaxed);
+}
+
+void write_log_record(LogLevel level, const char* format, uint32_t suppressed_count, const LogPayload& payload)
+{
+    uintmax_t position;
+    LogRecord* record = claim_log_record(get_log_writer(), level, position);
+    if (!record) return;
+
+    record->level = level;
+    record->truncated = payload.truncated;
+    record->suppressed_count = suppressed_count;
+    record->format = format;
+    record->payload_size = (uint16_t)payload.size;
+    std::memcpy(record->payload, payload.bytes, payload.size);
+    publish_log_record(*record, position);
+}
+
+static void write_log_text(LogLevel level, const std::string& message)
+{
+    uintmax_t position;
+    LogRecord* record = claim_log_record(get_log_writer(), level, position);
+    if (!record) return;
+
+    record->level = level;
+    record->truncated = false;
+    record->suppressed_count = 0;
+    record->format = nullptr;
+    if (message.size() <= LOG_RECORD_PAYLOAD_SIZE) {
+        record->payload_size = (uint16_t)message.size();
+        std::memcpy(record->payload, message.data(), message.size());
+    } else {
+        record->long_text = (char*)std::malloc(message.size() + 1);
+        if (record->long_text) std::memcpy(record->long_text, message.c_str(), message.size() + 1);
+        record->payload_size = 0;
+    }
+    publish_log_record(*record, position);
+}
+
+void flush_log()
+{
+    LogWriter& writer = get_log_writer();
+    uintmax_t position = writer.enqueue_position.load(std::memory_order_acquire);
+    while (writer.written_position.load(std::memory_order_acquire) < position && !writer.stopped.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void set_log_output_enabled(bool enabled)
+{
+    get_log_writer().output_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void log_debug(const std::string& message)
+{
+    if constexpr (log_level_enabled(LOG_LEVEL_DEBUG)) write_log_text(LOG_LEVEL_DEBUG, message);
 }
-#endif
 
-#ifdef LOG_DISABLE_INFO
-void log_info(std::string message) { };
-#else
-void log_info(std::string message) {
-    std::cout << "[INFO]     " << message << std::endl;
+void log_info(const std::string& message)
+{
+    if constexpr (log_level_enabled(LOG_LEVEL_INFO)) write_log_text(LOG_LEVEL_INFO, message);
 }
-#endif
 
-#ifdef LOG_DISABLE_WARNING
-void log_warning(std::string message) { };
-#else
-void log_warning(std::string message) {
-    std::cout << "[WARNING]  " << message << std::endl;
+void log_warning(const std::string& message)
+{
+    if constexpr (log_level_enabled(LOG_LEVEL_WARNING)) write_log_text(LOG_LEVEL_WARNING, message);
 }
-#endif
 
-#ifdef LOG_DISABLE_ERROR
-void log_error(std::string message) { };
-#else
-void log_error(std::string message) {
-    std::cout << "[WARNING]  " << message << std::endl;
+void log_error(const std::string& message)
+{
+    if constexpr (log_level_enabled(LOG_LEVEL_ERROR)) write_log_text(LOG_LEVEL_ERROR, message);
 }
-#endif
 
-#ifdef LOG_DISABLE_CRITICAL
-void log_critical(std::string message) { };
-#else
-void log_critical(std::string message) {
-    std::cout << "[CRITICAL] " << message << std::endl;
+void log_critical(const std::string& message)
+{
+    if constexpr (log_level_enabled(LOG_LEVEL_CRITICAL)) write_log_text(LOG_LEVEL_CRITICAL, message);
 }
-#endif
@@ -1,9 +1,177 @@
 #pragma once
 
-#include <iostream>
+#include "typedefs.h"
 
-void log_debug(std::string message);
-void log_info(std::string message);
-void log_warning(std::string message);
-void log_error(std::string message);
-void log_critical(std::string message);
\ No newline at end of file
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Records between the logging threads and the writer thread, a power of two. When it is full debug, info and
+// warning records are dropped and counted, errors and criticals wait for room
+#define LOG_QUEUE_CAPACITY 4096
+// Argument bytes one record carries, longer string arguments are cut
+#define LOG_RECORD_PAYLOAD_SIZE 224
+
+// Messages one `LOG_DEBUG`/`LOG_INFO`/`LOG_WARNING` call site may emit per window, the rest are counted and reported with
+// the next one let through. Errors and criticals are never limited, a burst of them must not go unreported
+#define LOG_SITE_RATE_LIMIT 8
+#define LOG_SITE_RATE_WINDOW_MS 1000
+
+enum LogLevel : uint8_t {
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARNING,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_CRITICAL,
+};
+
+// `LOG_DISABLE_<LEVEL>` compiles a level out, `LOG_*` arguments of a disabled level are never evaluated
+constexpr bool log_level_enabled(LogLevel level)
+{
+#ifdef LOG_DISABLE_DEBUG
+    if (level == LOG_LEVEL_DEBUG) return false;
+#endif
+#ifdef LOG_DISABLE_INFO
+    if (level == LOG_LEVEL_INFO) return false;
+#endif
+#ifdef LOG_DISABLE_WARNING
+    if (level == LOG_LEVEL_WARNING) return false;
+#endif
+#ifdef LOG_DISABLE_ERROR
+    if (level == LOG_LEVEL_ERROR) return false;
+#endif
+#ifdef LOG_DISABLE_CRITICAL
+    if (level == LOG_LEVEL_CRITICAL) return false;
+#endif
+    return true;
+}
+
+// Preformatted messages, for setup and shutdown paths where building the string does not matter
+void log_debug(const std::string& message);
+void log_info(const std::string& message);
+void log_warning(const std::string& message);
+void log_error(const std::string& message);
+void log_critical(const std::string& message);
+
+// Hot path logging, `format` has to be a string literal with a `{}` per argument. Arguments are copied into the
+// record as they are and formatted on the writer thread, so a call neither allocates nor takes a lock:
+//
+//     LOG_WARNING("[ARENA] Frame {} made {} heap allocations", frame_index, allocation_count);
+//
+// Integers, floating point values (printed like `std::to_string`), bools, chars, C strings and `std::string`s are accepted
+#define LOG_AT(level, ...) do { \
+    if constexpr (log_level_enabled(level)) { \
+        static LogSite log_site; \
+        log_at_site(log_site, level, __VA_ARGS__); \
+    } \
+} while (0)
+
+#define LOG_DEBUG(...)    LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...)     LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARNING(...)  LOG_AT(LOG_LEVEL_WARNING, __VA_ARGS__)
+#define LOG_ERROR(...)    LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_CRITICAL(...) LOG_AT(LOG_LEVEL_CRITICAL, __VA_ARGS__)
+
+// Blocks until every record queued so far is written. Criticals flush on their own
+void flush_log();
+
+// Formatted lines are still built but not printed while disabled, for measuring the logger itself
+void set_log_output_enabled(bool enabled);
+
+// Per call site rate limit state, one static instance per `LOG_*` expansion
+struct LogSite {
+    std::atomic<int64_t> window_start_ms{ -LOG_SITE_RATE_WINDOW_MS };
+    std::atomic<uint32_t> window_count{ 0 };
+    std::atomic<uint32_t> suppressed_count{ 0 };
+    uint32_t limit = LOG_SITE_RATE_LIMIT;  // 0 never limits
+};
+
+// Argument encoding, internal to the `LOG_*` macros
+enum LogArgumentType : uint8_t {
+    LOG_ARGUMENT_INT,
+    LOG_ARGUMENT_UINT,
+    LOG_ARGUMENT_DOUBLE,
+    LOG_ARGUMENT_BOOL,
+    LOG_ARGUMENT_CHAR,
+    LOG_ARGUMENT_STRING,  // uint16_t length, then the characters
+};
+
+struct LogPayload {
+    unsigned char bytes[LOG_RECORD_PAYLOAD_SIZE];
+    uintmax_t size = 0;
+    bool truncated = false;  // An argument did not fit, it and every later one are missing
+};
+
+// Returns the number of messages suppressed since the last one let through, or -1 if this one is suppressed too
+int64_t acquire_log_site(LogSite& site);
+
+void write_log_record(LogLevel level, const char* format, uint32_t suppressed_count, const LogPayload& payload);
+
+inline void encode_log_value(LogPayload& payload, LogArgumentType type, const void* value, uintmax_t size)
+{
+    if (payload.truncated || payload.size + 1 + size > LOG_RECORD_PAYLOAD_SIZE) {
+        payload.truncated = true;
+        return;
+    }
+    payload.bytes[payload.size] = type;
+    std::memcpy(payload.bytes + payload.size + 1, value, size);
+    payload.size += 1 + size;
+}
+
+inline void encode_log_string(LogPayload& payload, const char* text, uintmax_t length)
+{
+    if (payload.truncated || payload.size + 1 + sizeof(uint16_t) > LOG_RECORD_PAYLOAD_SIZE) {
+        payload.truncated = true;
+        return;
+    }
+    uint16_t stored_length = (uint16_t)std::min<uintmax_t>(length, LOG_RECORD_PAYLOAD_SIZE - payload.size - 1 - sizeof(uint16_t));
+    payload.bytes[payload.size] = LOG_ARGUMENT_STRING;
+    std::memcpy(payload.bytes + payload.size + 1, &stored_length, sizeof(uint16_t));
+    std::memcpy(payload.bytes + payload.size + 1 + sizeof(uint16_t), text, stored_length);
+    payload.size += 1 + sizeof(uint16_t) + stored_length;
+}
+
+template<typename T>
+void encode_log_argument(LogPayload& payload, const T& argument)
+{
+    if constexpr (std::is_same_v<T, bool>) {
+        encode_log_value(payload, LOG_ARGUMENT_BOOL, &argument, sizeof(bool));
+    } else if constexpr (std::is_same_v<T, char>) {
+        encode_log_value(payload, LOG_ARGUMENT_CHAR, &argument, sizeof(char));
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+        int64_t value = (int64_t)argument;
+        encode_log_value(payload, LOG_ARGUMENT_INT, &value, sizeof(value));
+    } else if constexpr (std::is_integral_v<T>) {
+        uint64_t value = (uint64_t)argument;
+        encode_log_value(payload, LOG_ARGUMENT_UINT, &value, sizeof(value));
+    } else if constexpr (std::is_enum_v<T>) {
+        int64_t value = (int64_t)argument;
+        encode_log_value(payload, LOG_ARGUMENT_INT, &value, sizeof(value));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        double value = (double)argument;
+        encode_log_value(payload, LOG_ARGUMENT_DOUBLE, &value, sizeof(value));
+    } else if constexpr (std::is_convertible_v<const T&, const char*>) {
+        const char* text = argument;
+        if (!text) text = "(null)";
+        encode_log_string(payload, text, std::strlen(text));
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        std::string_view text = argument;
+        encode_log_string(payload, text.data(), text.size());
+    } else {
+        static_assert(sizeof(T) == 0, "Unsupported log argument type");
+    }
+}
+
+template<typename... Arguments>
+void log_at_site(LogSite& site, LogLevel level, const char* format, const Arguments&... arguments)
+{
+    int64_t suppressed_count = (level >= LOG_LEVEL_ERROR) ? 0 : acquire_log_site(site);
+    if (suppressed_count < 0) return;
+
+    LogPayload payload;
+    (encode_log_argument(payload, arguments), ...);
+    write_log_record(level, format, (uint32_t)suppressed_count, payload);
+}
@@ -1,5 +1,7 @@
 #include "typedefs.h"
 
+#include <algorithm>
+#include <cstdlib>
 #include <vector>
 
 #include <glad/glad.h>
@@ -11,24 +13,137 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "logging.h"
+#include "job_system.h"
+#include "frame_arena.h"
+#include "profiler.h"
 #include "shader_utils.h"
+#include "shader_program.h"
+#include "shader_permutations.h"
+#include "shader_watcher.h"
 #include "file_utils.h"
 #include "texture_utils.h"
+#include "texture_loader.h"
+#include "texture_pack.h"
+#include "materials.h"
 #include "lights.h"
-
-#define MAX_POINT_LIGHT_COUNT 32
+#include "light_buffer.h"
+#include "light_culling.h"
+#include "light_soa.h"
+#include "gbuffer.h"
+#include "sprite_batch.h"
+#include "quad_instances.h"
+#include "render_queue.h"
+#include "frame_pacer.h"
+#include "headless_context.h"
+#include "frame_recorder.h"
+#include "benchmarks.h"
 
 namespace Engine
 {
+    enum RenderPath {
+        RENDER_PATH_FORWARD,
+        RENDER_PATH_DEFERRED,  // G-buffer pass, then one full-screen lighting pass
+    };
+
+    enum SpritePath {
+        SPRITE_PATH_BATCH,      // Vertices expanded on the CPU, see `sprite_batch.h`
+        SPRITE_PATH_INSTANCED,  // One record per sprite, see `quad_instances.h`
+    };
+
+    // Uniforms of the scene programs, resolved per shader variant. A program lacks the ones its stages do not declare
+    enum SceneUniform {
+        SCENE_UNIFORM_VIEW_MATRIX,
+        SCENE_UNIFORM_PROJECTION_MATRIX,
+        SCENE_UNIFORM_ALBEDO_ARRAY,
+        SCENE_UNIFORM_SURFACE_ARRAY,
+        SCENE_UNIFORM_GBUFFER_ALBEDO,
+        SCENE_UNIFORM_GBUFFER_SURFACE,
+        SCENE_UNIFORM_LIGHT_MASK,
+        SCENE_UNIFORM_AMBIENT_LIGHT,
+        SCENE_UNIFORM_CAMERA_POS,
+        SCENE_UNIFORM_VIEWPORT_SIZE,
+        SCENE_UNIFORM_LIGHT_TILE_RANGES,
+        SCENE_UNIFORM_LIGHT_TILE_INDICES,
+        SCENE_UNIFORM_LIGHT_TILE_COUNT_X,
+        SCENE_UNIFORM_COUNT,
+    };
+
+    // Draw order of the render queue, a layer finishes before the next one starts
+    enum SceneLayer : uint8_t {
+        SCENE_LAYER_GBUFFER_BACKGROUND,
+        SCENE_LAYER_GBUFFER_SPRITES,
+        SCENE_LAYER_BACKGROUND,  // Final framebuffer, the forward quad or the deferred lighting
+        SCENE_LAYER_SPRITES,
+    };
+
+    static const char* s_scene_uniform_names[SCENE_UNIFORM_COUNT] = {
+        "u_view_matrix",
+        "u_projection_matrix",
+        "u_albedo_array",
+        "u_surface_array",
+        "u_gbuffer_albedo",
+        "u_gbuffer_surface",
+        "u_light_mask",
+        "u_ambient_light",
+        "u_camera_pos",
+        "u_viewport_size",
+        "u_light_tile_ranges",
+        "u_light_tile_indices",
+        "u_light_tile_count_x",
+    };
+
     struct Context {
         uintmax_t screen_size_x = -1;  // Start unresolved
         uintmax_t screen_size_y = -1;
-        SDL_Window* window;
-        SDL_GLContext gl_context;
+        SDL_Window* window = nullptr;
+        SDL_GLContext gl_context = nullptr;
+        GLADloadproc gl_load_proc = nullptr;  // For entry points GLAD does not load
+        GLuint framebuffer = 0;  // Final render target, the offscreen framebuffer when headless
+        bool headless = false;
+        HeadlessContext headless_context;
+        uintmax_t frame_limit = 0;  // 0 runs until quit
+        std::string record_directory;  // Empty when not recording
+        std::string profile_path;  // Chrome trace written on exit, empty when not profiling
+        FrameFormat record_format = FRAME_FORMAT_PNG;
+        double record_fps = 60.0;  // Fixed timestep while recording
+        RenderPath render_path = RENDER_PATH_FORWARD;
+        uint32_t shader_features = DEFAULT_SHADER_FEATURES;  // `ShaderFeature` flags of the lit programs
+        bool shader_reload = true;  // Watch `resources/shaders` and relink edited programs
+        uintmax_t job_thread_count = 0;  // 0 for all hardware threads
+        uintmax_t sprite_count = 0;
+        SpritePath sprite_path = SPRITE_PATH_BATCH;
+        FramePacingMode pacing_mode = FRAME_PACING_VSYNC;
+        double target_fps = 60.0;  // `FRAME_PACING_LIMITED` only
     } g_context;
 
+    // Simulated state of one frame. Two of them alternate: a job steps one for frame N+1 while the GL thread submits
+    // the other, the job counter they are handed over with is the only synchronisation.
+    // `arena` belongs to the frame being stepped into it: `mainLoop` resets it right before the step is started, the
+    // step's lists and binning scratch and then the frame's render queue live in it until the frame was submitted and
+    // the step after next is started
+    struct SceneFrame {
+        JobSystem* jobs = nullptr;
+        FrameArena arena;
+        RenderPath render_path = RENDER_PATH_FORWARD;  // Taken when the step starts, F1 only reaches steps started after it
+        SpritePath sprite_path = SPRITE_PATH_BATCH;
+        float time_ms = 0.0f;
+        glm::vec2 camera_pos = glm::vec2(0.0f);
+        glm::mat4 view_matrix = glm::mat4(1.0f);
+        LightSoA lights;
+        FrameVector<uint32_t> visible_lights;  // Room for `lights.capacity`
+        std::vector<GPUPointLight> gpu_lights;  // The visible lights, packed for upload
+        uintmax_t light_count = 0;
+        LightTileGrid light_tile_grid;
+        std::vector<Sprite> sprites;
+        std::vector<LightDrawBounds> sprite_bounds;
+        LightDrawCulling sprite_light_culling;  // Forward batched sprites only, the other paths light every sprite
+        uintmax_t lights_culled = 0;  // By the viewport, `light_count` made it through
+    };
+
     inline void initContext();
+    inline void simulateScene(void* data);  // `JobFunction` stepping a `SceneFrame`, no GL calls
     inline void mainLoop();
+    inline void presentFrame();
     inline void terminateContext();
 }
 
@@ -36,6 +151,23 @@ inline void Engine::initContext()
 {
     log_info("Creating engine context");
 
+    // Headless, no video subsystem, the screen size comes from `--headless WxH`
+    if (g_context.headless) {
+        log_debug("Initializing SDL2 (events only)");
+        if (SDL_Init(SDL_INIT_EVENTS) != 0) {
+            log_critical("Failed to initialize SDL\n SDL Error: " + (std::string)SDL_GetError());
+            exit(1);
+        }
+
+        if (!create_headless_context(g_context.headless_context, g_context.screen_size_x, g_context.screen_size_y)) {
+            SDL_Quit();
+            exit(1);
+        }
+        g_context.framebuffer = g_context.headless_context.framebuffer;
+        g_context.gl_load_proc = g_context.headless_context.load_proc;
+        return;
+    }
+
     // Initializing SDL
     log_debug("Initializing SDL2");
     if (SDL_Init(SDL_INIT_VIDEO) != 0) {
@@ -87,60 +219,164 @@ inline void Engine::initContext()
         SDL_Quit();
         exit(1);
     }
+    g_context.gl_load_proc = (GLADloadproc)SDL_GL_GetProcAddress;
 }
 
-inline void Engine::mainLoop()
+inline void Engine::simulateScene(void* data)
 {
-    // Mesh
-    GLsizei vertex_size = (2 + 2) * sizeof(float);
-    float vertices[] = {
-        1.0f, 0.0f,  1.0f, 0.0f,  // top right
-        1.0f, 1.0f,  1.0f, 1.0f,  // bottom right
-        0.0f, 1.0f,  0.0f, 1.0f,  // bottom left
-        0.0f, 0.0f,  0.0f, 0.0f,  // top left 
-    };
-    unsigned int indices[] = {
-        0, 1, 3,
-        1, 2, 3
-    };
+    PROFILE_ZONE("Scene step");
+    SceneFrame& scene = *(SceneFrame*)data;
+
+    float time_ms = scene.time_ms;
+
+    // Flicker, then drop the lights that cannot reach the viewport before they are packed for upload
+    animate_light_soa(scene.lights, time_ms);
+
+    glm::vec2 viewport_size = glm::vec2((float)g_context.screen_size_x, (float)g_context.screen_size_y);
+    begin_frame_vector(scene.visible_lights, scene.arena);
+    scene.visible_lights.resize(scene.lights.capacity);
+    uintmax_t visible_count = cull_light_soa(scene.lights, scene.camera_pos, scene.camera_pos + viewport_size, scene.visible_lights.data());
+    scene.lights_culled = scene.lights.count - visible_count;
+    scene.light_count = std::min(visible_count, (uintmax_t)MAX_POINT_LIGHT_COUNT);
+    pack_light_soa(scene.lights, scene.visible_lights.data(), scene.light_count, scene.gpu_lights.data());
+
+    // Sprites spin in place. Only the forward pass draws batched sprites unlit, so only it needs their bounds
+    bool cull_sprite_lights = scene.render_path == RENDER_PATH_FORWARD && scene.sprite_path == SPRITE_PATH_BATCH;
+    std::vector<Sprite>& sprites = scene.sprites;
+    std::vector<LightDrawBounds>& sprite_bounds = scene.sprite_bounds;
+    parallel_for(*scene.jobs, sprites.size(), 4096, [&sprites, &sprite_bounds, cull_sprite_lights, time_ms](uintmax_t begin, uintmax_t end) {
+        for (uintmax_t i = begin; i < end; i++) {
+            sprites[i].rotation = time_ms * 0.001f + (float)i;
+            if (cull_sprite_lights) get_sprite_bounds(sprites[i], sprite_bounds[i].min, sprite_bounds[i].max);
+        }
+    });
 
-    GLuint VAO, VBO, EBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    // Camera, static for now
+    scene.view_matrix = glm::mat4(1.0f);
 
-    glBindVertexArray(VAO);
+    // Lights go through the tile grid after they were animated
+    bin_point_lights(scene.light_tile_grid, scene.gpu_lights.data(), scene.light_count, scene.camera_pos, g_context.screen_size_x, g_context.screen_size_y, *scene.jobs, scene.arena);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    // And per sprite, so sprites out of every light's reach can skip lighting
+    if (cull_sprite_lights) cull_lights_per_draw(scene.sprite_light_culling, scene.gpu_lights.data(), scene.light_count, sprite_bounds.data(), sprites.size(), *scene.jobs, scene.arena);
+}
 
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, vertex_size, (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, vertex_size, (void*)(2 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+inline void Engine::mainLoop()
+{
+    // Texture decode, light binning, sprite sorting and light animation run on it
+    JobSystem jobs;
+    start_job_system(jobs, g_context.job_thread_count);
+
+    // Mesh, the background is instance 0 and instanced sprites follow it
+    QuadInstances quad_instances;
+    create_quad_instances(quad_instances, 1 + ((g_context.sprite_path == SPRITE_PATH_INSTANCED) ? g_context.sprite_count : 0));
+
+    // Shader, linked programs are cached on disk so a warm start skips compiling
+    uint64_t shader_start_counter = SDL_GetPerformanceCounter();
+    ProgramCache program_cache;
+    open_program_cache(program_cache, PROGRAM_CACHE_DIRECTORY, g_context.gl_load_proc);
+
+    // Headers are read once and shared, `engine/lights.glsl` is generated from the C++ light constants
+    ShaderPreprocessor shader_preprocessor;
+    add_generated_shader_file(shader_preprocessor, "engine/lights.glsl", get_light_shader_header());
+
+    // Shader: Lit, one variant per light bucket and feature set compiled the first time a frame needs it
+    std::vector<std::string> scene_uniform_names(s_scene_uniform_names, s_scene_uniform_names + SCENE_UNIFORM_COUNT);
+
+    ShaderPermutations quad_permutations;
+    create_shader_permutations(quad_permutations, "quad", "../resources/shaders/generic.vs", "../resources/shaders/generic.fs", scene_uniform_names, shader_preprocessor, &program_cache);
+
+    // Shader: Deferred, the G-buffer programs are unlit and have a single variant
+    ShaderPermutations gbuffer_permutations;
+    create_shader_permutations(gbuffer_permutations, "gbuffer", "../resources/shaders/generic.vs", "../resources/shaders/gbuffer.fs", scene_uniform_names, shader_preprocessor, &program_cache);
+    ShaderVariant& gbuffer_variant = get_shader_variant(gbuffer_permutations, 0, 0);
+
+    ShaderPermutations deferred_lighting_permutations;
+    create_shader_permutations(deferred_lighting_permutations, "deferred lighting", "../resources/shaders/deferred_lighting.vs", "../resources/shaders/deferred_lighting.fs", scene_uniform_names, shader_preprocessor, &program_cache);
+
+    // Shader: Sprites, same fragment stages fed by world space vertices
+    ShaderPermutations sprite_permutations;
+    create_shader_permutations(sprite_permutations, "sprite", "../resources/shaders/sprite_batch.vs", "../resources/shaders/generic.fs", scene_uniform_names, shader_preprocessor, &program_cache);
+
+    ShaderPermutations sprite_gbuffer_permutations;
+    create_shader_permutations(sprite_gbuffer_permutations, "sprite gbuffer", "../resources/shaders/sprite_batch.vs", "../resources/shaders/gbuffer.fs", scene_uniform_names, shader_preprocessor, &program_cache);
+    ShaderVariant& sprite_gbuffer_variant = get_shader_variant(sprite_gbuffer_permutations, 0, 0);
+
+    // Edited shaders relink in the background, the swap happens in place so the variant references above stay valid
+    ShaderPermutations* shader_permutation_sets[] = { &quad_permutations, &gbuffer_permutations, &deferred_lighting_permutations, &sprite_permutations, &sprite_gbuffer_permutations };
+    ShaderWatcher shader_watcher;
+    std::vector<ShaderSourceUpdate> shader_updates;
+    if (g_context.shader_reload) {
+        enable_parallel_shader_compile(g_context.gl_load_proc);
+
+        std::vector<std::string> shader_paths;
+        for (ShaderPermutations* permutations : shader_permutation_sets) {
+            for (const std::string* path : { &permutations->vertex_shader_path, &permutations->fragment_shader_path }) {
+                if (std::find(shader_paths.begin(), shader_paths.end(), *path) == shader_paths.end()) shader_paths.push_back(*path);
+            }
+        }
+        start_shader_watcher(shader_watcher, "../resources/shaders", shader_preprocessor, shader_paths);
+    }
+
+    log_info("[SHADER] Programs ready after " + std::to_string((double)(SDL_GetPerformanceCounter() - shader_start_counter) * 1000.0 / (double)SDL_GetPerformanceFrequency()) + " ms, " +
+        std::to_string(shader_preprocessor.read_count) + " shader files read");
+
+    GBuffer gbuffer;
+    if (!create_gbuffer(gbuffer, g_context.screen_size_x, g_context.screen_size_y)) {
+        log_warning("Deferred render path unavailable, using forward");
+        g_context.render_path = RENDER_PATH_FORWARD;
+    }
 
-    // Shader
-    GLuint shader_program = create_generic_shader(
-        Engine::read_text_file("../resources/shaders/generic.vs").c_str(),
-        Engine::read_text_file("../resources/shaders/generic.fs").c_str());
+    // Draws are recorded as sorted commands, the backend skips binds that would not change anything
+    RenderQueue render_queue;
+    create_render_queue(render_queue, jobs);
+    RenderBackend render_backend;
+    create_render_backend(render_backend);
 
     // Texture
 
-    Engine::TextureInfo texture_info;
-    GLuint diffuse_texture = Engine::load_texture("../assets/textures/brick_00/diffuse.jpg", GL_CLAMP_TO_EDGE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_RGB, GL_RGB, texture_info);
-    GLuint normal_texture = Engine::load_texture("../assets/textures/brick_00/normal.jpg", GL_CLAMP_TO_EDGE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_RGB, GL_RGB);
-    GLuint ao_texture = Engine::load_texture("../assets/textures/brick_00/ao.jpg", GL_CLAMP_TO_EDGE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_RED, GL_RED);
-    GLuint roughness_texture = Engine::load_texture("../assets/textures/brick_00/roughness.jpg", GL_CLAMP_TO_EDGE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_RED, GL_RED);
+    // Decoded in the background, the texture names are valid right away and show a placeholder until uploaded
+    TextureLoader texture_loader;
+    start_texture_loader(texture_loader, jobs);
+
+    // Cooked by `texture_cook.exe`, falls back to decoding the source images when missing
+    TexturePack texture_pack;
+    if (open_texture_pack(texture_pack, "../assets/textures.pack")) {
+        attach_texture_pack(texture_loader, &texture_pack, "../assets/textures/");
+    }
+
+    // Materials, all authored at 1024x512
+    MaterialAtlas material_atlas;
+    create_material_atlas(material_atlas, 1024, 512, 16);
 
-    GLuint light_mask = Engine::load_texture("../assets/light_masks/flashlight.png", GL_CLAMP_TO_EDGE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_RGB, GL_RGB);
+    intmax_t brick_material = request_material(material_atlas, texture_loader, "../assets/textures/brick_00/");
+
+    // Sprites, `--sprites N` scatters N spinning sprites over the background
+    SpriteBatch sprite_batch;
+    create_sprite_batch(sprite_batch, (g_context.sprite_path == SPRITE_PATH_BATCH) ? std::max(g_context.sprite_count, (uintmax_t)1) : 1);
+
+    std::vector<Sprite> sprites(g_context.sprite_count);
+    for (uintmax_t i = 0; i < sprites.size(); i++) {
+        sprites[i].position = glm::vec2((float)((i * 7919) % g_context.screen_size_x), (float)((i * 104729) % g_context.screen_size_y));
+        sprites[i].size = glm::vec2(128.0f, 64.0f);  // Material aspect ratio
+        sprites[i].material_layer = (float)brick_material;
+    }
+
+    GLuint light_mask = get_texture(texture_loader, Engine::request_texture(texture_loader, "../assets/light_masks/flashlight.png", GL_CLAMP_TO_EDGE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_RGB, GL_RGB));
 
     // Camera
+    glm::vec2 camera_pos(0.0f, 0.0f);
     glm::mat4 projection_matrix = glm::ortho(0.0f, (float)g_context.screen_size_x, (float)g_context.screen_size_y, 0.0f, -128.0f, 128.0f);
 
     // Lights
+    PointLightBuffer point_light_buffer;
+    create_point_light_buffer(point_light_buffer);
+
+    LightTileBuffers light_tile_buffers;
+    create_light_tile_buffers(light_tile_buffers);
+
     std::vector<PointLight> point_lights;
+    std::vector<LightFlicker> light_flickers;
 
     // point_lights.push_back(PointLight{
     //     glm::vec3(1.0f, 0.0f, 0.0f),
@@ -170,6 +406,20 @@ inline void Engine::mainLoop()
             1.0f,
             512.0f
         });
+
+        // Four sines around 2 weighted by 0.2, 0.3, 0.5 and 0.2, out of phase per light
+        LightFlicker flicker;
+        const float frequencies[LIGHT_FLICKER_TERM_COUNT] = { 0.004f, 0.005f, 0.007f, 0.0045f };
+        const float phase_offsets_ms[LIGHT_FLICKER_TERM_COUNT] = { 120.0f, 300.0f, 60.0f, 400.0f };
+        const float weights[LIGHT_FLICKER_TERM_COUNT] = { 0.2f, 0.3f, 0.5f, 0.2f };
+        flicker.base = 0.0f;
+        for (int term = 0; term < LIGHT_FLICKER_TERM_COUNT; term++) {
+            flicker.base += 2.0f * weights[term];
+            flicker.frequency[term] = frequencies[term];
+            flicker.phase[term] = (float)i * phase_offsets_ms[term] * frequencies[term];
+            flicker.weight[term] = weights[term];
+        }
+        light_flickers.push_back(flicker);
     }
 
     for (int i = 0; i < 16; i++)
@@ -178,158 +428,476 @@ inline void Engine::mainLoop()
             glm::vec3(1.0f, 0.6078f, 0.0f),
             glm::vec2((float)g_context.screen_size_x / 16.0f * (float)i, (float)g_context.screen_size_y),
             1.0f,
-            512.0f,
+            1024.0f,
             256.0f,
             {
                 0.00175f * 0.2f,
                 0.00005f * 0.2f
             }
         });
+
+        // Slower and dimmer, four sines around 1.25
+        LightFlicker flicker;
+        const float frequencies[LIGHT_FLICKER_TERM_COUNT] = { 0.002f, 0.0025f, 0.002f, 0.001f };
+        const float phase_offsets_ms[LIGHT_FLICKER_TERM_COUNT] = { 120.0f, 300.0f, 60.0f, 400.0f };
+        const float weights[LIGHT_FLICKER_TERM_COUNT] = { 0.1f, 0.05f, 0.15f, 0.12f };
+        flicker.base = 0.0f;
+        for (int term = 0; term < LIGHT_FLICKER_TERM_COUNT; term++) {
+            flicker.base += 1.25f * weights[term];
+            flicker.frequency[term] = frequencies[term];
+            flicker.phase[term] = (float)i * phase_offsets_ms[term] * frequencies[term];
+            flicker.weight[term] = weights[term];
+        }
+        light_flickers.push_back(flicker);
+    }
+
+    // Animated, culled and packed in bulk by every scene step
+    LightSoA lights;
+    reserve_light_soa(lights, point_lights.size());
+    for (uintmax_t i = 0; i < point_lights.size(); i++) add_light(lights, point_lights[i], light_flickers[i]);
+
+    if (point_lights.size() > MAX_POINT_LIGHT_COUNT) {
+        LOG_WARNING("Point light buffer size exceeded MAX_POINT_LIGHT_COUNT value ({})", MAX_POINT_LIGHT_COUNT);
     }
-    
-    
+
+    // Variants for every light count the viewport culling can leave, built here rather than inside a frame
+    uintmax_t light_count = std::min(point_lights.size(), (size_t)MAX_POINT_LIGHT_COUNT);
+    build_shader_variants(quad_permutations, light_count, g_context.shader_features);
+    build_shader_variants(sprite_permutations, light_count, g_context.shader_features);
+    build_shader_variants(deferred_lighting_permutations, light_count, g_context.shader_features);
+
+    // Simulation, frame N+1 is stepped on the job threads while this thread submits frame N
+    SceneFrame scene_frames[2];
+    for (SceneFrame& scene_frame : scene_frames) {
+        scene_frame.jobs = &jobs;
+        create_frame_arena(scene_frame.arena, 4 * 1024 * 1024 + sprites.size());  // And a lit flag per sprite
+        scene_frame.camera_pos = camera_pos;
+        copy_light_soa(scene_frame.lights, lights);
+        scene_frame.gpu_lights.resize(MAX_POINT_LIGHT_COUNT);
+        scene_frame.sprites = sprites;
+        scene_frame.sprite_bounds.resize(sprites.size());
+    }
+    JobCounter scene_step_counter;
+
+    // Recording, every frame advances the animation by a fixed step and starts with all textures resident
+    bool recording = !g_context.record_directory.empty();
+    FrameRecorder frame_recorder;
+    if (recording) {
+        update_texture_loader(texture_loader, true);
+        update_material_atlas(material_atlas, texture_loader);
+
+        recording = start_frame_recorder(frame_recorder, g_context.screen_size_x, g_context.screen_size_y, g_context.record_directory, g_context.record_format, 0);
+    }
+
+    FramePacer frame_pacer;
+    start_frame_pacer(frame_pacer, g_context.pacing_mode, g_context.target_fps);
+
+    bool profiling = !g_context.profile_path.empty();
+    if (profiling) start_profiler(get_job_thread_count(jobs));
+
+    // Recording steps by a fixed timestep, so the pipelined frames match a serial run exactly. The frame that used
+    // this arena before was submitted by now
+    auto start_scene_step = [&](uintmax_t step_index) {
+        SceneFrame& scene_frame = scene_frames[step_index % 2];
+        reset_frame_arena(scene_frame.arena);
+        scene_frame.time_ms = recording ? (float)((double)step_index * 1000.0 / g_context.record_fps) : (float)SDL_GetTicks();
+        scene_frame.render_path = g_context.render_path;
+        scene_frame.sprite_path = g_context.sprite_path;
+        submit_background_job(jobs, simulateScene, &scene_frame, &scene_step_counter);
+    };
 
     log_info("Entering main loop");
     bool running = true;
+    uintmax_t frame_index = 0;
+#ifdef ENGINE_COUNT_HEAP_ALLOCATIONS
+    uint64_t job_heap_allocation_count = get_shared_heap_allocation_count();
+    bool previous_steady_frame = false;
+#endif
     SDL_Event event;
+    start_scene_step(0);
     while (running) {
+        begin_profile_frame();
+
         while (SDL_PollEvent(&event)) {
             if (event.type == SDL_QUIT) {
                 running = false;
             }
+            if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F1 && gbuffer.framebuffer != 0) {
+                g_context.render_path = (g_context.render_path == RENDER_PATH_FORWARD) ? RENDER_PATH_DEFERRED : RENDER_PATH_FORWARD;
+                log_info(g_context.render_path == RENDER_PATH_FORWARD ? "Render path: forward" : "Render path: deferred");
+            }
         }
 
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        glm::mat4 view_matrix(1.0f);
+        update_texture_loader(texture_loader);
+        update_material_atlas(material_atlas, texture_loader);
 
-        // point_lights[0].position = glm::vec2(
-        //     960.0f + sin((float)SDL_GetTicks() * 0.001f) * 128.0f,
-        //     256.0f + cos((float)SDL_GetTicks() * 0.001f) * 256.0f
-        // );
-
-        // point_lights[1].position = glm::vec2(
-        //     540.0f + 256.0f + sin((float)SDL_GetTicks() * 0.0015f) * 512.0f,
-        //     540.0f - 256.0f + cos((float)SDL_GetTicks() * 0.0015f) * 128.0f
-        // );
+        // Shader reloads arrive preprocessed, the relink itself runs in the driver and is only checked here
+        if (poll_shader_watcher(shader_watcher, shader_updates)) {
+            for (ShaderPermutations* permutations : shader_permutation_sets) reload_shader_permutations(*permutations, shader_updates);
+        }
+        for (ShaderPermutations* permutations : shader_permutation_sets) update_shader_permutations(*permutations);
 
-        // point_lights[2].position = glm::vec2(
-        //     960.0f + 128.0f + sin((float)SDL_GetTicks() * 0.002f) * 512.0f,
-        //     540.0f + 256.0f + cos((float)SDL_GetTicks() * 0.002f) * 65.0f
-        // );
+        // From here to the pacer a steady state frame must not touch the heap, loading and input above may
+#ifdef ENGINE_COUNT_HEAP_ALLOCATIONS
+        bool steady_frame = frame_index >= FRAME_HEAP_CHECK_WARMUP_FRAMES && texture_loader.pending_count == 0 && material_atlas.pending_materials.empty();
+        uint64_t frame_heap_allocation_count = get_heap_allocation_count();
+#endif
 
-        for (int i = 0; i < 16; i++)
+        // Hand over this frame's scene and start stepping the next one, which overlaps everything below
         {
-            point_lights[i].energy = (
-                (sin(((float)SDL_GetTicks() + (float)i * 120.0f) * 0.004f) + 2.0) * 0.2f +
-                (sin(((float)SDL_GetTicks() + (float)i * 300.0f) * 0.005f) + 2.0) * 0.3f +
-                (sin(((float)SDL_GetTicks() + (float)i * 60.0f) * 0.007f) + 2.0) * 0.5f +
-                (sin(((float)SDL_GetTicks() + (float)i * 400.0f) * 0.0045f) + 2.0) * 0.2f
-            );
+            PROFILE_ZONE("Wait for scene");
+            wait_for_counter(jobs, scene_step_counter);
         }
 
-        for (int i = 0; i < 16; i++)
-        {
-            point_lights[16 + i].energy = (
-                (sin(((float)SDL_GetTicks() + (float)i * 120.0f) * 0.002f) + 1.25) * 0.1f +
-                (sin(((float)SDL_GetTicks() + (float)i * 300.0f) * 0.0025f) + 1.25) * 0.05f +
-                (sin(((float)SDL_GetTicks() + (float)i * 60.0f) * 0.002f) + 1.25) * 0.15f +
-                (sin(((float)SDL_GetTicks() + (float)i * 400.0f) * 0.001f) + 1.25) * 0.12f
-            );
+        // Job threads since the last handover: this frame's scene step and the jobs of the previous frame
+#ifdef ENGINE_COUNT_HEAP_ALLOCATIONS
+        uint64_t job_heap_allocations = get_shared_heap_allocation_count() - job_heap_allocation_count;
+        job_heap_allocation_count += job_heap_allocations;
+        if (previous_steady_frame && job_heap_allocations > 0) {
+            LOG_CRITICAL("[ARENA] Job threads made {} heap allocations after steady frame {}", job_heap_allocations, frame_index - 1);
+            std::abort();
         }
-        
-
-        // Quad
-        glUseProgram(shader_program);
-
-        // Uniforms: Matrices
-        glm::mat4 model_matrix(1.0f);
-        model_matrix = glm::translate(model_matrix, glm::vec3(0.0f, 0.0f, 0.0f));
-        model_matrix = glm::scale(model_matrix, glm::vec3((float)texture_info.width, (float)texture_info.height, 0.0f) * 4.0f);
-        glUniformMatrix4fv(glGetUniformLocation(shader_program, "u_model_matrix"), 1, GL_FALSE, &model_matrix[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(shader_program, "u_view_matrix"), 1, GL_FALSE, &view_matrix[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(shader_program, "u_projection_matrix"), 1, GL_FALSE, &projection_matrix[0][0]);
-
-        // Uniforms: Textures
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, diffuse_texture);
-        glUniform1i(glGetUniformLocation(shader_program, "u_diffuse_texture"), 0);
-
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, normal_texture);
-        glUniform1i(glGetUniformLocation(shader_program, "u_normal_texture"), 1);
-
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, ao_texture);
-        glUniform1i(glGetUniformLocation(shader_program, "u_ao_texture"), 2);
-
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, roughness_texture);
-        glUniform1i(glGetUniformLocation(shader_program, "u_roughness_texture"), 3);
-
-        glActiveTexture(GL_TEXTURE4);
-        glBindTexture(GL_TEXTURE_2D, light_mask);
-        glUniform1i(glGetUniformLocation(shader_program, "u_light_mask"), 4);
-
-        // Uniforms: Light: Ambient
-        // glUniform3fv(glGetUniformLocation(shader_program, "u_ambient_light"), 1, &glm::vec3(0.059f, 0.055f, 0.09f)[0]);
-        glUniform3fv(glGetUniformLocation(shader_program, "u_ambient_light"), 1, &glm::vec3(0.0f)[0]);
-
-        // Uniforms: Light: Point lights
-        int i = 0;
-        for (PointLight& point_light : point_lights) {
-            if (i > MAX_POINT_LIGHT_COUNT) {
-                log_warning("Point light buffer size exceeded MAX_POINT_LIGHT_COUNT value (" + std::to_string(MAX_POINT_LIGHT_COUNT) + ")");
-                break;
+        previous_steady_frame = steady_frame;
+#endif
+
+        SceneFrame& scene = scene_frames[frame_index % 2];
+        start_scene_step(frame_index + 1);
+
+        glViewport(0, 0, (GLsizei)g_context.screen_size_x, (GLsizei)g_context.screen_size_y);
+
+        // Background, the material tiled 4x4
+        Sprite background;
+        background.size = glm::vec2((float)material_atlas.size_x, (float)material_atlas.size_y) * 4.0f;
+        background.uv_rect = glm::vec4(0.0f, 0.0f, 4.0f, 4.0f);
+        background.material_layer = (float)brick_material;
+
+        // Lights, shared by both render paths
+        upload_point_lights(point_light_buffer, scene.gpu_lights.data(), scene.light_count);
+        upload_light_tiles(light_tile_buffers, scene.light_tile_grid);
+        light_count = scene.light_count;
+        PROFILE_COUNT(PROFILE_COUNTER_LIGHTS_EVALUATED, scene.light_count);
+        PROFILE_COUNT(PROFILE_COUNTER_LIGHTS_CULLED, scene.lights_culled);
+
+        clear_quad_instances(quad_instances);
+        add_quad_instance(quad_instances, background);
+
+        // Sprites, the forward pass uses the smallest variant holding this frame's lights and the unlit one for sprites
+        // no light reaches. The batch splits them into one run per program
+        ShaderVariant* sprite_variant = nullptr;
+        ShaderVariant* unlit_sprite_variant = nullptr;
+        if (scene.render_path == RENDER_PATH_FORWARD) {
+            sprite_variant = &get_shader_variant(sprite_permutations, light_count, g_context.shader_features);
+            unlit_sprite_variant = &get_shader_variant(sprite_permutations, 0, g_context.shader_features);
+        }
+        GLuint sprite_pass_program = sprite_variant ? sprite_variant->program.id : sprite_gbuffer_variant.program.id;
+        GLuint unlit_sprite_program = unlit_sprite_variant ? unlit_sprite_variant->program.id : sprite_pass_program;
+        bool draw_unlit_sprites = unlit_sprite_variant && scene.sprite_path == SPRITE_PATH_BATCH;  // Culled by the scene step
+
+        begin_sprite_batch(sprite_batch);
+        for (uintmax_t i = 0; i < scene.sprites.size(); i++) {
+            const Sprite& sprite = scene.sprites[i];
+            if (scene.sprite_path == SPRITE_PATH_INSTANCED) add_quad_instance(quad_instances, sprite);
+            else submit_sprite(sprite_batch, sprite, (!draw_unlit_sprites || scene.sprite_light_culling.lit[i]) ? sprite_pass_program : unlit_sprite_program);
+        }
+        if (draw_unlit_sprites) {
+            PROFILE_COUNT(PROFILE_COUNTER_LIT_SPRITES, scene.sprite_light_culling.lit_count);
+            PROFILE_COUNT(PROFILE_COUNTER_UNLIT_SPRITES, scene.sprite_light_culling.culled_count);
+        }
+        const std::vector<SpriteDrawRun>& sprite_runs = flush_sprite_batch(sprite_batch, jobs);
+
+        upload_quad_instances(quad_instances);
+
+        // Render queue, every scene program takes its uniforms from one block and skips the ones it does not declare
+        begin_render_queue(render_queue, scene.arena);
+
+        RenderUniformBlock scene_uniforms;
+        add_render_uniform(render_queue, scene_uniforms, SCENE_UNIFORM_VIEW_MATRIX, scene.view_matrix);
+        add_render_uniform(render_queue, scene_uniforms, SCENE_UNIFORM_PROJECTION_MATRIX, projection_matrix);
+        add_render_uniform(render_queue, scene_uniforms, SCENE_UNIFORM_ALBEDO_ARRAY, 0);
+        add_render_uniform(render_queue, scene_uniforms, SCENE_UNIFORM_SURFACE_ARRAY, 1);
+        add_render_uniform(render_queue, scene_uniforms, SCENE_UNIFORM_GBUFFER_ALBEDO, 0);
+        add_render_uniform(render_queue, scene_uniforms, SCENE_UNIFORM_GBUFFER_SURFACE, 1);
+        add_render_uniform(render_queue, scene_uniforms, SCENE_UNIFORM_LIGHT_MASK, 4);
+        // add_render_uniform(render_queue, scene_uniforms, SCENE_UNIFORM_AMBIENT_LIGHT, glm::vec3(0.059f, 0.055f, 0.09f));
+        add_render_uniform(render_queue, scene_uniforms, SCENE_UNIFORM_AMBIENT_LIGHT, glm::vec3(0.0f));
+        add_render_uniform(render_queue, scene_uniforms, SCENE_UNIFORM_LIGHT_TILE_RANGES, 5);
+        add_render_uniform(render_queue, scene_uniforms, SCENE_UNIFORM_LIGHT_TILE_INDICES, 6);
+        add_render_uniform(render_queue, scene_uniforms, SCENE_UNIFORM_LIGHT_TILE_COUNT_X, (GLint)scene.light_tile_grid.tile_count_x);
+        add_render_uniform(render_queue, scene_uniforms, SCENE_UNIFORM_CAMERA_POS, scene.camera_pos);
+        add_render_uniform(render_queue, scene_uniforms, SCENE_UNIFORM_VIEWPORT_SIZE, glm::vec2((float)g_context.screen_size_x, (float)g_context.screen_size_y));
+
+        RenderState clear_state;
+        clear_state.framebuffer = g_context.framebuffer;
+        clear_state.clear_color[3] = 1.0f;
+        record_clear(render_queue, SCENE_LAYER_BACKGROUND, add_render_state(render_queue, clear_state));
+
+        // Materials: the atlas for geometry, the G-buffer for deferred lighting, both lit ones with the light tiles
+        RenderMaterial atlas_material;
+        add_material_texture(atlas_material, 0, GL_TEXTURE_2D_ARRAY, material_atlas.albedo_array);
+        add_material_texture(atlas_material, 1, GL_TEXTURE_2D_ARRAY, material_atlas.surface_array);
+
+        RenderMaterial lighting_material;
+        if (g_context.shader_features & SHADER_FEATURE_LIGHT_MASK) add_material_texture(lighting_material, 4, GL_TEXTURE_2D, light_mask);
+        add_material_texture(lighting_material, 5, GL_TEXTURE_BUFFER, light_tile_buffers.tile_range_texture);
+        add_material_texture(lighting_material, 6, GL_TEXTURE_BUFFER, light_tile_buffers.light_index_texture);
+
+        RenderMaterial lit_atlas_material = lighting_material;
+        add_material_texture(lit_atlas_material, 0, GL_TEXTURE_2D_ARRAY, material_atlas.albedo_array);
+        add_material_texture(lit_atlas_material, 1, GL_TEXTURE_2D_ARRAY, material_atlas.surface_array);
+
+        add_material_texture(lighting_material, 0, GL_TEXTURE_2D, gbuffer.albedo_texture);
+        add_material_texture(lighting_material, 1, GL_TEXTURE_2D, gbuffer.surface_texture);
+
+        // Geometry, the background first and the sprite runs on top of it
+        uint8_t background_layer = SCENE_LAYER_BACKGROUND;
+        uint8_t sprite_layer = SCENE_LAYER_SPRITES;
+        uint16_t background_state;
+        uint16_t sprite_state;
+        uint16_t unlit_sprite_state;
+        uint16_t geometry_material;
+        if (scene.render_path == RENDER_PATH_FORWARD) {
+            ShaderVariant& quad_variant = get_shader_variant(quad_permutations, light_count, g_context.shader_features);
+            background_state = add_render_state(render_queue, RenderState{ &quad_variant.program, quad_variant.uniforms.data(), scene_uniforms, g_context.framebuffer });
+            sprite_state = add_render_state(render_queue, RenderState{ &sprite_variant->program, sprite_variant->uniforms.data(), scene_uniforms, g_context.framebuffer });
+            unlit_sprite_state = add_render_state(render_queue, RenderState{ &unlit_sprite_variant->program, unlit_sprite_variant->uniforms.data(), scene_uniforms, g_context.framebuffer });
+            geometry_material = add_render_material(render_queue, lit_atlas_material);
+        } else {
+            background_layer = SCENE_LAYER_GBUFFER_BACKGROUND;
+            sprite_layer = SCENE_LAYER_GBUFFER_SPRITES;
+
+            RenderState gbuffer_clear_state;
+            gbuffer_clear_state.framebuffer = gbuffer.framebuffer;
+            record_clear(render_queue, SCENE_LAYER_GBUFFER_BACKGROUND, add_render_state(render_queue, gbuffer_clear_state));
+
+            background_state = add_render_state(render_queue, RenderState{ &gbuffer_variant.program, gbuffer_variant.uniforms.data(), scene_uniforms, gbuffer.framebuffer });
+            sprite_state = add_render_state(render_queue, RenderState{ &sprite_gbuffer_variant.program, sprite_gbuffer_variant.uniforms.data(), scene_uniforms, gbuffer.framebuffer });
+            unlit_sprite_state = sprite_state;
+            geometry_material = add_render_material(render_queue, atlas_material);
+
+            // Lighting pass, cost depends on screen size and tile light counts only
+            ShaderVariant& deferred_lighting_variant = get_shader_variant(deferred_lighting_permutations, light_count, g_context.shader_features);
+            uint16_t lighting_state = add_render_state(render_queue, RenderState{ &deferred_lighting_variant.program, deferred_lighting_variant.uniforms.data(), scene_uniforms, g_context.framebuffer });
+            record_fullscreen_draw(render_queue, SCENE_LAYER_BACKGROUND, lighting_state, add_render_material(render_queue, lighting_material));
+        }
+
+        record_quad_draw(render_queue, background_layer, background_state, geometry_material, quad_instances);
+        parallel_for(jobs, sprite_runs.size(), 64, [&](uintmax_t begin, uintmax_t end) {
+            for (uintmax_t i = begin; i < end; i++) {
+                uint16_t run_state = sprite_runs[i].program == sprite_pass_program ? sprite_state : unlit_sprite_state;
+                record_sprite_draw(render_queue, sprite_layer, run_state, geometry_material, sprite_batch, sprite_runs[i], (uint32_t)i);
             }
+        });
 
-            const std::string uniform_prefix = "u_point_lights[" + std::to_string(i) + "]";
+        sort_render_queue(render_queue);
 
-            glUniform3fv(glGetUniformLocation(shader_program, (uniform_prefix + ".color").c_str()), 1, &point_light.color[0]);
-            glUniform2fv(glGetUniformLocation(shader_program, (uniform_prefix + ".position").c_str()), 1, &point_light.position[0]);
-            glUniform1f(glGetUniformLocation(shader_program, (uniform_prefix + ".energy").c_str()), point_light.energy);
-            glUniform1f(glGetUniformLocation(shader_program, (uniform_prefix + ".height").c_str()), point_light.height);
-            glUniform1f(glGetUniformLocation(shader_program, (uniform_prefix + ".attenuation_linear").c_str()), point_light.attenuation.linear);
-            glUniform1f(glGetUniformLocation(shader_program, (uniform_prefix + ".attenuation_quadratic").c_str()), point_light.attenuation.quadratic);
-            i++;
+        if (scene.render_path == RENDER_PATH_FORWARD) {
+            PROFILE_ZONE("Forward pass");
+            PROFILE_GPU_ZONE("Forward pass");
+            execute_render_queue(render_queue, render_backend, SCENE_LAYER_BACKGROUND, SCENE_LAYER_SPRITES);
+        } else {
+            {
+                PROFILE_ZONE("Geometry pass");
+                PROFILE_GPU_ZONE("Geometry pass");
+                execute_render_queue(render_queue, render_backend, SCENE_LAYER_GBUFFER_BACKGROUND, SCENE_LAYER_GBUFFER_SPRITES);
+            }
+            {
+                PROFILE_ZONE("Lighting pass");
+                PROFILE_GPU_ZONE("Lighting pass");
+                execute_render_queue(render_queue, render_backend, SCENE_LAYER_BACKGROUND, SCENE_LAYER_SPRITES);
+            }
         }
 
-        // Uniforms: Misc
-        glUniform2fv(glGetUniformLocation(shader_program, "u_camera_pos"), 1, &glm::vec2(0.0f, 0.0f)[0]);
-        glUniform2fv(glGetUniformLocation(shader_program, "u_viewport_size"), 1, &glm::vec2((float)g_context.screen_size_x, (float)g_context.screen_size_y)[0]);
+        end_sprite_batch(sprite_batch);
+
+        if (recording) capture_frame(frame_recorder, g_context.framebuffer, frame_index);
+
+        presentFrame();
+        pace_frame(frame_pacer);
+        end_profile_frame();
+
+#ifdef ENGINE_COUNT_HEAP_ALLOCATIONS
+        uint64_t frame_heap_allocations = get_heap_allocation_count() - frame_heap_allocation_count;
+        if (steady_frame && frame_heap_allocations > 0) {
+            LOG_CRITICAL("[ARENA] Steady frame {} made {} heap allocations on the GL thread", frame_index, frame_heap_allocations);
+            std::abort();
+        }
+#endif
 
-        // Draw
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-    
-        SDL_GL_SwapWindow(g_context.window);
-        SDL_Delay(16);
+        frame_index++;
+        if (g_context.frame_limit != 0 && frame_index >= g_context.frame_limit) running = false;
+
+        if (frame_pacer.frame_times.size() == FRAME_PACER_HISTORY_SIZE) {
+            log_frame_pacer_stats(frame_pacer);
+            reset_frame_pacer_stats(frame_pacer);
+        }
     }
+    wait_for_counter(jobs, scene_step_counter);  // The step started for the frame that never came
     log_info("Exiting main loop");
-
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
-    glDeleteProgram(shader_program);
-    glDeleteTextures(1, &diffuse_texture);
-    glDeleteTextures(1, &normal_texture);
-    glDeleteTextures(1, &ao_texture);
-    glDeleteTextures(1, &roughness_texture);
+    log_frame_pacer_stats(frame_pacer);
+    if (recording) stop_frame_recorder(frame_recorder);
+
+    destroy_quad_instances(quad_instances);
+    stop_shader_watcher(shader_watcher);
+    for (ShaderPermutations* permutations : shader_permutation_sets) destroy_shader_permutations(*permutations);
+    close_program_cache(program_cache);
+    destroy_sprite_batch(sprite_batch);
+    destroy_gbuffer(gbuffer);
+    destroy_render_backend(render_backend);
+    destroy_render_queue(render_queue);
+    destroy_point_light_buffer(point_light_buffer);
+    destroy_light_tile_buffers(light_tile_buffers);
+    destroy_material_atlas(material_atlas);
     glDeleteTextures(1, &light_mask);
+    stop_texture_loader(texture_loader);
+    close_texture_pack(texture_pack);
+    for (SceneFrame& scene_frame : scene_frames) {
+        destroy_frame_arena(scene_frame.arena);
+        destroy_light_soa(scene_frame.lights);
+    }
+    destroy_light_soa(lights);
+    stop_job_system(jobs);
+    if (profiling) stop_profiler(g_context.profile_path);
+}
+
+inline void Engine::presentFrame()
+{
+    PROFILE_ZONE("Present");
+    if (g_context.headless) {
+        glFlush();  // Nothing to swap, the frame stays in the offscreen framebuffer
+        return;
+    }
+
+    SDL_GL_SwapWindow(g_context.window);
 }
 
 inline void Engine::terminateContext()
 {
     log_info("Terminating engine context");
-    SDL_GL_DeleteContext(g_context.gl_context);
-    SDL_DestroyWindow(g_context.window);
+    if (g_context.headless) {
+        destroy_headless_context(g_context.headless_context);
+    } else {
+        SDL_GL_DeleteContext(g_context.gl_context);
+        SDL_DestroyWindow(g_context.window);
+    }
     SDL_Quit();
 }
 
 int main(int argc, char* argv[])
 {
+    // Usage: main.exe [--bench uniforms|light-culling|light-density|cpu-lighting|light-soa|jobs|logging|sprites|instancing] [--render-path forward|deferred] [--job-threads N] [--sprites N] [--sprite-path batch|instanced]
+    //                 [--pacing vsync|adaptive|uncapped|limited] [--fps N] [--headless WxH] [--frames N]
+    //                 [--record DIR] [--record-format png|raw] [--record-fps N] [--profile FILE]
+    //                 [--shader-features none|light-mask,specular,normal-mapping] [--no-shader-reload]
+    std::string benchmark_name;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--bench" && i + 1 < argc) benchmark_name = argv[++i];
+        else if (arg == "--job-threads" && i + 1 < argc) Engine::g_context.job_thread_count = (uintmax_t)std::stoul(argv[++i]);
+        else if (arg == "--sprites" && i + 1 < argc) Engine::g_context.sprite_count = (uintmax_t)std::stoul(argv[++i]);
+        else if (arg == "--sprite-path" && i + 1 < argc) {
+            std::string sprite_path = argv[++i];
+            if (sprite_path == "batch") Engine::g_context.sprite_path = Engine::SPRITE_PATH_BATCH;
+            else if (sprite_path == "instanced") Engine::g_context.sprite_path = Engine::SPRITE_PATH_INSTANCED;
+            else log_warning("Unknown sprite path `" + sprite_path + "`");
+        }
+        else if (arg == "--headless" && i + 1 < argc) {
+            std::string size = argv[++i];
+            uintmax_t separator = size.find('x');
+            if (separator == std::string::npos) {
+                log_warning("Expected `--headless WxH`, got `" + size + "`");
+                continue;
+            }
+            Engine::g_context.headless = true;
+            Engine::g_context.screen_size_x = (uintmax_t)std::stoul(size.substr(0, separator));
+            Engine::g_context.screen_size_y = (uintmax_t)std::stoul(size.substr(separator + 1));
+        }
+        else if (arg == "--record" && i + 1 < argc) Engine::g_context.record_directory = argv[++i];
+        else if (arg == "--profile" && i + 1 < argc) Engine::g_context.profile_path = argv[++i];
+        else if (arg == "--record-fps" && i + 1 < argc) Engine::g_context.record_fps = std::stod(argv[++i]);
+        else if (arg == "--record-format" && i + 1 < argc) {
+            std::string record_format = argv[++i];
+            if (record_format == "png") Engine::g_context.record_format = Engine::FRAME_FORMAT_PNG;
+            else if (record_format == "raw") Engine::g_context.record_format = Engine::FRAME_FORMAT_RAW;
+            else log_warning("Unknown record format `" + record_format + "`");
+        }
+        else if (arg == "--frames" && i + 1 < argc) Engine::g_context.frame_limit = (uintmax_t)std::stoul(argv[++i]);
+        else if (arg == "--pacing" && i + 1 < argc) {
+            std::string pacing_mode = argv[++i];
+            if (pacing_mode == "vsync") Engine::g_context.pacing_mode = Engine::FRAME_PACING_VSYNC;
+            else if (pacing_mode == "adaptive") Engine::g_context.pacing_mode = Engine::FRAME_PACING_ADAPTIVE;
+            else if (pacing_mode == "uncapped") Engine::g_context.pacing_mode = Engine::FRAME_PACING_UNCAPPED;
+            else if (pacing_mode == "limited") Engine::g_context.pacing_mode = Engine::FRAME_PACING_LIMITED;
+            else log_warning("Unknown pacing mode `" + pacing_mode + "`");
+        }
+        else if (arg == "--fps" && i + 1 < argc) {
+            Engine::g_context.target_fps = std::stod(argv[++i]);
+            Engine::g_context.pacing_mode = Engine::FRAME_PACING_LIMITED;
+        }
+        else if (arg == "--render-path" && i + 1 < argc) {
+            std::string render_path = argv[++i];
+            if (render_path == "forward") Engine::g_context.render_path = Engine::RENDER_PATH_FORWARD;
+            else if (render_path == "deferred") Engine::g_context.render_path = Engine::RENDER_PATH_DEFERRED;
+            else log_warning("Unknown render path `" + render_path + "`");
+        }
+        else if (arg == "--no-shader-reload") Engine::g_context.shader_reload = false;
+        else if (arg == "--shader-features" && i + 1 < argc) {
+            // Comma separated, replaces the defaults
+            std::string features = argv[++i];
+            Engine::g_context.shader_features = 0;
+            for (uintmax_t begin = 0; begin <= features.size();) {
+                uintmax_t end = std::min(features.find(',', begin), features.size());
+                std::string feature = features.substr(begin, end - begin);
+                if (feature == "light-mask") Engine::g_context.shader_features |= Engine::SHADER_FEATURE_LIGHT_MASK;
+                else if (feature == "specular") Engine::g_context.shader_features |= Engine::SHADER_FEATURE_SPECULAR;
+                else if (feature == "normal-mapping") Engine::g_context.shader_features |= Engine::SHADER_FEATURE_NORMAL_MAPPING;
+                else if (feature != "none") log_warning("Unknown shader feature `" + feature + "`");
+                begin = end + 1;
+            }
+        }
+        else log_warning("Unknown argument `" + arg + "`");
+    }
+
+    // No display to sync to, or recording as fast as the writers keep up
+    bool recording = !Engine::g_context.record_directory.empty();
+    if ((Engine::g_context.headless || recording) && Engine::g_context.pacing_mode != Engine::FRAME_PACING_LIMITED) {
+        Engine::g_context.pacing_mode = Engine::FRAME_PACING_UNCAPPED;
+    }
+
+    // CPU only benchmarks, no window or OpenGL context
+    if (benchmark_name == "light-culling") {
+        Engine::run_light_culling_benchmark();
+        return 0;
+    }
+    if (benchmark_name == "cpu-lighting") {
+        Engine::run_cpu_lighting_benchmark();
+        return 0;
+    }
+    if (benchmark_name == "light-soa") {
+        Engine::run_light_soa_benchmark();
+        return 0;
+    }
+    if (benchmark_name == "jobs") {
+        Engine::run_job_system_benchmark();
+        return 0;
+    }
+    if (benchmark_name == "logging") {
+        Engine::run_logging_benchmark();
+        return 0;
+    }
+
     Engine::initContext();
-    Engine::mainLoop();
+    if (benchmark_name.empty()) {
+        Engine::mainLoop();
+    } else if (benchmark_name == "uniforms") {
+        Engine::run_uniform_benchmark(10000);
+    } else if (benchmark_name == "sprites") {
+        Engine::run_sprite_batch_benchmark(Engine::g_context.sprite_count ? Engine::g_context.sprite_count : 50000, 300);
+    } else if (benchmark_name == "instancing") {
+        Engine::run_instancing_benchmark(Engine::g_context.sprite_count ? Engine::g_context.sprite_count : 10000, 300);
+    } else if (benchmark_name == "light-density") {
+        Engine::run_light_density_benchmark(100, Engine::g_context.profile_path);
+    } else {
+        log_error("Unknown benchmark `" + benchmark_name + "`");
+    }
     Engine::terminateContext();
 }
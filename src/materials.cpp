@@ -0,0 +1,162 @@
+#include "materials.h"
+
+#include <algorithm>
+
+namespace Engine
+{
+    static GLuint create_texture_array(uintmax_t size_x, uintmax_t size_y, uintmax_t mip_count, uintmax_t layer_count)
+    {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint)mip_count - 1);
+
+        for (uintmax_t mip = 0; mip < mip_count; mip++) {
+            GLsizei width = (GLsizei)std::max(size_x >> mip, (uintmax_t)1);
+            GLsizei height = (GLsizei)std::max(size_y >> mip, (uintmax_t)1);
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)mip, GL_RGBA8, width, height, (GLsizei)layer_count, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        }
+
+        return texture;
+    }
+
+    void create_material_atlas(MaterialAtlas& atlas, uintmax_t size_x, uintmax_t size_y, uintmax_t layer_capacity)
+    {
+        atlas.size_x = size_x;
+        atlas.size_y = size_y;
+        atlas.layer_count = 0;
+        atlas.layer_capacity = layer_capacity;
+
+        atlas.mip_count = 1;
+        while ((std::max(size_x, size_y) >> atlas.mip_count) > 0) atlas.mip_count++;
+
+        atlas.albedo_array = create_texture_array(size_x, size_y, atlas.mip_count, layer_capacity);
+        atlas.surface_array = create_texture_array(size_x, size_y, atlas.mip_count, layer_capacity);
+    }
+
+    void destroy_material_atlas(MaterialAtlas& atlas)
+    {
+        glDeleteTextures(1, &atlas.albedo_array);
+        glDeleteTextures(1, &atlas.surface_array);
+        atlas = MaterialAtlas();
+    }
+
+    void pack_surface_texels(const unsigned char* normal, const unsigned char* ao, const unsigned char* roughness, uintmax_t texel_count, unsigned char* surface)
+    {
+        for (uintmax_t i = 0; i < texel_count; i++) {
+            surface[i * 4 + 0] = normal[i * 3 + 0];
+            surface[i * 4 + 1] = normal[i * 3 + 1];
+            surface[i * 4 + 2] = ao[i];
+            surface[i * 4 + 3] = roughness[i];
+        }
+    }
+
+    static void upload_layer(GLuint texture_array, uintmax_t layer, GLint mip, GLsizei width, GLsizei height, GLenum format, const void* texels)
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, mip, 0, 0, (GLint)layer, width, height, 1, format, GL_UNSIGNED_BYTE, texels);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+
+    // Uploads the baked diffuse and surface mip chains of a cooked material
+    static bool upload_packed_material(MaterialAtlas& atlas, const TexturePack& pack, const std::string& name, uintmax_t layer)
+    {
+        static const GLenum formats[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+
+        const TexturePackEntry* diffuse = find_texture_pack_entry(pack, name + MATERIAL_DIFFUSE_NAME);
+        const TexturePackEntry* surface = find_texture_pack_entry(pack, name + MATERIAL_SURFACE_NAME);
+        if (!diffuse || !surface || surface->channel_count != 4) return false;
+
+        for (const TexturePackEntry* entry : { diffuse, surface }) {
+            if (entry->width != atlas.size_x || entry->height != atlas.size_y) {
+                log_error("[MATERIAL] `" + (std::string)entry->name + "` does not match the atlas size of " + std::to_string(atlas.size_x) + "x" + std::to_string(atlas.size_y));
+                return false;
+            }
+
+            GLuint texture_array = (entry == diffuse) ? atlas.albedo_array : atlas.surface_array;
+            uint32_t mip_count = std::min(entry->mip_count, (uint32_t)atlas.mip_count);
+            for (uint32_t mip = 0; mip < mip_count; mip++) {
+                GLsizei width = (GLsizei)std::max(entry->width >> mip, 1u);
+                GLsizei height = (GLsizei)std::max(entry->height >> mip, 1u);
+                upload_layer(texture_array, layer, (GLint)mip, width, height, formats[entry->channel_count - 1], pack.data + entry->mip_offsets[mip]);
+            }
+        }
+
+        return true;
+    }
+
+    intmax_t request_material(MaterialAtlas& atlas, TextureLoader& loader, const std::string& directory)
+    {
+        if (atlas.layer_count >= atlas.layer_capacity) {
+            log_error("[MATERIAL] Atlas is full (" + std::to_string(atlas.layer_capacity) + " layers), cannot add `" + directory + "`");
+            return -1;
+        }
+        uintmax_t layer = atlas.layer_count++;
+
+        if (loader.pack && directory.compare(0, loader.pack_root.size(), loader.pack_root) == 0) {
+            if (upload_packed_material(atlas, *loader.pack, directory.substr(loader.pack_root.size()), layer)) return (intmax_t)layer;
+        }
+
+        PendingMaterial material;
+        material.layer = layer;
+        material.diffuse = request_image(loader, (directory + MATERIAL_DIFFUSE_NAME).c_str(), 4);
+        material.normal = request_image(loader, (directory + MATERIAL_NORMAL_NAME).c_str(), 3);
+        material.ao = request_image(loader, (directory + MATERIAL_AO_NAME).c_str(), 1);
+        material.roughness = request_image(loader, (directory + MATERIAL_ROUGHNESS_NAME).c_str(), 1);
+        atlas.pending_materials.push_back(material);
+
+        return (intmax_t)layer;
+    }
+
+    void update_material_atlas(MaterialAtlas& atlas, TextureLoader& loader)
+    {
+        PROFILE_ZONE("Material streaming");
+        bool uploaded = false;
+        std::vector<unsigned char> surface_texels;
+
+        for (uintmax_t i = 0; i < atlas.pending_materials.size();) {
+            const PendingMaterial& material = atlas.pending_materials[i];
+            const TextureHandle handles[4] = { material.diffuse, material.normal, material.ao, material.roughness };
+
+            bool ready = true;
+            bool valid = true;
+            for (TextureHandle handle : handles) {
+                ready = ready && (is_texture_ready(loader, handle) || loader.requests[handle].failed);
+                valid = valid && !loader.requests[handle].failed;
+                valid = valid && (!is_texture_ready(loader, handle) || (get_texture_info(loader, handle).width == atlas.size_x && get_texture_info(loader, handle).height == atlas.size_y));
+            }
+            if (!ready) {
+                i++;
+                continue;
+            }
+
+            if (valid) {
+                uintmax_t texel_count = atlas.size_x * atlas.size_y;
+                surface_texels.resize(texel_count * 4);
+                pack_surface_texels(get_image_data(loader, material.normal), get_image_data(loader, material.ao), get_image_data(loader, material.roughness), texel_count, surface_texels.data());
+
+                upload_layer(atlas.albedo_array, material.layer, 0, (GLsizei)atlas.size_x, (GLsizei)atlas.size_y, GL_RGBA, get_image_data(loader, material.diffuse));
+                upload_layer(atlas.surface_array, material.layer, 0, (GLsizei)atlas.size_x, (GLsizei)atlas.size_y, GL_RGBA, surface_texels.data());
+                uploaded = true;
+            } else {
+                LOG_ERROR("[MATERIAL] Material layer {} failed to load or does not match the atlas size of {}x{}", material.layer, atlas.size_x, atlas.size_y);
+            }
+
+            for (TextureHandle handle : handles) release_image(loader, handle);
+            atlas.pending_materials.erase(atlas.pending_materials.begin() + (intmax_t)i);
+        }
+
+        if (uploaded) {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, atlas.albedo_array);
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, atlas.surface_array);
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        }
+    }
+}
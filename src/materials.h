@@ -0,0 +1,48 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "logging.h"
+#include "texture_loader.h"
+
+namespace Engine
+{
+    // A material waiting for its source images
+    struct PendingMaterial {
+        uintmax_t layer;
+        TextureHandle diffuse, normal, ao, roughness;
+    };
+
+    // All materials share one resolution and live in two GL_TEXTURE_2D_ARRAYs, the layer is the material index.
+    // Albedo, RGBA8: diffuse.rgba
+    // Surface, RGBA8: normal.x, normal.y, ao, roughness (ORM style channel packing)
+    struct MaterialAtlas {
+        uintmax_t size_x = 0;
+        uintmax_t size_y = 0;
+        uintmax_t mip_count = 0;
+        uintmax_t layer_count = 0;
+        uintmax_t layer_capacity = 0;
+        GLuint albedo_array = 0;
+        GLuint surface_array = 0;
+
+        std::vector<PendingMaterial> pending_materials;
+    };
+
+    void create_material_atlas(MaterialAtlas& atlas, uintmax_t size_x, uintmax_t size_y, uintmax_t layer_capacity);
+    void destroy_material_atlas(MaterialAtlas& atlas);
+
+    // Interleaves the normal.xy, ao and roughness sources into the surface layout, `normal` has 3 channels
+    void pack_surface_texels(const unsigned char* normal, const unsigned char* ao, const unsigned char* roughness, uintmax_t texel_count, unsigned char* surface);
+
+    // Returns the layer of the material in `directory` (with trailing `/`), or -1 when the atlas is full.
+    // Cooked materials upload right away, others once `update_material_atlas` sees all images decoded
+    intmax_t request_material(MaterialAtlas& atlas, TextureLoader& loader, const std::string& directory);
+
+    // GL thread, after `update_texture_loader`
+    void update_material_atlas(MaterialAtlas& atlas, TextureLoader& loader);
+}
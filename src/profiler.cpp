@@ -0,0 +1,377 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+namespace Engine
+{
+    std::atomic<bool> g_profiler_active{ false };
+    uint64_t g_profile_counters[PROFILE_COUNTER_COUNT] = {};
+
+    static const char* s_counter_names[PROFILE_COUNTER_COUNT] = {
+        "Draw calls",
+        "Uniform uploads",
+        "Texture binds",
+        "Program switches",
+        "Lights evaluated",
+        "Lights culled",
+        "Lit sprites",
+        "Unlit sprites",
+    };
+
+    struct ProfileEvent {
+        const char* name = nullptr;
+        uint64_t begin_ns = 0;
+        uint64_t end_ns = 0;
+    };
+
+    struct ProfileThread {
+        uintmax_t index = 0;  // Track in the trace
+        intmax_t worker_index = -1;  // In the job system, -1 for threads it does not own
+        std::vector<ProfileEvent> events;  // Reserved up front, never reallocates
+        uintmax_t dropped_count = 0;
+    };
+
+    struct ProfileFrame {
+        uint64_t begin_ns = 0;
+        uint64_t end_ns = 0;
+        uint64_t counters[PROFILE_COUNTER_COUNT] = {};
+    };
+
+    // A begin and an end timestamp query per zone
+    struct ProfileGpuFrame {
+        GLuint queries[PROFILER_MAX_GPU_ZONES * 2] = {};
+        const char* names[PROFILER_MAX_GPU_ZONES] = {};
+        bool closed[PROFILER_MAX_GPU_ZONES] = {};
+        uintmax_t zone_count = 0;
+        GLuint last_query = 0;  // Results arrive in order, so this one being available means they all are
+        bool pending = false;
+    };
+
+    struct Profiler {
+        uint64_t start_ns = 0;
+
+        std::mutex threads_mutex;
+        std::deque<ProfileThread> threads;
+
+        // Main thread only
+        std::vector<ProfileFrame> frames;
+        uint64_t frame_begin_ns = 0;
+        uintmax_t frame_index = 0;
+        uintmax_t dropped_frame_count = 0;
+
+        // GL thread only, which is the main thread
+        bool gpu_enabled = false;
+        int64_t gpu_offset_ns = 0;  // CPU clock minus GPU clock
+        ProfileGpuFrame gpu_frames[PROFILER_GPU_LATENCY];
+        ProfileGpuFrame* gpu_frame = nullptr;  // Between `begin_profile_frame` and `end_profile_frame`
+        std::vector<ProfileEvent> gpu_events;
+        uintmax_t dropped_gpu_event_count = 0;
+        uintmax_t gpu_stall_count = 0;
+    };
+
+    static Profiler s_profiler;
+    static thread_local ProfileThread* t_profile_thread = nullptr;
+    static thread_local intmax_t t_profile_worker_index = -1;
+
+    void set_profile_worker_index(intmax_t worker_index)
+    {
+        t_profile_worker_index = worker_index;
+        t_profile_thread = nullptr;
+    }
+
+    // Caller holds `threads_mutex`
+    static ProfileThread* find_worker_profile_thread(intmax_t worker_index)
+    {
+        for (ProfileThread& thread : s_profiler.threads) {
+            if (thread.worker_index == worker_index) return &thread;
+        }
+        return nullptr;
+    }
+
+    static ProfileThread& add_profile_thread(intmax_t worker_index)
+    {
+        ProfileThread& thread = s_profiler.threads.emplace_back();
+        thread.index = s_profiler.threads.size() - 1;
+        thread.worker_index = worker_index;
+        thread.events.reserve(PROFILER_MAX_EVENTS_PER_THREAD);
+        return thread;
+    }
+
+    // Job workers were registered by `start_profiler`, only other threads allocate their track on their first zone
+    static ProfileThread& get_profile_thread()
+    {
+        if (t_profile_thread) return *t_profile_thread;
+
+        std::lock_guard<std::mutex> lock(s_profiler.threads_mutex);
+        ProfileThread* thread = (t_profile_worker_index >= 0) ? find_worker_profile_thread(t_profile_worker_index) : nullptr;
+        if (!thread) thread = &add_profile_thread(t_profile_worker_index);
+        t_profile_thread = thread;
+        return *thread;
+    }
+
+    void add_profile_event(const char* name, uint64_t begin_ns, uint64_t end_ns)
+    {
+        ProfileThread& thread = get_profile_thread();
+        if (thread.events.size() == PROFILER_MAX_EVENTS_PER_THREAD) {
+            thread.dropped_count++;
+            return;
+        }
+        thread.events.push_back({ name, begin_ns, end_ns });
+    }
+
+    static void resolve_gpu_frame(ProfileGpuFrame& frame)
+    {
+        frame.pending = false;
+        if (frame.zone_count == 0) return;
+
+        // Only happens when the GPU is more than PROFILER_GPU_LATENCY frames behind, the reads below then block
+        GLuint available = 0;
+        glGetQueryObjectuiv(frame.last_query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) s_profiler.gpu_stall_count++;
+
+        for (uintmax_t i = 0; i < frame.zone_count; i++) {
+            if (!frame.closed[i]) continue;
+
+            GLuint64 begin_ns = 0;
+            GLuint64 end_ns = 0;
+            glGetQueryObjectui64v(frame.queries[i * 2], GL_QUERY_RESULT, &begin_ns);
+            glGetQueryObjectui64v(frame.queries[i * 2 + 1], GL_QUERY_RESULT, &end_ns);
+
+            if (s_profiler.gpu_events.size() == PROFILER_MAX_EVENTS_PER_THREAD) {
+                s_profiler.dropped_gpu_event_count++;
+                continue;
+            }
+            s_profiler.gpu_events.push_back({ frame.names[i], begin_ns + s_profiler.gpu_offset_ns, end_ns + s_profiler.gpu_offset_ns });
+        }
+        frame.zone_count = 0;
+    }
+
+    void start_profiler(uintmax_t job_thread_count)
+    {
+#ifndef ENGINE_PROFILER
+        log_warning("[PROFILE] Built with ENGINE_DISABLE_PROFILER, the capture only has frames");
+#endif
+        s_profiler.start_ns = get_profile_time_ns();
+        s_profiler.frames.reserve(PROFILER_MAX_FRAMES);
+        s_profiler.gpu_events.reserve(PROFILER_MAX_EVENTS_PER_THREAD);
+        {
+            std::lock_guard<std::mutex> lock(s_profiler.threads_mutex);
+            for (uintmax_t i = 0; i < job_thread_count; i++) {
+                if (!find_worker_profile_thread((intmax_t)i)) add_profile_thread((intmax_t)i);
+            }
+        }
+        get_profile_thread();
+
+        GLint counter_bits = 0;
+        glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counter_bits);
+        s_profiler.gpu_enabled = counter_bits > 0;
+        if (s_profiler.gpu_enabled) {
+            for (ProfileGpuFrame& frame : s_profiler.gpu_frames) glGenQueries(PROFILER_MAX_GPU_ZONES * 2, frame.queries);
+
+            // The GPU clock has its own origin, zones are moved onto the CPU timeline with the offset at start
+            GLint64 gpu_ns = 0;
+            glGetInteger64v(GL_TIMESTAMP, &gpu_ns);
+            s_profiler.gpu_offset_ns = (int64_t)get_profile_time_ns() - (int64_t)gpu_ns;
+        } else {
+            log_warning("[PROFILE] Timestamp queries are not supported, GPU zones are off");
+        }
+
+        g_profiler_active.store(true, std::memory_order_relaxed);
+        log_info("[PROFILE] Capturing" + std::string(s_profiler.gpu_enabled ? " CPU and GPU zones" : " CPU zones"));
+    }
+
+    void begin_profile_frame()
+    {
+        if (!g_profiler_active.load(std::memory_order_relaxed)) return;
+
+        s_profiler.frame_begin_ns = get_profile_time_ns();
+        std::fill(g_profile_counters, g_profile_counters + PROFILE_COUNTER_COUNT, 0);
+
+        if (s_profiler.gpu_enabled) {
+            ProfileGpuFrame& gpu_frame = s_profiler.gpu_frames[s_profiler.frame_index % PROFILER_GPU_LATENCY];
+            if (gpu_frame.pending) resolve_gpu_frame(gpu_frame);
+            s_profiler.gpu_frame = &gpu_frame;
+        }
+    }
+
+    void end_profile_frame()
+    {
+        if (!g_profiler_active.load(std::memory_order_relaxed)) return;
+
+        ProfileFrame frame;
+        frame.begin_ns = s_profiler.frame_begin_ns;
+        frame.end_ns = get_profile_time_ns();
+        std::copy(g_profile_counters, g_profile_counters + PROFILE_COUNTER_COUNT, frame.counters);
+        add_profile_event("Frame", frame.begin_ns, frame.end_ns);
+
+        if (s_profiler.frames.size() < PROFILER_MAX_FRAMES) s_profiler.frames.push_back(frame);
+        else s_profiler.dropped_frame_count++;
+
+        if (s_profiler.gpu_frame) {
+            s_profiler.gpu_frame->pending = true;
+            s_profiler.gpu_frame = nullptr;
+        }
+        s_profiler.frame_index++;
+    }
+
+    double get_profile_gpu_zone_ms(const char* name, uintmax_t& zone_count)
+    {
+        double total_ms = 0.0;
+        zone_count = 0;
+        for (const ProfileEvent& event : s_profiler.gpu_events) {
+            if (std::strcmp(event.name, name) != 0) continue;
+            total_ms += (double)(event.end_ns - event.begin_ns) / 1000000.0;
+            zone_count++;
+        }
+        return total_ms;
+    }
+
+    intmax_t begin_profile_gpu_zone(const char* name)
+    {
+        ProfileGpuFrame* frame = s_profiler.gpu_frame;
+        if (!frame || frame->zone_count == PROFILER_MAX_GPU_ZONES) return -1;
+
+        uintmax_t zone = frame->zone_count++;
+        frame->names[zone] = name;
+        frame->closed[zone] = false;
+        frame->last_query = frame->queries[zone * 2];
+        glQueryCounter(frame->last_query, GL_TIMESTAMP);
+        return (intmax_t)zone;
+    }
+
+    void end_profile_gpu_zone(intmax_t zone)
+    {
+        ProfileGpuFrame* frame = s_profiler.gpu_frame;
+        if (zone < 0 || !frame) return;
+
+        frame->closed[zone] = true;
+        frame->last_query = frame->queries[zone * 2 + 1];
+        glQueryCounter(frame->last_query, GL_TIMESTAMP);
+    }
+
+    struct ProfileZoneTotal {
+        std::string name;
+        double total_ms = 0.0;
+    };
+
+    static void add_zone_total(std::vector<ProfileZoneTotal>& totals, const char* name, uint64_t duration_ns)
+    {
+        auto total = std::find_if(totals.begin(), totals.end(), [name](const ProfileZoneTotal& total) { return total.name == name; });
+        if (total == totals.end()) {
+            totals.push_back({ name, 0.0 });
+            total = totals.end() - 1;
+        }
+        total->total_ms += (double)duration_ns / 1000000.0;
+    }
+
+    static void write_trace_string(std::ofstream& file, const char* text)
+    {
+        file << '"';
+        for (const char* c = text; *c; c++) {
+            if (*c == '"' || *c == '\\') file << '\\';
+            file << *c;
+        }
+        file << '"';
+    }
+
+    static void write_trace_event(std::ofstream& file, const ProfileEvent& event, uintmax_t track)
+    {
+        file << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << track << ",\"name\":";
+        write_trace_string(file, event.name);
+        file << ",\"ts\":" << (double)((int64_t)event.begin_ns - (int64_t)s_profiler.start_ns) / 1000.0;
+        file << ",\"dur\":" << (double)(event.end_ns - event.begin_ns) / 1000.0 << "}";
+    }
+
+    static bool write_trace(const std::string& trace_path, uintmax_t& event_count)
+    {
+        std::ofstream file(trace_path);
+        if (!file) return false;
+
+        uintmax_t gpu_track = s_profiler.threads.size();
+        file << std::fixed << std::setprecision(3);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        file << "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"Engine\"}}";
+        for (const ProfileThread& thread : s_profiler.threads) {
+            std::string thread_name = (thread.worker_index == 0) ? "Main thread"
+                : (thread.worker_index > 0) ? "Worker " + std::to_string(thread.worker_index)
+                : "Thread " + std::to_string(thread.index);
+            file << ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.index << ",\"name\":\"thread_name\",\"args\":{\"name\":\"" << thread_name << "\"}}";
+        }
+        if (s_profiler.gpu_enabled) file << ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << gpu_track << ",\"name\":\"thread_name\",\"args\":{\"name\":\"GPU\"}}";
+
+        event_count = 0;
+        for (const ProfileThread& thread : s_profiler.threads) {
+            for (const ProfileEvent& event : thread.events) write_trace_event(file, event, thread.index);
+            event_count += thread.events.size();
+        }
+        for (const ProfileEvent& event : s_profiler.gpu_events) write_trace_event(file, event, gpu_track);
+        event_count += s_profiler.gpu_events.size();
+
+        for (const ProfileFrame& frame : s_profiler.frames) {
+            for (uintmax_t counter = 0; counter < PROFILE_COUNTER_COUNT; counter++) {
+                file << ",\n{\"ph\":\"C\",\"pid\":1,\"name\":\"" << s_counter_names[counter] << "\",\"ts\":" << (double)(frame.begin_ns - s_profiler.start_ns) / 1000.0;
+                file << ",\"args\":{\"value\":" << frame.counters[counter] << "}}";
+            }
+        }
+        file << "\n]}\n";
+        return (bool)file;
+    }
+
+    void stop_profiler(const std::string& trace_path)
+    {
+        if (!g_profiler_active.load(std::memory_order_relaxed)) return;
+        g_profiler_active.store(false, std::memory_order_relaxed);
+
+        if (s_profiler.gpu_enabled) {
+            // Oldest first
+            for (uintmax_t i = 0; i < PROFILER_GPU_LATENCY; i++) {
+                ProfileGpuFrame& gpu_frame = s_profiler.gpu_frames[(s_profiler.frame_index + i) % PROFILER_GPU_LATENCY];
+                if (gpu_frame.pending) resolve_gpu_frame(gpu_frame);
+            }
+            for (ProfileGpuFrame& frame : s_profiler.gpu_frames) glDeleteQueries(PROFILER_MAX_GPU_ZONES * 2, frame.queries);
+        }
+
+        uintmax_t frame_count = s_profiler.frames.size();
+        if (frame_count == 0) {
+            log_warning("[PROFILE] No frames captured");
+            return;
+        }
+
+        // Per frame averages, CPU zones are summed over every thread
+        std::vector<ProfileZoneTotal> cpu_totals;
+        std::vector<ProfileZoneTotal> gpu_totals;
+        uintmax_t dropped_count = s_profiler.dropped_gpu_event_count;
+        for (const ProfileThread& thread : s_profiler.threads) {
+            for (const ProfileEvent& event : thread.events) add_zone_total(cpu_totals, event.name, event.end_ns - event.begin_ns);
+            dropped_count += thread.dropped_count;
+        }
+        for (const ProfileEvent& event : s_profiler.gpu_events) add_zone_total(gpu_totals, event.name, event.end_ns - event.begin_ns);
+
+        log_info("[PROFILE] " + std::to_string(frame_count) + " frames, per frame averages:");
+        for (const ProfileZoneTotal& total : cpu_totals) log_info("[PROFILE] CPU " + total.name + ": " + std::to_string(total.total_ms / (double)frame_count) + " ms");
+        for (const ProfileZoneTotal& total : gpu_totals) log_info("[PROFILE] GPU " + total.name + ": " + std::to_string(total.total_ms / (double)frame_count) + " ms");
+        for (uintmax_t counter = 0; counter < PROFILE_COUNTER_COUNT; counter++) {
+            uint64_t sum = 0;
+            for (const ProfileFrame& frame : s_profiler.frames) sum += frame.counters[counter];
+            log_info("[PROFILE] " + (std::string)s_counter_names[counter] + ": " + std::to_string((double)sum / (double)frame_count));
+        }
+
+        if (dropped_count > 0 || s_profiler.dropped_frame_count > 0) {
+            log_warning("[PROFILE] Capture full, " + std::to_string(dropped_count) + " zones and " + std::to_string(s_profiler.dropped_frame_count) + " frames dropped");
+        }
+        if (s_profiler.gpu_stall_count > 0) {
+            log_warning("[PROFILE] Waited on GPU zones " + std::to_string(s_profiler.gpu_stall_count) + " times, the GPU ran more than " + std::to_string(PROFILER_GPU_LATENCY) + " frames behind");
+        }
+
+        if (trace_path.empty()) return;
+        uintmax_t event_count = 0;
+        if (write_trace(trace_path, event_count)) log_info("[PROFILE] Wrote " + std::to_string(event_count) + " zones to `" + trace_path + "`");
+        else log_error("[PROFILE] Failed to write `" + trace_path + "`");
+    }
+}
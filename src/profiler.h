@@ -0,0 +1,109 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include <glad/glad.h>
+
+#include "logging.h"
+
+// Zones and counters, compiled out entirely with ENGINE_DISABLE_PROFILER. Compiled in they cost one relaxed
+// load until `start_profiler` is called
+#ifndef ENGINE_DISABLE_PROFILER
+#define ENGINE_PROFILER
+#endif
+
+// Zones one thread can record over a whole capture, later ones are dropped
+#define PROFILER_MAX_EVENTS_PER_THREAD 65536
+#define PROFILER_MAX_FRAMES 16384
+// GPU zones per frame, and how many frames their timestamp queries are read back after being issued
+#define PROFILER_MAX_GPU_ZONES 32
+#define PROFILER_GPU_LATENCY 4
+
+namespace Engine
+{
+    enum ProfileCounter {
+        PROFILE_COUNTER_DRAW_CALLS,
+        PROFILE_COUNTER_UNIFORM_UPLOADS,
+        PROFILE_COUNTER_TEXTURE_BINDS,
+        PROFILE_COUNTER_PROGRAM_SWITCHES,
+        PROFILE_COUNTER_LIGHTS_EVALUATED,  // Uploaded and binned into the tiles
+        PROFILE_COUNTER_LIGHTS_CULLED,     // Out of the viewport by their radius
+        PROFILE_COUNTER_LIT_SPRITES,       // Forward sprites some light reaches
+        PROFILE_COUNTER_UNLIT_SPRITES,     // Forward sprites drawn unlit because no light reaches them
+        PROFILE_COUNTER_COUNT,
+    };
+
+    extern std::atomic<bool> g_profiler_active;
+    extern uint64_t g_profile_counters[PROFILE_COUNTER_COUNT];  // Current frame, GL thread only
+
+    // Starts capturing, with a track for each of the `job_thread_count` job workers made up front so their zones never
+    // allocate. Expects a current OpenGL context for GPU zones
+    void start_profiler(uintmax_t job_thread_count);
+    // Writes the capture as Chrome trace JSON (also loads in Perfetto), unless `trace_path` is empty, and logs per frame
+    // averages. Every thread that recorded zones has to be done with them
+    void stop_profiler(const std::string& trace_path);
+
+    // Bracket one frame on the main thread, the begin also reads back the GPU zones of an older frame
+    void begin_profile_frame();
+    void end_profile_frame();
+
+    // Summed duration of the GPU zones called `name` read back so far, and how many there were. For benchmarks timing
+    // their own zones, a zone is read back `PROFILER_GPU_LATENCY` frames after the one it was issued in
+    double get_profile_gpu_zone_ms(const char* name, uintmax_t& zone_count);
+
+    inline uint64_t get_profile_time_ns()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Set by the job system on each of its threads, their zones then go to that worker's track
+    void set_profile_worker_index(intmax_t worker_index);
+
+    void add_profile_event(const char* name, uint64_t begin_ns, uint64_t end_ns);
+
+    struct ProfileZone {
+        const char* name;
+        uint64_t begin_ns = 0;
+        bool active;
+
+        ProfileZone(const char* name) : name(name), active(g_profiler_active.load(std::memory_order_relaxed))
+        {
+            if (active) begin_ns = get_profile_time_ns();
+        }
+        ~ProfileZone()
+        {
+            if (active) add_profile_event(name, begin_ns, get_profile_time_ns());
+        }
+    };
+
+    // Returns the zone index, or -1 if GPU zones are off or this frame is out of them
+    intmax_t begin_profile_gpu_zone(const char* name);
+    void end_profile_gpu_zone(intmax_t zone);
+
+    // GL thread only
+    struct ProfileGpuZone {
+        intmax_t zone;
+
+        ProfileGpuZone(const char* name) : zone(begin_profile_gpu_zone(name)) {}
+        ~ProfileGpuZone() { end_profile_gpu_zone(zone); }
+    };
+}
+
+#ifdef ENGINE_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+// Times the rest of the enclosing scope, `name` has to outlive the capture (a string literal)
+#define PROFILE_ZONE(name) Engine::ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+// Times the GL commands issued in the rest of the enclosing scope
+#define PROFILE_GPU_ZONE(name) Engine::ProfileGpuZone PROFILE_CONCAT(profile_gpu_zone_, __LINE__)(name)
+#define PROFILE_COUNT(counter, amount) (Engine::g_profile_counters[counter] += (amount))
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_GPU_ZONE(name) ((void)0)
+#define PROFILE_COUNT(counter, amount) ((void)0)
+#endif
@@ -0,0 +1,122 @@
+#include "quad_instances.h"
+
+#include <algorithm>
+#include <string>
+
+namespace Engine
+{
+    void create_quad_instances(QuadInstances& quads, uintmax_t max_instance_count)
+    {
+        // Same winding as the sprite batch
+        const float vertices[] = {
+            1.0f, 0.0f,  1.0f, 0.0f,  // top right
+            1.0f, 1.0f,  1.0f, 1.0f,  // bottom right
+            0.0f, 1.0f,  0.0f, 1.0f,  // bottom left
+            0.0f, 0.0f,  0.0f, 0.0f,  // top left
+        };
+        const GLuint indices[] = {
+            0, 1, 3,
+            1, 2, 3
+        };
+
+        quads.max_instance_count = max_instance_count;
+        quads.instances.reserve(max_instance_count);
+
+        glGenVertexArrays(1, &quads.VAO);
+        glGenBuffers(1, &quads.quad_VBO);
+        glGenBuffers(1, &quads.EBO);
+        glGenBuffers(1, &quads.instance_VBO);
+
+        glBindVertexArray(quads.VAO);
+
+        // Per vertex
+        glBindBuffer(GL_ARRAY_BUFFER, quads.quad_VBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quads.EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+
+        // Per instance
+        glBindBuffer(GL_ARRAY_BUFFER, quads.instance_VBO);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(max_instance_count * sizeof(QuadInstance)), NULL, GL_STREAM_DRAW);
+
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(QuadInstance), (void*)offsetof(QuadInstance, position));
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(QuadInstance), (void*)offsetof(QuadInstance, scale));
+        glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, sizeof(QuadInstance), (void*)offsetof(QuadInstance, rotation));
+        glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, sizeof(QuadInstance), (void*)offsetof(QuadInstance, material_layer));
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(QuadInstance), (void*)offsetof(QuadInstance, uv_rect));
+        glVertexAttribPointer(7, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(QuadInstance), (void*)offsetof(QuadInstance, tint));
+        for (GLuint attribute = 2; attribute <= 7; attribute++) {
+            glEnableVertexAttribArray(attribute);
+            glVertexAttribDivisor(attribute, 1);
+        }
+
+        glBindVertexArray(0);
+    }
+
+    void destroy_quad_instances(QuadInstances& quads)
+    {
+        glDeleteVertexArrays(1, &quads.VAO);
+        glDeleteBuffers(1, &quads.quad_VBO);
+        glDeleteBuffers(1, &quads.EBO);
+        glDeleteBuffers(1, &quads.instance_VBO);
+        quads = QuadInstances();
+    }
+
+    void clear_quad_instances(QuadInstances& quads)
+    {
+        quads.instances.clear();
+    }
+
+    static inline uint8_t pack_unorm8(float value)
+    {
+        return (uint8_t)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+
+    void add_quad_instance(QuadInstances& quads, const Sprite& sprite, const glm::vec4& tint)
+    {
+        if (quads.instances.size() >= quads.max_instance_count) return;
+
+        QuadInstance instance;
+        instance.position[0] = sprite.position.x;
+        instance.position[1] = sprite.position.y;
+        instance.scale[0] = sprite.size.x;
+        instance.scale[1] = sprite.size.y;
+        instance.rotation = sprite.rotation;
+        instance.material_layer = sprite.material_layer;
+        instance.uv_rect[0] = sprite.uv_rect.x;
+        instance.uv_rect[1] = sprite.uv_rect.y;
+        instance.uv_rect[2] = sprite.uv_rect.z;
+        instance.uv_rect[3] = sprite.uv_rect.w;
+        instance.tint[0] = pack_unorm8(tint.r);
+        instance.tint[1] = pack_unorm8(tint.g);
+        instance.tint[2] = pack_unorm8(tint.b);
+        instance.tint[3] = pack_unorm8(tint.a);
+
+        quads.instances.push_back(instance);
+    }
+
+    void upload_quad_instances(QuadInstances& quads)
+    {
+        PROFILE_ZONE("Quad instance upload");
+        if (quads.instances.empty()) return;
+
+        // Orphan the previous storage so the driver does not wait on draws still reading it
+        glBindBuffer(GL_ARRAY_BUFFER, quads.instance_VBO);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(quads.max_instance_count * sizeof(QuadInstance)), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)(quads.instances.size() * sizeof(QuadInstance)), quads.instances.data());
+    }
+
+    void draw_quad_instances(const QuadInstances& quads)
+    {
+        if (quads.instances.empty()) return;
+
+        glBindVertexArray(quads.VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, (GLsizei)quads.instances.size());
+        PROFILE_COUNT(PROFILE_COUNTER_DRAW_CALLS, 1);
+    }
+}
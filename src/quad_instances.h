@@ -0,0 +1,47 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "logging.h"
+#include "profiler.h"
+#include "sprite_batch.h"
+
+namespace Engine
+{
+    // Per-instance record, mirrored by the instance attributes in `generic.vs`
+    struct QuadInstance {
+        float position[2];   // Top left corner
+        float scale[2];
+        float rotation;      // Radians, around the quad center
+        float material_layer;
+        float uv_rect[4];
+        uint8_t tint[4];     // RGBA8, normalized in the shader
+    };
+    static_assert(sizeof(QuadInstance) == 44, "QuadInstance must stay tightly packed");
+
+    // One static unit quad drawn once per instance, only `QuadInstance` records are streamed
+    struct QuadInstances {
+        uintmax_t max_instance_count = 0;
+        GLuint VAO = 0;
+        GLuint quad_VBO = 0;
+        GLuint EBO = 0;
+        GLuint instance_VBO = 0;
+
+        std::vector<QuadInstance> instances;
+    };
+
+    void create_quad_instances(QuadInstances& quads, uintmax_t max_instance_count);
+    void destroy_quad_instances(QuadInstances& quads);
+
+    void clear_quad_instances(QuadInstances& quads);
+    void add_quad_instance(QuadInstances& quads, const Sprite& sprite, const glm::vec4& tint = glm::vec4(1.0f));
+
+    // Once per frame after adding, then draw with any program built on `generic.vs`
+    void upload_quad_instances(QuadInstances& quads);
+    void draw_quad_instances(const QuadInstances& quads);
+}
@@ -0,0 +1,312 @@
+#include "render_queue.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace Engine
+{
+    static uint64_t make_sort_key(uint8_t layer, GLuint program, uint16_t material, uint32_t depth)
+    {
+        return ((uint64_t)layer << 56) | ((uint64_t)(program & 0xFFFF) << 40) | ((uint64_t)material << 24) | (uint64_t)(depth & 0xFFFFFF);
+    }
+
+    void create_render_queue(RenderQueue& queue, JobSystem& jobs)
+    {
+        queue.jobs = &jobs;
+        queue.thread_buffers.resize(get_job_thread_count(jobs));
+    }
+
+    void destroy_render_queue(RenderQueue& queue)
+    {
+        queue = RenderQueue();
+    }
+
+    void begin_render_queue(RenderQueue& queue, FrameArena& arena)
+    {
+        begin_frame_vector(queue.states, arena);
+        begin_frame_vector(queue.materials, arena);
+        begin_frame_vector(queue.uniforms, arena);
+        for (RenderCommandBuffer& buffer : queue.thread_buffers) begin_frame_vector(buffer.commands, arena);
+        begin_frame_vector(queue.sorted, arena);
+        begin_frame_vector(queue.sort_scratch, arena);
+    }
+
+    uint16_t add_render_state(RenderQueue& queue, const RenderState& state)
+    {
+        queue.states.push_back(state);
+        return (uint16_t)(queue.states.size() - 1);
+    }
+
+    uint16_t add_render_material(RenderQueue& queue, const RenderMaterial& material)
+    {
+        queue.materials.push_back(material);
+        return (uint16_t)(queue.materials.size() - 1);
+    }
+
+    static void add_uniform(RenderQueue& queue, RenderUniformBlock& block, uint32_t slot, RenderUniformType type, const void* value, uintmax_t size)
+    {
+        if (block.count == 0) block.first = (uint32_t)queue.uniforms.size();
+
+        RenderUniform uniform;
+        uniform.slot = slot;
+        uniform.type = type;
+        memcpy(uniform.float_values, value, size);
+        queue.uniforms.push_back(uniform);
+        block.count++;
+    }
+
+    void add_render_uniform(RenderQueue& queue, RenderUniformBlock& block, uint32_t slot, GLint value)
+    {
+        add_uniform(queue, block, slot, RENDER_UNIFORM_INT, &value, sizeof(value));
+    }
+
+    void add_render_uniform(RenderQueue& queue, RenderUniformBlock& block, uint32_t slot, float value)
+    {
+        add_uniform(queue, block, slot, RENDER_UNIFORM_FLOAT, &value, sizeof(value));
+    }
+
+    void add_render_uniform(RenderQueue& queue, RenderUniformBlock& block, uint32_t slot, const glm::vec2& value)
+    {
+        add_uniform(queue, block, slot, RENDER_UNIFORM_VEC2, &value[0], sizeof(value));
+    }
+
+    void add_render_uniform(RenderQueue& queue, RenderUniformBlock& block, uint32_t slot, const glm::vec3& value)
+    {
+        add_uniform(queue, block, slot, RENDER_UNIFORM_VEC3, &value[0], sizeof(value));
+    }
+
+    void add_render_uniform(RenderQueue& queue, RenderUniformBlock& block, uint32_t slot, const glm::vec4& value)
+    {
+        add_uniform(queue, block, slot, RENDER_UNIFORM_VEC4, &value[0], sizeof(value));
+    }
+
+    void add_render_uniform(RenderQueue& queue, RenderUniformBlock& block, uint32_t slot, const glm::mat4& value)
+    {
+        add_uniform(queue, block, slot, RENDER_UNIFORM_MAT4, &value[0][0], sizeof(value));
+    }
+
+    static void record_command(RenderQueue& queue, uint8_t layer, uint32_t depth, RenderCommand& command)
+    {
+        intmax_t worker_index = get_job_worker_index(*queue.jobs);
+        if (worker_index < 0) {
+            LOG_ERROR("[RENDER] Commands have to be recorded on a job system thread, dropped one");
+            return;
+        }
+
+        // States are only added before recording starts, reading them here is safe
+        const ShaderProgram* program = queue.states[command.state].program;
+        command.sort_key = make_sort_key(layer, program ? program->id : 0, command.material, depth);
+        queue.thread_buffers[(uintmax_t)worker_index].commands.push_back(command);
+    }
+
+    void record_clear(RenderQueue& queue, uint8_t layer, uint16_t state)
+    {
+        RenderCommand command = { 0, RENDER_COMMAND_CLEAR, state, 0, 0, 0, nullptr };
+        record_command(queue, layer, 0, command);
+    }
+
+    void record_quad_draw(RenderQueue& queue, uint8_t layer, uint16_t state, uint16_t material, const QuadInstances& quads)
+    {
+        RenderCommand command = { 0, RENDER_COMMAND_DRAW_QUADS, state, material, 0, (uint32_t)quads.instances.size(), &quads };
+        record_command(queue, layer, 0, command);
+    }
+
+    void record_sprite_draw(RenderQueue& queue, uint8_t layer, uint16_t state, uint16_t material, const SpriteBatch& batch, const SpriteDrawRun& run, uint32_t depth)
+    {
+        RenderCommand command = { 0, RENDER_COMMAND_DRAW_SPRITES, state, material, (uint32_t)run.first_sprite, (uint32_t)run.sprite_count, &batch };
+        record_command(queue, layer, depth, command);
+    }
+
+    void record_fullscreen_draw(RenderQueue& queue, uint8_t layer, uint16_t state, uint16_t material)
+    {
+        RenderCommand command = { 0, RENDER_COMMAND_DRAW_FULLSCREEN, state, material, 0, 3, nullptr };
+        record_command(queue, layer, 0, command);
+    }
+
+    // LSD radix sort over bytes, stable so equal keys keep their recording order. All eight histograms come from one
+    // pass over the keys and bytes every key shares are skipped, which with few layers and programs is most of them
+    static void radix_sort_entries(FrameVector<RenderSortEntry>& entries, FrameVector<RenderSortEntry>& scratch)
+    {
+        uintmax_t count = entries.size();
+        if (count < 2) return;
+        scratch.resize(count);
+
+        uintmax_t histograms[8][256] = {};
+        for (const RenderSortEntry& entry : entries) {
+            for (uintmax_t byte = 0; byte < 8; byte++) histograms[byte][(entry.key >> (byte * 8)) & 0xFF]++;
+        }
+
+        RenderSortEntry* source = entries.data();
+        RenderSortEntry* target = scratch.data();
+        for (uintmax_t byte = 0; byte < 8; byte++) {
+            uintmax_t* histogram = histograms[byte];
+            if (histogram[(source[0].key >> (byte * 8)) & 0xFF] == count) continue;
+
+            uintmax_t offset = 0;
+            for (uintmax_t digit = 0; digit < 256; digit++) {
+                uintmax_t digit_count = histogram[digit];
+                histogram[digit] = offset;
+                offset += digit_count;
+            }
+
+            for (uintmax_t i = 0; i < count; i++) {
+                const RenderSortEntry& entry = source[i];
+                target[histogram[(entry.key >> (byte * 8)) & 0xFF]++] = entry;
+            }
+            std::swap(source, target);
+        }
+
+        if (source != entries.data()) entries.swap(scratch);
+    }
+
+    void sort_render_queue(RenderQueue& queue)
+    {
+        PROFILE_ZONE("Render queue sort");
+
+        for (const RenderCommandBuffer& buffer : queue.thread_buffers) {
+            for (const RenderCommand& command : buffer.commands) queue.sorted.push_back(RenderSortEntry{ command.sort_key, &command });
+        }
+        radix_sort_entries(queue.sorted, queue.sort_scratch);
+    }
+
+    void create_render_backend(RenderBackend& backend)
+    {
+        for (uintmax_t unit = 0; unit < RENDER_BACKEND_TEXTURE_UNITS; unit++) {
+            std::fill(backend.bound_textures[unit], backend.bound_textures[unit] + 3, (GLuint)-1);
+        }
+        glActiveTexture(GL_TEXTURE0 + RENDER_BACKEND_SCRATCH_TEXTURE_UNIT);
+        backend.active_unit = RENDER_BACKEND_SCRATCH_TEXTURE_UNIT;
+
+        glGenVertexArrays(1, &backend.empty_VAO);
+    }
+
+    void destroy_render_backend(RenderBackend& backend)
+    {
+        glDeleteVertexArrays(1, &backend.empty_VAO);
+        backend.empty_VAO = 0;
+    }
+
+    static intmax_t get_target_slot(GLenum target)
+    {
+        switch (target) {
+        case GL_TEXTURE_2D: return 0;
+        case GL_TEXTURE_2D_ARRAY: return 1;
+        case GL_TEXTURE_BUFFER: return 2;
+        default: return -1;
+        }
+    }
+
+    static void bind_framebuffer(RenderBackend& backend, GLuint framebuffer)
+    {
+        if (backend.framebuffer_known && backend.framebuffer == framebuffer) return;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        backend.framebuffer = framebuffer;
+        backend.framebuffer_known = true;
+    }
+
+    static void apply_state(const RenderQueue& queue, RenderBackend& backend, uint16_t state_index)
+    {
+        if (backend.state == (intmax_t)state_index) return;
+        backend.state = state_index;
+
+        const RenderState& state = queue.states[state_index];
+        bind_framebuffer(backend, state.framebuffer);
+
+        ShaderProgram* program = state.program;
+        if (!program) return;
+
+        if (backend.program != program->id) {
+            glUseProgram(program->id);
+            backend.program = program->id;
+            PROFILE_COUNT(PROFILE_COUNTER_PROGRAM_SWITCHES, 1);
+        }
+
+        // `set_uniform` still compares against the program's last upload, most of these are no-ops after the first frame
+        for (uint32_t i = 0; i < state.uniforms.count; i++) {
+            const RenderUniform& uniform = queue.uniforms[state.uniforms.first + i];
+            UniformHandle handle = state.uniform_handles[uniform.slot];
+            if (handle == INVALID_UNIFORM_HANDLE) continue;
+
+            switch (uniform.type) {
+            case RENDER_UNIFORM_INT: set_uniform(*program, handle, uniform.int_value); break;
+            case RENDER_UNIFORM_FLOAT: set_uniform(*program, handle, uniform.float_values[0]); break;
+            case RENDER_UNIFORM_VEC2: set_uniform(*program, handle, *(const glm::vec2*)uniform.float_values); break;
+            case RENDER_UNIFORM_VEC3: set_uniform(*program, handle, *(const glm::vec3*)uniform.float_values); break;
+            case RENDER_UNIFORM_VEC4: set_uniform(*program, handle, *(const glm::vec4*)uniform.float_values); break;
+            case RENDER_UNIFORM_MAT4: set_uniform(*program, handle, *(const glm::mat4*)uniform.float_values); break;
+            }
+        }
+    }
+
+    static void apply_material(const RenderQueue& queue, RenderBackend& backend, uint16_t material_index)
+    {
+        if (backend.material == (intmax_t)material_index) return;
+        backend.material = material_index;
+
+        const RenderMaterial& material = queue.materials[material_index];
+        for (uint32_t i = 0; i < material.texture_count; i++) {
+            const RenderTextureBinding& binding = material.textures[i];
+
+            // Untracked units and targets are always bound
+            intmax_t slot = get_target_slot(binding.target);
+            bool tracked = binding.unit < RENDER_BACKEND_TEXTURE_UNITS && slot >= 0;
+            if (tracked && backend.bound_textures[binding.unit][slot] == binding.texture) continue;
+
+            if (backend.active_unit != binding.unit) {
+                glActiveTexture(GL_TEXTURE0 + binding.unit);
+                backend.active_unit = binding.unit;
+            }
+            glBindTexture(binding.target, binding.texture);
+            PROFILE_COUNT(PROFILE_COUNTER_TEXTURE_BINDS, 1);
+            if (tracked) backend.bound_textures[binding.unit][slot] = binding.texture;
+        }
+    }
+
+    void execute_render_queue(const RenderQueue& queue, RenderBackend& backend, uint8_t first_layer, uint8_t last_layer)
+    {
+        backend.state = -1;
+        backend.material = -1;
+        backend.framebuffer_known = false;
+
+        uint64_t first_key = (uint64_t)first_layer << 56;
+        auto it = std::lower_bound(queue.sorted.begin(), queue.sorted.end(), first_key, [](const RenderSortEntry& entry, uint64_t key) { return entry.key < key; });
+
+        for (; it != queue.sorted.end() && (uint8_t)(it->key >> 56) <= last_layer; ++it) {
+            const RenderCommand& command = *it->command;
+            apply_state(queue, backend, command.state);
+
+            switch (command.type) {
+            case RENDER_COMMAND_CLEAR: {
+                const float* color = queue.states[command.state].clear_color;
+                glClearColor(color[0], color[1], color[2], color[3]);
+                glClear(GL_COLOR_BUFFER_BIT);
+                break;
+            }
+            case RENDER_COMMAND_DRAW_QUADS:
+                apply_material(queue, backend, command.material);
+                draw_quad_instances(*(const QuadInstances*)command.geometry);
+                break;
+            case RENDER_COMMAND_DRAW_SPRITES: {
+                apply_material(queue, backend, command.material);
+                const SpriteBatch& batch = *(const SpriteBatch*)command.geometry;
+                draw_sprite_run(batch, SpriteDrawRun{ backend.program, command.first, command.count });
+                break;
+            }
+            case RENDER_COMMAND_DRAW_FULLSCREEN:
+                apply_material(queue, backend, command.material);
+                glBindVertexArray(backend.empty_VAO);
+                glDrawArrays(GL_TRIANGLES, 0, (GLsizei)command.count);
+                PROFILE_COUNT(PROFILE_COUNTER_DRAW_CALLS, 1);
+                break;
+            }
+        }
+
+        // Texture uploads elsewhere bind on whatever unit is active, keep them off the tracked ones
+        if (backend.active_unit != RENDER_BACKEND_SCRATCH_TEXTURE_UNIT) {
+            glActiveTexture(GL_TEXTURE0 + RENDER_BACKEND_SCRATCH_TEXTURE_UNIT);
+            backend.active_unit = RENDER_BACKEND_SCRATCH_TEXTURE_UNIT;
+        }
+    }
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "logging.h"
+#include "frame_arena.h"
+#include "job_system.h"
+#include "profiler.h"
+#include "shader_program.h"
+#include "sprite_batch.h"
+#include "quad_instances.h"
+
+// Textures one `RenderMaterial` binds
+#define RENDER_MATERIAL_MAX_TEXTURES 8
+
+// Units the backend tracks, it leaves the one after them active so uploads elsewhere cannot disturb its bindings
+#define RENDER_BACKEND_TEXTURE_UNITS 8
+#define RENDER_BACKEND_SCRATCH_TEXTURE_UNIT RENDER_BACKEND_TEXTURE_UNITS
+
+namespace Engine
+{
+    enum RenderCommandType : uint16_t {
+        RENDER_COMMAND_CLEAR,            // The state's framebuffer to its clear color
+        RENDER_COMMAND_DRAW_QUADS,       // Every instance of a `QuadInstances`
+        RENDER_COMMAND_DRAW_SPRITES,     // One run of a flushed `SpriteBatch`
+        RENDER_COMMAND_DRAW_FULLSCREEN,  // Attribute-less triangle covering the viewport
+    };
+
+    enum RenderUniformType : uint32_t {
+        RENDER_UNIFORM_INT,
+        RENDER_UNIFORM_FLOAT,
+        RENDER_UNIFORM_VEC2,
+        RENDER_UNIFORM_VEC3,
+        RENDER_UNIFORM_VEC4,
+        RENDER_UNIFORM_MAT4,
+    };
+
+    // A value for whichever uniform a state maps `slot` to
+    struct RenderUniform {
+        uint32_t slot;
+        RenderUniformType type;
+        union {
+            GLint int_value;
+            float float_values[16];
+        };
+    };
+
+    // Range of `RenderQueue::uniforms`, shared by every state created with it
+    struct RenderUniformBlock {
+        uint32_t first = 0;
+        uint32_t count = 0;
+    };
+
+    // Program, target and uniform values, applied once when a command uses a different state than the one before it
+    struct RenderState {
+        ShaderProgram* program = nullptr;  // None for states only used to clear
+        const UniformHandle* uniform_handles = nullptr;  // Per slot, invalid handles are skipped
+        RenderUniformBlock uniforms;
+        GLuint framebuffer = 0;
+        float clear_color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    };
+
+    struct RenderTextureBinding {
+        GLuint unit;
+        GLenum target;
+        GLuint texture;
+    };
+
+    struct RenderMaterial {
+        RenderTextureBinding textures[RENDER_MATERIAL_MAX_TEXTURES];
+        uint32_t texture_count = 0;
+    };
+
+    inline void add_material_texture(RenderMaterial& material, GLuint unit, GLenum target, GLuint texture)
+    {
+        if (material.texture_count < RENDER_MATERIAL_MAX_TEXTURES) material.textures[material.texture_count++] = RenderTextureBinding{ unit, target, texture };
+    }
+
+    // Sorted as one integer, most significant first: layer (8 bits), program (16), material (16), depth (24). Layers
+    // keep their order, inside a layer commands group by program and material and fall back to submission depth
+    struct RenderCommand {
+        uint64_t sort_key;
+        RenderCommandType type;
+        uint16_t state;     // Index into `RenderQueue::states`
+        uint16_t material;  // Index into `RenderQueue::materials`
+        uint32_t first;     // Sprite range of `DRAW_SPRITES`
+        uint32_t count;
+        const void* geometry;  // `QuadInstances` or `SpriteBatch`
+    };
+    static_assert(sizeof(RenderCommand) <= 32, "RenderCommand must stay compact");
+
+    // Commands recorded by one job thread, padded so neighbours do not share a cache line
+    struct alignas(64) RenderCommandBuffer {
+        FrameVector<RenderCommand> commands;
+    };
+
+    struct RenderSortEntry {
+        uint64_t key;
+        const RenderCommand* command;
+    };
+
+    // Per frame: begin, add states/materials and their uniforms on one thread, record commands from any job system
+    // thread, sort, then execute the layers in order. Everything but the thread buffer list lives in the frame arena
+    // passed to `begin_render_queue`
+    struct RenderQueue {
+        FrameVector<RenderState> states;
+        FrameVector<RenderMaterial> materials;
+        FrameVector<RenderUniform> uniforms;
+        std::vector<RenderCommandBuffer> thread_buffers;  // One per job thread, merged by the sort
+        FrameVector<RenderSortEntry> sorted;
+        FrameVector<RenderSortEntry> sort_scratch;
+        JobSystem* jobs = nullptr;
+    };
+
+    // Tracks what is bound so repeated state, program and texture binds are skipped, also across frames.
+    // Expects nothing else to bind programs or textures on its units while it is in use
+    struct RenderBackend {
+        intmax_t state = -1;  // Per frame indices, reset by every execute
+        intmax_t material = -1;
+        GLuint program = 0;
+        GLuint framebuffer = 0;
+        bool framebuffer_known = false;  // Others bind framebuffers between executes
+        GLuint active_unit = RENDER_BACKEND_SCRATCH_TEXTURE_UNIT;
+        GLuint bound_textures[RENDER_BACKEND_TEXTURE_UNITS][3];  // Per unit: 2D, 2D array, buffer. Unknown until first bound
+        GLuint empty_VAO = 0;  // Core profile needs a bound VAO even for attribute-less draws
+    };
+
+    void create_render_queue(RenderQueue& queue, JobSystem& jobs);
+    void destroy_render_queue(RenderQueue& queue);
+
+    // Drops everything recorded last frame and records this one into `arena`, which must not be reset before the
+    // queue was executed
+    void begin_render_queue(RenderQueue& queue, FrameArena& arena);
+
+    // Not thread safe, add before recording the commands that use them
+    uint16_t add_render_state(RenderQueue& queue, const RenderState& state);
+    uint16_t add_render_material(RenderQueue& queue, const RenderMaterial& material);
+
+    // Appends to `block`, which has to be the last block added to
+    void add_render_uniform(RenderQueue& queue, RenderUniformBlock& block, uint32_t slot, GLint value);
+    void add_render_uniform(RenderQueue& queue, RenderUniformBlock& block, uint32_t slot, float value);
+    void add_render_uniform(RenderQueue& queue, RenderUniformBlock& block, uint32_t slot, const glm::vec2& value);
+    void add_render_uniform(RenderQueue& queue, RenderUniformBlock& block, uint32_t slot, const glm::vec3& value);
+    void add_render_uniform(RenderQueue& queue, RenderUniformBlock& block, uint32_t slot, const glm::vec4& value);
+    void add_render_uniform(RenderQueue& queue, RenderUniformBlock& block, uint32_t slot, const glm::mat4& value);
+
+    // Thread safe from the job system's threads, each records into its own buffer. Clears sort before draws in a layer
+    void record_clear(RenderQueue& queue, uint8_t layer, uint16_t state);
+    void record_quad_draw(RenderQueue& queue, uint8_t layer, uint16_t state, uint16_t material, const QuadInstances& quads);
+    void record_sprite_draw(RenderQueue& queue, uint8_t layer, uint16_t state, uint16_t material, const SpriteBatch& batch, const SpriteDrawRun& run, uint32_t depth);
+    void record_fullscreen_draw(RenderQueue& queue, uint8_t layer, uint16_t state, uint16_t material);
+
+    // Merges the thread buffers and radix sorts them by key, once every recording job finished
+    void sort_render_queue(RenderQueue& queue);
+
+    void create_render_backend(RenderBackend& backend);
+    void destroy_render_backend(RenderBackend& backend);
+
+    // Runs the sorted commands of layers [first_layer, last_layer]
+    void execute_render_queue(const RenderQueue& queue, RenderBackend& backend, uint8_t first_layer, uint8_t last_layer);
+}
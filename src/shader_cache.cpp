@@ -0,0 +1,189 @@
+#include "shader_cache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#define PROGRAM_CACHE_MAGIC 0x4E494250  // "PBIN"
+
+namespace Engine
+{
+    struct ProgramCacheHeader {
+        uint32_t magic = PROGRAM_CACHE_MAGIC;
+        uint32_t version = PROGRAM_CACHE_FILE_VERSION;
+        uint64_t key = 0;
+        uint32_t binary_format = 0;
+        uint32_t binary_size = 0;
+    };
+
+    static uint64_t hash_string(uint64_t hash, const char* text)
+    {
+        if (!text) text = "";
+        // Length first so ("ab", "c") and ("a", "bc") differ
+        uint64_t length = strlen(text);
+        hash = hash_shader_bytes(hash, &length, sizeof(length));
+        return hash_shader_bytes(hash, text, length);
+    }
+
+    static double get_elapsed_ms(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    static std::string get_program_cache_path(const ProgramCache& cache, uint64_t key)
+    {
+        char file_name[32];
+        snprintf(file_name, sizeof(file_name), "%016llx.bin", (unsigned long long)key);
+        return cache.directory + "/" + file_name;
+    }
+
+    void open_program_cache(ProgramCache& cache, const std::string& directory, GLADloadproc load_proc)
+    {
+        cache = ProgramCache();
+        cache.directory = directory;
+
+        GLint major_version = 0;
+        GLint minor_version = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major_version);
+        glGetIntegerv(GL_MINOR_VERSION, &minor_version);
+        bool core = major_version > 4 || (major_version == 4 && minor_version >= 1);
+
+        GLint format_count = 0;
+        if (load_proc && (core || has_gl_extension("GL_ARB_get_program_binary"))) {
+            cache.get_program_binary = (GetProgramBinaryFunction)load_proc("glGetProgramBinary");
+            cache.program_binary = (ProgramBinaryFunction)load_proc("glProgramBinary");
+            cache.program_parameteri = (ProgramParameteriFunction)load_proc("glProgramParameteri");
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+        }
+        cache.supported = cache.get_program_binary && cache.program_binary && cache.program_parameteri && format_count > 0;
+        if (!cache.supported) {
+            log_info("[SHADER] Program binaries are not supported, every program compiles from source");
+            return;
+        }
+
+        cache.driver_hash = SHADER_HASH_SEED;
+        cache.driver_hash = hash_string(cache.driver_hash, (const char*)glGetString(GL_VENDOR));
+        cache.driver_hash = hash_string(cache.driver_hash, (const char*)glGetString(GL_RENDERER));
+        cache.driver_hash = hash_string(cache.driver_hash, (const char*)glGetString(GL_VERSION));
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error) log_warning("[SHADER] Failed to create `" + directory + "`: " + error.message() + ", binaries will not be stored");
+    }
+
+    void close_program_cache(ProgramCache& cache)
+    {
+        if (!cache.supported) return;
+
+        log_info("[SHADER] Program cache: " + std::to_string(cache.hit_count) + " loaded in " + std::to_string(cache.load_ms) + " ms, " +
+            std::to_string(cache.miss_count) + " compiled in " + std::to_string(cache.compile_ms) + " ms");
+        if (cache.rejected_count > 0) log_warning("[SHADER] " + std::to_string(cache.rejected_count) + " cached binaries were rejected by the driver and rebuilt");
+    }
+
+    // 0 if there is no usable binary for `key`
+    static GLuint load_cached_program(ProgramCache& cache, uint64_t key)
+    {
+        std::string path = get_program_cache_path(cache, key);
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return 0;
+
+        ProgramCacheHeader header;
+        file.read((char*)&header, sizeof(header));
+        bool valid = file && header.magic == PROGRAM_CACHE_MAGIC && header.version == PROGRAM_CACHE_FILE_VERSION && header.key == key && header.binary_size > 0;
+
+        std::vector<unsigned char> binary;
+        if (valid) {
+            binary.resize(header.binary_size);
+            file.read((char*)binary.data(), (std::streamsize)binary.size());
+            valid = (bool)file;
+        }
+        file.close();
+
+        GLuint program = 0;
+        if (valid) {
+            program = glCreateProgram();
+            cache.program_binary(program, (GLenum)header.binary_format, binary.data(), (GLsizei)binary.size());
+
+            GLint success = 0;
+            glGetProgramiv(program, GL_LINK_STATUS, &success);
+            if (!success) {
+                glDeleteProgram(program);
+                program = 0;
+            }
+        }
+
+        if (!program) {
+            log_warning("[SHADER] Discarding cached program `" + path + "`");
+            cache.rejected_count++;
+            std::error_code error;
+            std::filesystem::remove(path, error);
+        }
+        return program;
+    }
+
+    static void store_cached_program(ProgramCache& cache, uint64_t key, GLuint program)
+    {
+        GLint binary_size = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+        if (binary_size <= 0) return;
+
+        std::vector<unsigned char> binary((size_t)binary_size);
+        GLenum binary_format = 0;
+        GLsizei length = 0;
+        cache.get_program_binary(program, binary_size, &length, &binary_format, binary.data());
+        if (length <= 0) return;
+
+        ProgramCacheHeader header;
+        header.key = key;
+        header.binary_format = (uint32_t)binary_format;
+        header.binary_size = (uint32_t)length;
+
+        // Written aside and renamed, so a crash mid write never leaves a truncated entry behind
+        std::string path = get_program_cache_path(cache, key);
+        std::string temporary_path = path + ".tmp";
+        {
+            std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+            if (!file) return;
+            file.write((const char*)&header, sizeof(header));
+            file.write((const char*)binary.data(), length);
+            if (!file) return;
+        }
+        std::error_code error;
+        std::filesystem::remove(path, error);  // Windows will not rename over an existing file
+        std::filesystem::rename(temporary_path, path, error);
+        if (error) log_warning("[SHADER] Failed to store `" + path + "`: " + error.message());
+    }
+
+    GLuint create_cached_program(ProgramCache& cache, const char* vertex_shader_source, const char* fragment_shader_source)
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (!cache.supported) {
+            GLuint program = create_generic_shader(vertex_shader_source, fragment_shader_source);
+            cache.miss_count++;
+            cache.compile_ms += get_elapsed_ms(start);
+            return program;
+        }
+
+        uint64_t key = cache.driver_hash;
+        key = hash_string(key, vertex_shader_source);
+        key = hash_string(key, fragment_shader_source);
+
+        GLuint program = load_cached_program(cache, key);
+        if (program) {
+            cache.hit_count++;
+            cache.load_ms += get_elapsed_ms(start);
+            return program;
+        }
+
+        program = glCreateProgram();
+        cache.program_parameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        if (link_generic_shader(program, vertex_shader_source, fragment_shader_source)) store_cached_program(cache, key, program);
+
+        cache.miss_count++;
+        cache.compile_ms += get_elapsed_ms(start);
+        return program;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <string>
+
+#include <glad/glad.h>
+
+#include "logging.h"
+#include "shader_utils.h"
+
+// Relative to `game/bin`, safe to delete
+#define PROGRAM_CACHE_DIRECTORY "../shader_cache"
+// Bumped whenever the file layout changes, older files then miss
+#define PROGRAM_CACHE_FILE_VERSION 1
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+namespace Engine
+{
+    // ARB_get_program_binary (core in 4.1), GLAD only loads 3.3 core so these are looked up by hand
+    typedef void (APIENTRYP GetProgramBinaryFunction)(GLuint program, GLsizei buffer_size, GLsizei* length, GLenum* binary_format, void* binary);
+    typedef void (APIENTRYP ProgramBinaryFunction)(GLuint program, GLenum binary_format, const void* binary, GLsizei length);
+    typedef void (APIENTRYP ProgramParameteriFunction)(GLuint program, GLenum name, GLint value);
+
+    // Linked program binaries on disk, one file per program keyed on a hash of its sources and the driver strings.
+    // Binaries from another driver version never match, one the driver rejects is deleted and rebuilt from source
+    struct ProgramCache {
+        std::string directory;
+        bool supported = false;
+        uint64_t driver_hash = 0;  // Vendor, renderer and version strings
+
+        GetProgramBinaryFunction get_program_binary = nullptr;
+        ProgramBinaryFunction program_binary = nullptr;
+        ProgramParameteriFunction program_parameteri = nullptr;
+
+        // Statistics
+        uintmax_t hit_count = 0;
+        uintmax_t miss_count = 0;
+        uintmax_t rejected_count = 0;  // Matching file the driver would not load
+        double load_ms = 0.0;
+        double compile_ms = 0.0;
+    };
+
+    // `load_proc` resolves the entry points GLAD does not load. Expects a current OpenGL context
+    void open_program_cache(ProgramCache& cache, const std::string& directory, GLADloadproc load_proc);
+    // Logs hit and timing statistics
+    void close_program_cache(ProgramCache& cache);
+
+    // Loads the program from the cache when a binary matches, otherwise compiles it and stores the binary.
+    // Defines and other specialisation have to be part of the sources, they are the key
+    GLuint create_cached_program(ProgramCache& cache, const char* vertex_shader_source, const char* fragment_shader_source);
+}
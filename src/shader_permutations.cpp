@@ -0,0 +1,206 @@
+#include "shader_permutations.h"
+
+#include <chrono>
+
+namespace Engine
+{
+    static const uintmax_t s_light_buckets[] = { 0, 4, 8, 16, 32, 64, MAX_POINT_LIGHT_COUNT };
+
+    void create_shader_permutations(ShaderPermutations& permutations, const std::string& name, const std::string& vertex_shader_path,
+        const std::string& fragment_shader_path, const std::vector<std::string>& uniform_names, ShaderPreprocessor& preprocessor, ProgramCache* cache)
+    {
+        permutations = ShaderPermutations();
+        permutations.name = name;
+        permutations.vertex_shader_path = vertex_shader_path;
+        permutations.fragment_shader_path = fragment_shader_path;
+        permutations.vertex_shader = preprocess_shader(preprocessor, vertex_shader_path);
+        permutations.fragment_shader = preprocess_shader(preprocessor, fragment_shader_path);
+        permutations.uniform_names = uniform_names;
+        permutations.cache = cache;
+    }
+
+    void destroy_shader_permutations(ShaderPermutations& permutations)
+    {
+        if (!permutations.variants.empty()) {
+            log_debug("[SHADER] `" + permutations.name + "`: " + std::to_string(permutations.variants.size()) + " variants built in " + std::to_string(permutations.compile_ms) + " ms");
+        }
+
+        for (auto& [key, variant] : permutations.variants) {
+            destroy_shader_program(variant.program);
+            if (variant.pending_program) glDeleteProgram(variant.pending_program);
+        }
+        permutations = ShaderPermutations();
+    }
+
+    uintmax_t get_light_bucket(uintmax_t light_count)
+    {
+        for (uintmax_t bucket : s_light_buckets) {
+            if (light_count <= bucket) return bucket;
+        }
+        return MAX_POINT_LIGHT_COUNT;
+    }
+
+    std::string get_shader_variant_defines(uintmax_t light_bucket, uint32_t features)
+    {
+        std::string defines;
+        defines += "#define POINT_LIGHT_BUCKET " + std::to_string(light_bucket) + "\n";
+        defines += (features & SHADER_FEATURE_LIGHT_MASK) ? "#define ENABLE_LIGHT_MASK 1\n" : "#define ENABLE_LIGHT_MASK 0\n";
+        defines += (features & SHADER_FEATURE_SPECULAR) ? "#define ENABLE_SPECULAR 1\n" : "#define ENABLE_SPECULAR 0\n";
+        defines += (features & SHADER_FEATURE_NORMAL_MAPPING) ? "#define ENABLE_NORMAL_MAPPING 1\n" : "#define ENABLE_NORMAL_MAPPING 0\n";
+        return defines;
+    }
+
+    static std::string get_shader_feature_names(uint32_t features)
+    {
+        std::string names;
+        if (features & SHADER_FEATURE_LIGHT_MASK) names += " light-mask";
+        if (features & SHADER_FEATURE_SPECULAR) names += " specular";
+        if (features & SHADER_FEATURE_NORMAL_MAPPING) names += " normal-mapping";
+        return names.empty() ? " none" : names;
+    }
+
+    // After the `#version` line, which has to come first. `#line` keeps compile errors pointing at the file's own lines
+    static std::string inject_shader_defines(const std::string& source, const std::string& defines)
+    {
+        size_t version_end = source.find('\n', source.find("#version"));
+        if (version_end == std::string::npos) return defines + source;
+
+        return source.substr(0, version_end + 1) + defines + "#line 2\n" + source.substr(version_end + 1);
+    }
+
+    // Handles and the light block binding, after `variant.program` was linked
+    static void resolve_shader_variant(const ShaderPermutations& permutations, ShaderVariant& variant)
+    {
+        variant.uniforms.resize(permutations.uniform_names.size());
+        for (uintmax_t i = 0; i < permutations.uniform_names.size(); i++) {
+            variant.uniforms[i] = find_uniform_handle(variant.program, permutations.uniform_names[i]);
+        }
+
+        // The zero light variant has no light block at all
+        if (variant.light_bucket > 0) bind_point_light_block(variant.program.id);
+    }
+
+    static void start_shader_variant_reload(ShaderPermutations& permutations, ShaderVariant& variant)
+    {
+        std::string defines = get_shader_variant_defines(variant.light_bucket, variant.features);
+        std::string vertex_shader_source = inject_shader_defines(permutations.pending_vertex_shader.source, defines);
+        std::string fragment_shader_source = inject_shader_defines(permutations.pending_fragment_shader.source, defines);
+
+        if (variant.pending_program) glDeleteProgram(variant.pending_program);
+        variant.pending_program = start_generic_shader_link(vertex_shader_source.c_str(), fragment_shader_source.c_str());
+    }
+
+    ShaderVariant& get_shader_variant(ShaderPermutations& permutations, uintmax_t light_count, uint32_t features)
+    {
+        uintmax_t light_bucket = get_light_bucket(light_count);
+        uint32_t key = ((uint32_t)light_bucket << 8) | features;
+
+        auto it = permutations.variants.find(key);
+        if (it != permutations.variants.end()) return it->second;
+
+        auto start = std::chrono::steady_clock::now();
+
+        std::string defines = get_shader_variant_defines(light_bucket, features);
+        std::string vertex_shader_source = inject_shader_defines(permutations.vertex_shader.source, defines);
+        std::string fragment_shader_source = inject_shader_defines(permutations.fragment_shader.source, defines);
+
+        ShaderVariant& variant = permutations.variants[key];
+        variant.light_bucket = light_bucket;
+        variant.features = features;
+        variant.program = create_shader_program(vertex_shader_source.c_str(), fragment_shader_source.c_str(), permutations.cache);
+        resolve_shader_variant(permutations, variant);
+
+        // Built from the last good sources, it still has to join the reload in flight
+        if (permutations.reload_pending) start_shader_variant_reload(permutations, variant);
+
+        double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        permutations.compile_ms += elapsed_ms;
+        log_info("[SHADER] `" + permutations.name + "` variant for " + std::to_string(light_bucket) + " lights (features:" + get_shader_feature_names(features) +
+            ") ready in " + std::to_string(elapsed_ms) + " ms");
+        return variant;
+    }
+
+    void build_shader_variants(ShaderPermutations& permutations, uintmax_t max_light_count, uint32_t features)
+    {
+        uintmax_t max_light_bucket = get_light_bucket(max_light_count);
+        for (uintmax_t light_bucket : s_light_buckets) {
+            if (light_bucket <= max_light_bucket) get_shader_variant(permutations, light_bucket, features);
+        }
+    }
+
+    // Latest update for `path`, or `current` if there is none
+    static const PreprocessedShader& find_shader_update(const std::vector<ShaderSourceUpdate>& updates, const std::string& path, const PreprocessedShader& current)
+    {
+        for (auto it = updates.rbegin(); it != updates.rend(); it++) {
+            if (it->path == path) return it->shader;
+        }
+        return current;
+    }
+
+    bool reload_shader_permutations(ShaderPermutations& permutations, const std::vector<ShaderSourceUpdate>& updates)
+    {
+        // Includes make any file a possible dependency, the hashes tell whether this set is affected
+        const PreprocessedShader& current_vertex_shader = permutations.reload_pending ? permutations.pending_vertex_shader : permutations.vertex_shader;
+        const PreprocessedShader& current_fragment_shader = permutations.reload_pending ? permutations.pending_fragment_shader : permutations.fragment_shader;
+        const PreprocessedShader& vertex_shader = find_shader_update(updates, permutations.vertex_shader_path, current_vertex_shader);
+        const PreprocessedShader& fragment_shader = find_shader_update(updates, permutations.fragment_shader_path, current_fragment_shader);
+        if (vertex_shader.hash == current_vertex_shader.hash && fragment_shader.hash == current_fragment_shader.hash) return false;
+
+        // Copies, other sets may take the same updates. Assigning a pending stage to itself is a no-op
+        permutations.pending_vertex_shader = vertex_shader;
+        permutations.pending_fragment_shader = fragment_shader;
+
+        if (permutations.variants.empty()) {
+            permutations.vertex_shader = permutations.pending_vertex_shader;
+            permutations.fragment_shader = permutations.pending_fragment_shader;
+            return true;
+        }
+
+        permutations.reload_pending = true;
+        permutations.reload_frame_count = 0;
+        for (auto& [key, variant] : permutations.variants) start_shader_variant_reload(permutations, variant);
+
+        log_info("[SHADER] Reloading `" + permutations.name + "`, " + std::to_string(permutations.variants.size()) + " variants");
+        return true;
+    }
+
+    void update_shader_permutations(ShaderPermutations& permutations)
+    {
+        if (!permutations.reload_pending) return;
+
+        permutations.reload_frame_count++;
+        for (auto& [key, variant] : permutations.variants) {
+            if (!is_generic_shader_link_ready(variant.pending_program, permutations.reload_frame_count)) return;
+        }
+
+        bool linked = true;
+        for (auto& [key, variant] : permutations.variants) linked = finish_generic_shader_link(variant.pending_program) && linked;
+
+        permutations.reload_pending = false;
+        if (!linked) {
+            for (auto& [key, variant] : permutations.variants) {
+                glDeleteProgram(variant.pending_program);
+                variant.pending_program = 0;
+            }
+            // Error lines read `file:line`, with files numbered in include order
+            std::string files;
+            for (uintmax_t i = 0; i < permutations.pending_fragment_shader.files.size(); i++) {
+                files += " " + std::to_string(i) + " = `" + permutations.pending_fragment_shader.files[i] + "`";
+            }
+            log_error("[SHADER] `" + permutations.name + "` failed to reload, keeping the last good programs. Fragment files:" + files);
+            return;
+        }
+
+        for (auto& [key, variant] : permutations.variants) {
+            destroy_shader_program(variant.program);
+            variant.program.id = variant.pending_program;
+            variant.pending_program = 0;
+            reflect_uniforms(variant.program);
+            resolve_shader_variant(permutations, variant);
+        }
+        permutations.vertex_shader = std::move(permutations.pending_vertex_shader);
+        permutations.fragment_shader = std::move(permutations.pending_fragment_shader);
+
+        log_info("[SHADER] Reloaded `" + permutations.name + "` after " + std::to_string(permutations.reload_frame_count) + " frames");
+    }
+}
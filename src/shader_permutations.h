@@ -0,0 +1,82 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <glad/glad.h>
+
+#include "logging.h"
+#include "shader_program.h"
+#include "shader_cache.h"
+#include "light_buffer.h"
+#include "shader_utils.h"
+#include "shader_watcher.h"
+
+namespace Engine
+{
+    // Toggled per variant through `ENABLE_*` defines, see the top of `point_lighting.glsl`
+    enum ShaderFeature : uint32_t {
+        SHADER_FEATURE_LIGHT_MASK = 1 << 0,
+        SHADER_FEATURE_SPECULAR = 1 << 1,
+        SHADER_FEATURE_NORMAL_MAPPING = 1 << 2,
+    };
+
+    // What the lit shaders did before they were specialised
+    #define DEFAULT_SHADER_FEATURES (SHADER_FEATURE_SPECULAR | SHADER_FEATURE_NORMAL_MAPPING)
+
+    struct ShaderVariant {
+        ShaderProgram program;
+        std::vector<UniformHandle> uniforms;  // Same order as `ShaderPermutations::uniform_names`, invalid where compiled out
+        uintmax_t light_bucket = 0;
+        uint32_t features = 0;
+        GLuint pending_program = 0;  // Relinking with reloaded sources, `program` keeps drawing meanwhile
+    };
+
+    // A pair of lit shader sources specialised by defines injected after `#version`: the point light bucket sizes the
+    // light block and bounds the tile loop, the features strip whole terms. Variants are compiled on first use through
+    // the program cache, so a warm start loads every variant it has seen before.
+    // Unlit programs use the same path with a single (0 lights, no features) variant so they reload the same way
+    struct ShaderPermutations {
+        std::string name;  // For logging
+        std::string vertex_shader_path;
+        std::string fragment_shader_path;
+        PreprocessedShader vertex_shader;  // Last sources every variant linked with
+        PreprocessedShader fragment_shader;
+        std::vector<std::string> uniform_names;
+        ProgramCache* cache = nullptr;
+
+        std::unordered_map<uint32_t, ShaderVariant> variants;  // Node based, references stay valid as it grows
+        double compile_ms = 0.0;
+
+        // Hot reload, all variants swap together once every one of them linked with the new sources
+        bool reload_pending = false;
+        PreprocessedShader pending_vertex_shader;
+        PreprocessedShader pending_fragment_shader;
+        uintmax_t reload_frame_count = 0;  // Frames since the relink was started
+    };
+
+    // Preprocesses both stages. `cache` has to outlive the permutations unless it is nullptr
+    void create_shader_permutations(ShaderPermutations& permutations, const std::string& name, const std::string& vertex_shader_path,
+        const std::string& fragment_shader_path, const std::vector<std::string>& uniform_names, ShaderPreprocessor& preprocessor, ProgramCache* cache);
+    void destroy_shader_permutations(ShaderPermutations& permutations);
+
+    // Smallest of 0, 4, 8, 16, 32, 64 and `MAX_POINT_LIGHT_COUNT` that holds `light_count` lights
+    uintmax_t get_light_bucket(uintmax_t light_count);
+    std::string get_shader_variant_defines(uintmax_t light_bucket, uint32_t features);
+
+    // Compiles the variant on first use, a hash lookup afterwards
+    ShaderVariant& get_shader_variant(ShaderPermutations& permutations, uintmax_t light_count, uint32_t features);
+    // Compiles the variants of every light bucket up to the one holding `max_light_count`, so a frame whose light count
+    // crosses a bucket finds its variant already built
+    void build_shader_variants(ShaderPermutations& permutations, uintmax_t max_light_count, uint32_t features);
+
+    // Takes the stages `updates` holds for this set and, if either hash changed, starts relinking every variant in the
+    // background. A reload already in flight is restarted. False if nothing changed
+    bool reload_shader_permutations(ShaderPermutations& permutations, const std::vector<ShaderSourceUpdate>& updates);
+    // Once per frame. Swaps the relinked variants in when all of them are done, or drops them all and keeps the last
+    // good programs if any failed. Never waits on the driver
+    void update_shader_permutations(ShaderPermutations& permutations);
+}
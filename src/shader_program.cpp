@@ -0,0 +1,238 @@
+#include "shader_program.h"
+
+#include <cstring>
+
+namespace Engine
+{
+    static bool is_sampler_type(GLenum type)
+    {
+        switch (type) {
+            case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+            case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_CUBE_SHADOW:
+            case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_1D_ARRAY_SHADOW: case GL_SAMPLER_2D_ARRAY_SHADOW:
+            case GL_SAMPLER_2D_MULTISAMPLE: case GL_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_SAMPLER_BUFFER:
+            case GL_SAMPLER_2D_RECT: case GL_SAMPLER_2D_RECT_SHADOW:
+            case GL_INT_SAMPLER_1D: case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_CUBE:
+            case GL_INT_SAMPLER_1D_ARRAY: case GL_INT_SAMPLER_2D_ARRAY: case GL_INT_SAMPLER_2D_MULTISAMPLE:
+            case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_INT_SAMPLER_BUFFER: case GL_INT_SAMPLER_2D_RECT:
+            case GL_UNSIGNED_INT_SAMPLER_1D: case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D: case GL_UNSIGNED_INT_SAMPLER_CUBE:
+            case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE:
+            case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY: case GL_UNSIGNED_INT_SAMPLER_BUFFER: case GL_UNSIGNED_INT_SAMPLER_2D_RECT:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // What a setter has to upload for a reflected type. Bools and samplers take a `GLint`, bool vectors the int vector
+    // of their size. GL_NONE for types without a known layout
+    static GLenum get_uniform_value_type(GLenum type)
+    {
+        switch (type) {
+            case GL_FLOAT: case GL_FLOAT_VEC2: case GL_FLOAT_VEC3: case GL_FLOAT_VEC4:
+            case GL_FLOAT_MAT2: case GL_FLOAT_MAT3: case GL_FLOAT_MAT4:
+            case GL_INT: case GL_INT_VEC2: case GL_INT_VEC3: case GL_INT_VEC4:
+            case GL_UNSIGNED_INT: case GL_UNSIGNED_INT_VEC2: case GL_UNSIGNED_INT_VEC3: case GL_UNSIGNED_INT_VEC4:
+                return type;
+            case GL_BOOL:       return GL_INT;
+            case GL_BOOL_VEC2:  return GL_INT_VEC2;
+            case GL_BOOL_VEC3:  return GL_INT_VEC3;
+            case GL_BOOL_VEC4:  return GL_INT_VEC4;
+            default:            return is_sampler_type(type) ? GL_INT : GL_NONE;
+        }
+    }
+
+    static uintmax_t get_uniform_value_size(GLenum value_type)
+    {
+        switch (value_type) {
+            case GL_FLOAT: case GL_INT: case GL_UNSIGNED_INT:                        return 4;
+            case GL_FLOAT_VEC2: case GL_INT_VEC2: case GL_UNSIGNED_INT_VEC2:         return 8;
+            case GL_FLOAT_VEC3: case GL_INT_VEC3: case GL_UNSIGNED_INT_VEC3:         return 12;
+            case GL_FLOAT_VEC4: case GL_INT_VEC4: case GL_UNSIGNED_INT_VEC4:         return 16;
+            case GL_FLOAT_MAT2:                                                      return 4 * sizeof(float);
+            case GL_FLOAT_MAT3:                                                      return 9 * sizeof(float);
+            case GL_FLOAT_MAT4:                                                      return 16 * sizeof(float);
+            default:                                                                 return 0;
+        }
+    }
+
+    static void add_uniform(ShaderProgram& program, const std::string& name, GLint location, GLenum type)
+    {
+        UniformInfo info;
+        info.name = name;
+        info.location = location;
+        info.type = type;
+        info.value_type = get_uniform_value_type(type);
+        info.shadow_offset = (uintmax_t)program.shadow_values.size();
+        info.shadow_size = get_uniform_value_size(info.value_type);
+
+        program.shadow_values.resize(program.shadow_values.size() + info.shadow_size);
+        program.uniform_lookup[name] = (UniformHandle)program.uniforms.size();
+        program.uniforms.push_back(info);
+    }
+
+    ShaderProgram create_shader_program(const char* vertex_shader_source, const char* fragment_shader_source, ProgramCache* cache)
+    {
+        ShaderProgram program;
+        program.id = cache ? create_cached_program(*cache, vertex_shader_source, fragment_shader_source) : create_generic_shader(vertex_shader_source, fragment_shader_source);
+        reflect_uniforms(program);
+
+        return program;
+    }
+
+    void reflect_uniforms(ShaderProgram& program)
+    {
+        program.uniforms.clear();
+        program.shadow_values.clear();
+        program.uniform_lookup.clear();
+
+        GLint uniform_count = 0;
+        GLint max_name_length = 0;
+        glGetProgramiv(program.id, GL_ACTIVE_UNIFORMS, &uniform_count);
+        glGetProgramiv(program.id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+
+        std::vector<char> name_buffer((size_t)max_name_length + 1);
+        for (GLint i = 0; i < uniform_count; i++) {
+            GLint array_size = 0;
+            GLenum type = GL_NONE;
+            GLsizei name_length = 0;
+            glGetActiveUniform(program.id, (GLuint)i, (GLsizei)name_buffer.size(), &name_length, &array_size, &type, name_buffer.data());
+
+            std::string name(name_buffer.data(), (size_t)name_length);
+            GLint location = glGetUniformLocation(program.id, name.c_str());
+            if (location == -1) continue;  // Uniform block members have no location
+
+            if (array_size == 1) {
+                add_uniform(program, name, location, type);
+                continue;
+            }
+
+            // Arrays of basic types are reported once as `name[0]`, expand every element
+            std::string base_name = name.substr(0, name.find('['));
+            for (GLint element = 0; element < array_size; element++) {
+                std::string element_name = base_name + "[" + std::to_string(element) + "]";
+                add_uniform(program, element_name, glGetUniformLocation(program.id, element_name.c_str()), type);
+            }
+            program.uniform_lookup[base_name] = program.uniform_lookup[base_name + "[0]"];
+        }
+
+        log_debug("[SHADER] Reflected " + std::to_string(program.uniforms.size()) + " uniforms");
+    }
+
+    void destroy_shader_program(ShaderProgram& program)
+    {
+        glDeleteProgram(program.id);
+        program = ShaderProgram();
+    }
+
+    UniformHandle get_uniform_handle(const ShaderProgram& program, const std::string& name)
+    {
+        auto it = program.uniform_lookup.find(name);
+        if (it == program.uniform_lookup.end()) {
+            log_warning("[SHADER] Uniform `" + name + "` is not active in program " + std::to_string(program.id));
+            return INVALID_UNIFORM_HANDLE;
+        }
+
+        return it->second;
+    }
+
+    UniformHandle find_uniform_handle(const ShaderProgram& program, const std::string& name)
+    {
+        auto it = program.uniform_lookup.find(name);
+        return (it == program.uniform_lookup.end()) ? INVALID_UNIFORM_HANDLE : it->second;
+    }
+
+    // Returns false if `value` matches the last uploaded value or does not fit the uniform
+    static bool update_shadow(ShaderProgram& program, UniformHandle handle, const void* value, uintmax_t size, GLenum value_type)
+    {
+        UniformInfo& info = program.uniforms[handle];
+        if (info.value_type == GL_NONE) {
+            PROFILE_COUNT(PROFILE_COUNTER_UNIFORM_UPLOADS, 1);
+            return true;
+        }
+        if (value_type != info.value_type || size != info.shadow_size) {
+            if (!info.type_mismatch_logged) LOG_ERROR("[SHADER] Uniform `{}` of program {} has GL type {}, dropped a {} byte value of GL type {}", info.name, program.id, (uint32_t)info.type, size, (uint32_t)value_type);
+            info.type_mismatch_logged = true;
+            return false;
+        }
+
+        unsigned char* shadow = &program.shadow_values[info.shadow_offset];
+
+        if (info.shadow_valid && memcmp(shadow, value, size) == 0) return false;
+
+        memcpy(shadow, value, size);
+        info.shadow_valid = true;
+        PROFILE_COUNT(PROFILE_COUNTER_UNIFORM_UPLOADS, 1);
+        return true;
+    }
+
+    void set_uniform(ShaderProgram& program, UniformHandle handle, GLint value)
+    {
+        if (handle == INVALID_UNIFORM_HANDLE) return;
+        if (!update_shadow(program, handle, &value, sizeof(value), GL_INT)) return;
+        glUniform1i(program.uniforms[handle].location, value);
+    }
+
+    void set_uniform(ShaderProgram& program, UniformHandle handle, float value)
+    {
+        if (handle == INVALID_UNIFORM_HANDLE) return;
+        if (!update_shadow(program, handle, &value, sizeof(value), GL_FLOAT)) return;
+        glUniform1f(program.uniforms[handle].location, value);
+    }
+
+    void set_uniform(ShaderProgram& program, UniformHandle handle, const glm::vec2& value)
+    {
+        if (handle == INVALID_UNIFORM_HANDLE) return;
+        if (!update_shadow(program, handle, &value[0], sizeof(value), GL_FLOAT_VEC2)) return;
+        glUniform2fv(program.uniforms[handle].location, 1, &value[0]);
+    }
+
+    void set_uniform(ShaderProgram& program, UniformHandle handle, const glm::vec3& value)
+    {
+        if (handle == INVALID_UNIFORM_HANDLE) return;
+        if (!update_shadow(program, handle, &value[0], sizeof(value), GL_FLOAT_VEC3)) return;
+        glUniform3fv(program.uniforms[handle].location, 1, &value[0]);
+    }
+
+    void set_uniform(ShaderProgram& program, UniformHandle handle, const glm::vec4& value)
+    {
+        if (handle == INVALID_UNIFORM_HANDLE) return;
+        if (!update_shadow(program, handle, &value[0], sizeof(value), GL_FLOAT_VEC4)) return;
+        glUniform4fv(program.uniforms[handle].location, 1, &value[0]);
+    }
+
+    void set_uniform(ShaderProgram& program, UniformHandle handle, const glm::ivec2& value)
+    {
+        if (handle == INVALID_UNIFORM_HANDLE) return;
+        if (!update_shadow(program, handle, &value[0], sizeof(value), GL_INT_VEC2)) return;
+        glUniform2iv(program.uniforms[handle].location, 1, &value[0]);
+    }
+
+    void set_uniform(ShaderProgram& program, UniformHandle handle, const glm::ivec3& value)
+    {
+        if (handle == INVALID_UNIFORM_HANDLE) return;
+        if (!update_shadow(program, handle, &value[0], sizeof(value), GL_INT_VEC3)) return;
+        glUniform3iv(program.uniforms[handle].location, 1, &value[0]);
+    }
+
+    void set_uniform(ShaderProgram& program, UniformHandle handle, const glm::ivec4& value)
+    {
+        if (handle == INVALID_UNIFORM_HANDLE) return;
+        if (!update_shadow(program, handle, &value[0], sizeof(value), GL_INT_VEC4)) return;
+        glUniform4iv(program.uniforms[handle].location, 1, &value[0]);
+    }
+
+    void set_uniform(ShaderProgram& program, UniformHandle handle, const glm::mat3& value)
+    {
+        if (handle == INVALID_UNIFORM_HANDLE) return;
+        if (!update_shadow(program, handle, &value[0][0], sizeof(value), GL_FLOAT_MAT3)) return;
+        glUniformMatrix3fv(program.uniforms[handle].location, 1, GL_FALSE, &value[0][0]);
+    }
+
+    void set_uniform(ShaderProgram& program, UniformHandle handle, const glm::mat4& value)
+    {
+        if (handle == INVALID_UNIFORM_HANDLE) return;
+        if (!update_shadow(program, handle, &value[0][0], sizeof(value), GL_FLOAT_MAT4)) return;
+        glUniformMatrix4fv(program.uniforms[handle].location, 1, GL_FALSE, &value[0][0]);
+    }
+}
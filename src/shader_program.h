@@ -0,0 +1,64 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "logging.h"
+#include "profiler.h"
+#include "shader_utils.h"
+#include "shader_cache.h"
+
+namespace Engine
+{
+    // Index into `ShaderProgram::uniforms`, resolved once after linking. -1 when the uniform is not active
+    typedef int UniformHandle;
+    #define INVALID_UNIFORM_HANDLE -1
+
+    struct UniformInfo {
+        std::string name;
+        GLint location = -1;
+        GLenum type = GL_NONE;
+        GLenum value_type = GL_NONE;  // What the setters have to upload, GL_NONE for unknown types which skip the shadow
+        uintmax_t shadow_offset = 0;  // Offset of the last uploaded value in `ShaderProgram::shadow_values`
+        uintmax_t shadow_size = 0;
+        bool shadow_valid = false;
+        bool type_mismatch_logged = false;  // Set uploads of the wrong type are dropped, reported once
+    };
+
+    struct ShaderProgram {
+        GLuint id = 0;
+        std::vector<UniformInfo> uniforms;
+        std::vector<unsigned char> shadow_values;
+        std::unordered_map<std::string, UniformHandle> uniform_lookup;
+    };
+
+    // Goes through `cache` when one is given
+    ShaderProgram create_shader_program(const char* vertex_shader_source, const char* fragment_shader_source, ProgramCache* cache = nullptr);
+    void reflect_uniforms(ShaderProgram& program);
+    void destroy_shader_program(ShaderProgram& program);
+
+    // Lookup is string based, call outside of the frame loop and keep the handle
+    UniformHandle get_uniform_handle(const ShaderProgram& program, const std::string& name);
+    // Same without the warning, for uniforms a program variant may have compiled out
+    UniformHandle find_uniform_handle(const ShaderProgram& program, const std::string& name);
+
+    // Setters expect `program` to be bound and skip the upload if the value did not change. A value whose type does not
+    // match the reflected one is dropped, the `GLint` setters also cover bool and sampler uniforms. Uniforms of types
+    // without a known layout are always uploaded
+    void set_uniform(ShaderProgram& program, UniformHandle handle, GLint value);
+    void set_uniform(ShaderProgram& program, UniformHandle handle, float value);
+    void set_uniform(ShaderProgram& program, UniformHandle handle, const glm::vec2& value);
+    void set_uniform(ShaderProgram& program, UniformHandle handle, const glm::vec3& value);
+    void set_uniform(ShaderProgram& program, UniformHandle handle, const glm::vec4& value);
+    void set_uniform(ShaderProgram& program, UniformHandle handle, const glm::ivec2& value);
+    void set_uniform(ShaderProgram& program, UniformHandle handle, const glm::ivec3& value);
+    void set_uniform(ShaderProgram& program, UniformHandle handle, const glm::ivec4& value);
+    void set_uniform(ShaderProgram& program, UniformHandle handle, const glm::mat3& value);
+    void set_uniform(ShaderProgram& program, UniformHandle handle, const glm::mat4& value);
+}
@@ -1,13 +1,28 @@
 #include "shader_utils.h"
 
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
 namespace Engine
 {
+    static bool s_parallel_shader_compile = false;
+
     GLuint create_generic_shader(const char* vertex_shader_source, const char* fragment_shader_source)
+    {
+        GLuint shader_program = glCreateProgram();
+        link_generic_shader(shader_program, vertex_shader_source, fragment_shader_source);
+        return shader_program;
+    }
+
+    bool link_generic_shader(GLuint shader_program, const char* vertex_shader_source, const char* fragment_shader_source)
     {
         if (strlen(vertex_shader_source) == 0) log_warning("[SHADER] Vertex shader source is empty!");
-        if (strlen(vertex_shader_source) == 0) log_warning("[SHADER] Fragment shader source is empty!");
+        if (strlen(fragment_shader_source) == 0) log_warning("[SHADER] Fragment shader source is empty!");
 
         int success;
+        bool linked = true;
         char info_log[512];
         
         GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
@@ -18,6 +33,7 @@ namespace Engine
         if (!success) {
             glGetShaderInfoLog(vertex_shader, 512, NULL, info_log);
             log_error("[SHADER] Failed to compile the vertex shader!\n" + (std::string)info_log);
+            linked = false;
         }
 
         GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
@@ -27,10 +43,10 @@ namespace Engine
         glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
         if (!success) {
             glGetShaderInfoLog(fragmentShader, 512, NULL, info_log);
-            log_error("[SHADER] Failed to compile the vertex shader!\n" + (std::string)info_log);
+            log_error("[SHADER] Failed to compile the fragment shader!\n" + (std::string)info_log);
+            linked = false;
         }
 
-        GLuint shader_program = glCreateProgram();
         glAttachShader(shader_program, vertex_shader);
         glAttachShader(shader_program, fragmentShader);
         glLinkProgram(shader_program);
@@ -39,11 +55,237 @@ namespace Engine
         if (!success) {
             glGetProgramInfoLog(shader_program, 512, NULL, info_log);
             log_error("[SHADER] Failed to link the vertex and fragment shaders!\n" + (std::string)info_log);
+            linked = false;
         }
 
+        glDetachShader(shader_program, vertex_shader);
+        glDetachShader(shader_program, fragmentShader);
         glDeleteShader(vertex_shader);
         glDeleteShader(fragmentShader);
 
+        return linked;
+    }
+
+    static GLuint start_shader_compile(GLenum type, const char* source)
+    {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, NULL);
+        glCompileShader(shader);
+        return shader;
+    }
+
+    GLuint start_generic_shader_link(const char* vertex_shader_source, const char* fragment_shader_source)
+    {
+        GLuint shader_program = glCreateProgram();
+        GLuint vertex_shader = start_shader_compile(GL_VERTEX_SHADER, vertex_shader_source);
+        GLuint fragment_shader = start_shader_compile(GL_FRAGMENT_SHADER, fragment_shader_source);
+
+        glAttachShader(shader_program, vertex_shader);
+        glAttachShader(shader_program, fragment_shader);
+        glLinkProgram(shader_program);
+
+        // Only flagged, they live on while attached so `finish_generic_shader_link` can read their logs
+        glDeleteShader(vertex_shader);
+        glDeleteShader(fragment_shader);
         return shader_program;
     }
-}
\ No newline at end of file
+
+    bool is_generic_shader_link_ready(GLuint shader_program, uintmax_t frames_waited)
+    {
+        if (!s_parallel_shader_compile) return frames_waited >= SHADER_LINK_FALLBACK_FRAMES;
+
+        GLint completed = GL_FALSE;
+        glGetProgramiv(shader_program, GL_COMPLETION_STATUS_KHR, &completed);
+        return completed == GL_TRUE;
+    }
+
+    bool finish_generic_shader_link(GLuint shader_program)
+    {
+        int success;
+        bool linked = true;
+        char info_log[512];
+
+        GLuint shaders[2] = { 0, 0 };
+        GLsizei shader_count = 0;
+        glGetAttachedShaders(shader_program, 2, &shader_count, shaders);
+        for (GLsizei i = 0; i < shader_count; i++) {
+            glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
+            if (!success) {
+                GLint type = 0;
+                glGetShaderiv(shaders[i], GL_SHADER_TYPE, &type);
+                glGetShaderInfoLog(shaders[i], 512, NULL, info_log);
+                log_error((type == GL_VERTEX_SHADER ? "[SHADER] Failed to compile the vertex shader!\n" : "[SHADER] Failed to compile the fragment shader!\n") + (std::string)info_log);
+                linked = false;
+            }
+        }
+
+        glGetProgramiv(shader_program, GL_LINK_STATUS, &success);
+        if (!success && linked) {
+            glGetProgramInfoLog(shader_program, 512, NULL, info_log);
+            log_error("[SHADER] Failed to link the vertex and fragment shaders!\n" + (std::string)info_log);
+        }
+        linked = linked && success;
+
+        for (GLsizei i = 0; i < shader_count; i++) glDetachShader(shader_program, shaders[i]);
+        return linked;
+    }
+
+    bool enable_parallel_shader_compile(GLADloadproc load_proc)
+    {
+        MaxShaderCompilerThreadsFunction max_shader_compiler_threads = nullptr;
+        if (load_proc && has_gl_extension("GL_KHR_parallel_shader_compile")) {
+            max_shader_compiler_threads = (MaxShaderCompilerThreadsFunction)load_proc("glMaxShaderCompilerThreadsKHR");
+        } else if (load_proc && has_gl_extension("GL_ARB_parallel_shader_compile")) {
+            max_shader_compiler_threads = (MaxShaderCompilerThreadsFunction)load_proc("glMaxShaderCompilerThreadsARB");
+        }
+
+        s_parallel_shader_compile = max_shader_compiler_threads != nullptr;
+        if (!s_parallel_shader_compile) {
+            log_info("[SHADER] Parallel shader compile is not supported, reloads query their link after " + std::to_string(SHADER_LINK_FALLBACK_FRAMES) + " frames");
+            return false;
+        }
+
+        max_shader_compiler_threads(0xFFFFFFFF);  // Driver's choice
+        log_info("[SHADER] Parallel shader compile enabled");
+        return true;
+    }
+
+    bool has_gl_extension(const char* name)
+    {
+        GLint extension_count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+        for (GLint i = 0; i < extension_count; i++) {
+            const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+            if (extension && strcmp(extension, name) == 0) return true;
+        }
+        return false;
+    }
+
+    uint64_t hash_shader_bytes(uint64_t hash, const void* data, uintmax_t size)
+    {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (uintmax_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+    static std::string normalize_shader_path(const std::string& path)
+    {
+        return std::filesystem::path(path).lexically_normal().generic_string();
+    }
+
+    // Windows checkouts may carry `\r\n`, folded so the hash does not depend on it
+    static std::string normalize_line_endings(const std::string& source)
+    {
+        std::string normalized;
+        normalized.reserve(source.size());
+        for (char c : source) {
+            if (c != '\r') normalized += c;
+        }
+        return normalized;
+    }
+
+    void add_generated_shader_file(ShaderPreprocessor& preprocessor, const std::string& name, const std::string& source)
+    {
+        preprocessor.generated_files[name] = normalize_line_endings(source);
+    }
+
+    void update_shader_file(ShaderPreprocessor& preprocessor, const std::string& path, const std::string& source)
+    {
+        preprocessor.files[normalize_shader_path(path)] = normalize_line_endings(source);
+    }
+
+    // nullptr if the file can not be read
+    static const std::string* load_shader_file(ShaderPreprocessor& preprocessor, const std::string& path)
+    {
+        auto it = preprocessor.files.find(path);
+        if (it != preprocessor.files.end()) return &it->second;
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return nullptr;
+
+        std::stringstream stream;
+        stream << file.rdbuf();
+        preprocessor.read_count++;
+        return &(preprocessor.files[path] = normalize_line_endings(stream.str()));
+    }
+
+    // Returns the quoted name of an `#include "name"` line, empty for any other line
+    static std::string get_include_name(const std::string& line)
+    {
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line.compare(start, 8, "#include") != 0) return "";
+
+        size_t open = line.find('"', start + 8);
+        size_t close = (open == std::string::npos) ? std::string::npos : line.find('"', open + 1);
+        if (close == std::string::npos) return "";
+        return line.substr(open + 1, close - open - 1);
+    }
+
+    static bool append_shader_file(ShaderPreprocessor& preprocessor, PreprocessedShader& shader, const std::string& path, const std::string& source)
+    {
+        uintmax_t file_index = shader.files.size();
+        shader.files.push_back(path);
+        if (file_index > 0) shader.source += "#line 1 " + std::to_string(file_index) + "\n";
+
+        uintmax_t line_number = 0;
+        for (size_t line_start = 0; line_start < source.size();) {
+            size_t line_end = source.find('\n', line_start);
+            if (line_end == std::string::npos) line_end = source.size();
+            std::string line = source.substr(line_start, line_end - line_start);
+            line_start = line_end + 1;
+            line_number++;
+
+            std::string include_name = get_include_name(line);
+            if (include_name.empty()) {
+                shader.source += line;
+                shader.source += '\n';
+                continue;
+            }
+
+            std::string include_path;
+            const std::string* include_source = nullptr;
+            auto generated = preprocessor.generated_files.find(include_name);
+            if (generated != preprocessor.generated_files.end()) {
+                include_path = include_name;
+                include_source = &generated->second;
+            } else {
+                include_path = normalize_shader_path((std::filesystem::path(path).parent_path() / include_name).string());
+                include_source = load_shader_file(preprocessor, include_path);
+            }
+            if (!include_source) {
+                log_error("[SHADER] `" + path + "` line " + std::to_string(line_number) + ": failed to include `" + include_name + "`");
+                return false;
+            }
+
+            // Already pasted, the empty line keeps the numbering
+            bool included = false;
+            for (const std::string& file : shader.files) included = included || file == include_path;
+            if (included) {
+                shader.source += '\n';
+                continue;
+            }
+
+            if (!append_shader_file(preprocessor, shader, include_path, *include_source)) return false;
+            shader.source += "#line " + std::to_string(line_number + 1) + " " + std::to_string(file_index) + "\n";
+        }
+        return true;
+    }
+
+    PreprocessedShader preprocess_shader(ShaderPreprocessor& preprocessor, const std::string& path)
+    {
+        PreprocessedShader shader;
+        std::string normalized_path = normalize_shader_path(path);
+        const std::string* source = load_shader_file(preprocessor, normalized_path);
+        if (!source) {
+            log_error("[SHADER] Failed to open `" + path + "`");
+            return shader;
+        }
+
+        shader.valid = append_shader_file(preprocessor, shader, normalized_path, *source);
+        shader.hash = hash_shader_bytes(SHADER_HASH_SEED, shader.source.data(), shader.source.size());
+        return shader;
+    }
+}
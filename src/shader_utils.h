@@ -1,8 +1,74 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
 #include <glad/glad.h>
 
 #include "logging.h"
 
+// KHR_parallel_shader_compile, GLAD only loads 3.3 core
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Without the extension a background link is only queried after this many frames. Drivers that compile on their own
+// thread are usually done by then, the rest stall on the query
+#define SHADER_LINK_FALLBACK_FRAMES 2
+
+// FNV-1a offset basis, the start value for `hash_shader_bytes`
+#define SHADER_HASH_SEED 0xCBF29CE484222325ull
+
 namespace Engine
 {
+    typedef void (APIENTRYP MaxShaderCompilerThreadsFunction)(GLuint count);
+
     GLuint create_generic_shader(const char* vertexShaderSource, const char* fragmentShaderSource);
-}
\ No newline at end of file
+
+    // Compiles both stages and links them into `shader_program`, so program parameters can be set before linking.
+    // Returns false if compiling or linking failed
+    bool link_generic_shader(GLuint shader_program, const char* vertex_shader_source, const char* fragment_shader_source);
+
+    // Compiles and links without querying anything, so the calls return before the driver is done
+    GLuint start_generic_shader_link(const char* vertex_shader_source, const char* fragment_shader_source);
+    // True once querying the link no longer stalls, `frames_waited` is the fallback without the extension
+    bool is_generic_shader_link_ready(GLuint shader_program, uintmax_t frames_waited);
+    // Logs compile and link errors and releases the stages. Returns false if the program is unusable
+    bool finish_generic_shader_link(GLuint shader_program);
+
+    // Lets the driver compile on its own threads when it has KHR_parallel_shader_compile (or the ARB version).
+    // Returns false if background links have to fall back to waiting frames
+    bool enable_parallel_shader_compile(GLADloadproc load_proc);
+
+    // Looks through the GL_EXTENSIONS list of the current context
+    bool has_gl_extension(const char* name);
+
+    // FNV-1a, continuing from `hash`. Stable across runs and platforms
+    uint64_t hash_shader_bytes(uint64_t hash, const void* data, uintmax_t size);
+
+    // Loaded shader files shared by every program that includes them, so a header is read once per run
+    struct ShaderPreprocessor {
+        std::unordered_map<std::string, std::string> files;  // Normalised path to source, `\r\n` already folded
+        std::unordered_map<std::string, std::string> generated_files;  // Include name to source, built from C++
+        uintmax_t read_count = 0;
+    };
+
+    struct PreprocessedShader {
+        std::string source;
+        uint64_t hash = 0;  // Of `source`, equal hashes compile to the same shader
+        std::vector<std::string> files;  // Index is the source string number `#line` reports errors with, 0 is the top file
+        bool valid = false;
+    };
+
+    // `#include "name"` resolves here before the file system
+    void add_generated_shader_file(ShaderPreprocessor& preprocessor, const std::string& name, const std::string& source);
+    // Replaces the loaded copy, for hot reload
+    void update_shader_file(ShaderPreprocessor& preprocessor, const std::string& path, const std::string& source);
+
+    // Pastes `#include "file"` lines in, relative to the including file. A file is pasted once per shader, so headers
+    // need no guards. Logs and returns an invalid result if a file is missing
+    PreprocessedShader preprocess_shader(ShaderPreprocessor& preprocessor, const std::string& path);
+}
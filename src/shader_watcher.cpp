@@ -0,0 +1,162 @@
+#include "shader_watcher.h"
+
+#include <chrono>
+#include <filesystem>
+#include <set>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace Engine
+{
+    static bool is_shader_file(const std::string& name)
+    {
+        std::string extension = std::filesystem::path(name).extension().string();
+        return extension == ".vs" || extension == ".fs" || extension == ".glsl";
+    }
+
+    // Reads every file in `names`, preprocesses the entry points with them and hands the results to the main thread
+    // together. Includes make any file a possible dependency, the main thread tells from the hashes what changed
+    static void publish_shader_changes(ShaderWatcher& watcher, std::set<std::string>& names)
+    {
+        bool changed = false;
+        for (const std::string& name : names) {
+            std::string path = watcher.directory + "/" + name;
+            std::string source = read_text_file(path);
+            if (source.empty()) continue;  // Deleted, or caught between truncate and write
+            update_shader_file(watcher.preprocessor, path, source);
+            changed = true;
+        }
+        names.clear();
+        if (!changed) return;
+
+        std::vector<ShaderSourceUpdate> updates;
+        for (const std::string& shader_path : watcher.shader_paths) {
+            ShaderSourceUpdate update;
+            update.path = shader_path;
+            update.shader = preprocess_shader(watcher.preprocessor, shader_path);
+            if (update.shader.valid) updates.push_back(std::move(update));
+        }
+        if (updates.empty()) return;
+
+        std::lock_guard<std::mutex> lock(watcher.mutex);
+        for (ShaderSourceUpdate& update : updates) watcher.updates.push_back(std::move(update));
+    }
+
+#ifdef __linux__
+    static void run_shader_watcher(ShaderWatcher& watcher, int inotify_fd)
+    {
+        std::set<std::string> changed_names;
+        auto last_event_time = std::chrono::steady_clock::now();
+        alignas(struct inotify_event) char buffer[4096];
+
+        while (!watcher.stopping.load(std::memory_order_acquire)) {
+            pollfd descriptor = { inotify_fd, POLLIN, 0 };
+            int ready = poll(&descriptor, 1, changed_names.empty() ? 100 : SHADER_WATCHER_DEBOUNCE_MS);
+            if (ready > 0) {
+                ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+                for (ssize_t offset = 0; offset < length;) {
+                    const inotify_event* event = (const inotify_event*)(buffer + offset);
+                    if (event->len > 0 && is_shader_file(event->name)) changed_names.insert(event->name);
+                    offset += sizeof(inotify_event) + event->len;
+                }
+                last_event_time = std::chrono::steady_clock::now();
+                continue;
+            }
+
+            auto quiet_time = std::chrono::steady_clock::now() - last_event_time;
+            if (!changed_names.empty() && quiet_time >= std::chrono::milliseconds(SHADER_WATCHER_DEBOUNCE_MS)) {
+                publish_shader_changes(watcher, changed_names);
+            }
+        }
+        close(inotify_fd);
+    }
+#else
+    static void run_shader_watcher(ShaderWatcher& watcher)
+    {
+        std::unordered_map<std::string, std::filesystem::file_time_type> write_times;
+        std::set<std::string> changed_names;
+        bool first_scan = true;
+
+        while (!watcher.stopping.load(std::memory_order_acquire)) {
+            std::error_code error;
+            for (const auto& entry : std::filesystem::directory_iterator(watcher.directory, error)) {
+                std::string name = entry.path().filename().string();
+                if (!is_shader_file(name)) continue;
+
+                auto write_time = entry.last_write_time(error);
+                if (error) continue;
+
+                auto it = write_times.find(name);
+                if (it == write_times.end()) {
+                    write_times[name] = write_time;
+                    if (!first_scan) changed_names.insert(name);
+                } else if (it->second != write_time) {
+                    it->second = write_time;
+                    changed_names.insert(name);
+                }
+            }
+            first_scan = false;
+
+            // The poll interval doubles as the debounce
+            if (!changed_names.empty()) publish_shader_changes(watcher, changed_names);
+            std::this_thread::sleep_for(std::chrono::milliseconds(SHADER_WATCHER_POLL_MS));
+        }
+    }
+#endif
+
+    bool start_shader_watcher(ShaderWatcher& watcher, const std::string& directory, const ShaderPreprocessor& preprocessor, const std::vector<std::string>& shader_paths)
+    {
+        watcher.directory = directory;
+        watcher.preprocessor = preprocessor;
+        watcher.shader_paths = shader_paths;
+        watcher.stopping.store(false, std::memory_order_relaxed);
+
+#ifdef __linux__
+        int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd < 0) {
+            log_warning("[SHADER] inotify is unavailable, shaders will not reload");
+            return false;
+        }
+        // Editors that save through a temporary file and rename show up as IN_MOVED_TO
+        if (inotify_add_watch(inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            log_warning("[SHADER] Failed to watch `" + directory + "`, shaders will not reload");
+            close(inotify_fd);
+            return false;
+        }
+        watcher.thread = std::thread(run_shader_watcher, std::ref(watcher), inotify_fd);
+#else
+        if (!std::filesystem::is_directory(directory)) {
+            log_warning("[SHADER] Failed to watch `" + directory + "`, shaders will not reload");
+            return false;
+        }
+        watcher.thread = std::thread(run_shader_watcher, std::ref(watcher));
+#endif
+
+        log_info("[SHADER] Watching `" + directory + "` for changes");
+        return true;
+    }
+
+    void stop_shader_watcher(ShaderWatcher& watcher)
+    {
+        if (!watcher.thread.joinable()) return;
+
+        watcher.stopping.store(true, std::memory_order_release);
+        watcher.thread.join();
+        watcher.updates.clear();
+    }
+
+    bool poll_shader_watcher(ShaderWatcher& watcher, std::vector<ShaderSourceUpdate>& updates)
+    {
+        std::unique_lock<std::mutex> lock(watcher.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || watcher.updates.empty()) return false;
+
+        updates.clear();
+        std::swap(updates, watcher.updates);
+        return true;
+    }
+}
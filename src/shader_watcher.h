@@ -0,0 +1,49 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logging.h"
+#include "file_utils.h"
+#include "shader_utils.h"
+
+// Quiet time after the last write before a file is read, editors often save in several steps
+#define SHADER_WATCHER_DEBOUNCE_MS 50
+// How often the portable fallback compares modification times
+#define SHADER_WATCHER_POLL_MS 250
+
+namespace Engine
+{
+    // An entry point preprocessed again after a change, `path` as it was passed to `start_shader_watcher`
+    struct ShaderSourceUpdate {
+        std::string path;
+        PreprocessedShader shader;
+    };
+
+    // Watches one directory on a background thread, which also reads the changed files and any new includes and
+    // preprocesses the entry points again, so the frame never touches the disk. inotify on Linux, modification time
+    // polling elsewhere
+    struct ShaderWatcher {
+        std::string directory;
+        ShaderPreprocessor preprocessor;  // The watcher thread's own copy
+        std::vector<std::string> shader_paths;  // Entry points, every change preprocesses all of them
+        std::thread thread;
+        std::atomic<bool> stopping{ false };
+
+        std::mutex mutex;
+        std::vector<ShaderSourceUpdate> updates;  // Guarded by `mutex`, oldest first
+    };
+
+    // Starts from a copy of `preprocessor`, so files the programs were built from are not read again
+    bool start_shader_watcher(ShaderWatcher& watcher, const std::string& directory, const ShaderPreprocessor& preprocessor, const std::vector<std::string>& shader_paths);
+    void stop_shader_watcher(ShaderWatcher& watcher);
+
+    // Moves the pending updates into `updates`. Never blocks, returns false if there are none or the watcher thread
+    // holds the lock this frame
+    bool poll_shader_watcher(ShaderWatcher& watcher, std::vector<ShaderSourceUpdate>& updates);
+}
@@ -0,0 +1,210 @@
+#include "sprite_batch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace Engine
+{
+    void create_sprite_batch(SpriteBatch& batch, uintmax_t max_sprite_count)
+    {
+        batch.max_sprite_count = max_sprite_count;
+        batch.sprites.reserve(max_sprite_count);
+        batch.sprite_programs.reserve(max_sprite_count);
+        batch.sort_keys.reserve(max_sprite_count);
+        batch.sort_scratch.reserve(max_sprite_count);
+
+        glGenVertexArrays(1, &batch.VAO);
+        glGenBuffers(1, &batch.VBO);
+        glGenBuffers(1, &batch.EBO);
+
+        glBindVertexArray(batch.VAO);
+
+        // One segment per in-flight frame
+        glBindBuffer(GL_ARRAY_BUFFER, batch.VBO);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(SPRITE_BATCH_FRAME_COUNT * max_sprite_count * 4 * sizeof(SpriteVertex)), NULL, GL_STREAM_DRAW);
+
+        // Shared by every segment through the base vertex
+        std::vector<GLuint> indices(max_sprite_count * 6);
+        for (uintmax_t i = 0; i < max_sprite_count; i++) {
+            GLuint vertex = (GLuint)(i * 4);
+            GLuint* sprite_indices = &indices[i * 6];
+            sprite_indices[0] = vertex + 0; sprite_indices[1] = vertex + 1; sprite_indices[2] = vertex + 3;
+            sprite_indices[3] = vertex + 1; sprite_indices[4] = vertex + 2; sprite_indices[5] = vertex + 3;
+        }
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch.EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(indices.size() * sizeof(GLuint)), indices.data(), GL_STATIC_DRAW);
+
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, position));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, UV));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, material_layer));
+        glEnableVertexAttribArray(2);
+
+        glBindVertexArray(0);
+    }
+
+    void destroy_sprite_batch(SpriteBatch& batch)
+    {
+        for (GLsync& fence : batch.segment_fences) {
+            if (fence) glDeleteSync(fence);
+        }
+
+        glDeleteVertexArrays(1, &batch.VAO);
+        glDeleteBuffers(1, &batch.VBO);
+        glDeleteBuffers(1, &batch.EBO);
+        batch = SpriteBatch();
+    }
+
+    void begin_sprite_batch(SpriteBatch& batch)
+    {
+        batch.sprites.clear();
+        batch.sprite_programs.clear();
+        batch.sort_keys.clear();
+        batch.draw_runs.clear();
+
+        // Only stalls if the GPU is more than `SPRITE_BATCH_FRAME_COUNT` frames behind
+        GLsync& fence = batch.segment_fences[batch.segment];
+        if (fence) {
+            while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+            glDeleteSync(fence);
+            fence = 0;
+        }
+    }
+
+    void submit_sprite(SpriteBatch& batch, const Sprite& sprite, GLuint program)
+    {
+        if (batch.sprites.size() >= batch.max_sprite_count) return;
+
+        uint64_t submission_index = (uint64_t)batch.sprites.size();
+        uint64_t material_key = (uint64_t)std::max(sprite.material_layer, 0.0f) & 0xFFFF;
+        batch.sort_keys.push_back(((uint64_t)(program & 0xFFFF) << 48) | (material_key << 32) | submission_index);
+        batch.sprites.push_back(sprite);
+        batch.sprite_programs.push_back(program);
+    }
+
+    void get_sprite_bounds(const Sprite& sprite, glm::vec2& min, glm::vec2& max)
+    {
+        float cos_rotation = std::fabs(cosf(sprite.rotation));
+        float sin_rotation = std::fabs(sinf(sprite.rotation));
+        glm::vec2 center = sprite.position + sprite.size * 0.5f;
+        glm::vec2 half_extent = glm::vec2(
+            sprite.size.x * cos_rotation + sprite.size.y * sin_rotation,
+            sprite.size.x * sin_rotation + sprite.size.y * cos_rotation
+        ) * 0.5f;
+
+        min = center - half_extent;
+        max = center + half_extent;
+    }
+
+    static inline void write_sprite_vertices(const Sprite& sprite, SpriteVertex* vertices)
+    {
+        static const float corners[4][2] = { { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f }, { 0.0f, 0.0f } };  // Same winding as the static quad
+
+        float cos_rotation = cosf(sprite.rotation);
+        float sin_rotation = sinf(sprite.rotation);
+        glm::vec2 center = sprite.position + sprite.size * 0.5f;
+
+        for (int i = 0; i < 4; i++) {
+            float local_x = (corners[i][0] - 0.5f) * sprite.size.x;
+            float local_y = (corners[i][1] - 0.5f) * sprite.size.y;
+
+            vertices[i].position[0] = center.x + local_x * cos_rotation - local_y * sin_rotation;
+            vertices[i].position[1] = center.y + local_x * sin_rotation + local_y * cos_rotation;
+            vertices[i].UV[0] = sprite.uv_rect.x + (sprite.uv_rect.z - sprite.uv_rect.x) * corners[i][0];
+            vertices[i].UV[1] = sprite.uv_rect.y + (sprite.uv_rect.w - sprite.uv_rect.y) * corners[i][1];
+            vertices[i].material_layer = sprite.material_layer;
+        }
+    }
+
+    // One sorted chunk per job thread, then pairwise merges between `sort_keys` and `sort_scratch` until one run is left
+    static void sort_sprite_keys(SpriteBatch& batch, JobSystem& jobs)
+    {
+        uintmax_t key_count = batch.sort_keys.size();
+        uintmax_t chunk_count = get_job_thread_count(jobs);
+        if (key_count < SPRITE_BATCH_PARALLEL_THRESHOLD || chunk_count <= 1) {
+            std::sort(batch.sort_keys.begin(), batch.sort_keys.end());
+            return;
+        }
+
+        uintmax_t chunk_size = (key_count + chunk_count - 1) / chunk_count;
+        uint64_t* keys = batch.sort_keys.data();
+        parallel_for(jobs, key_count, chunk_size, [keys](uintmax_t begin, uintmax_t end) {
+            std::sort(keys + begin, keys + end);
+        });
+
+        batch.sort_scratch.resize(key_count);
+        uint64_t* source = batch.sort_keys.data();
+        uint64_t* target = batch.sort_scratch.data();
+        for (uintmax_t run_size = chunk_size; run_size < key_count; run_size *= 2) {
+            uintmax_t pair_count = (key_count + run_size * 2 - 1) / (run_size * 2);
+            parallel_for(jobs, pair_count, 1, [source, target, run_size, key_count](uintmax_t pair_begin, uintmax_t pair_end) {
+                for (uintmax_t pair = pair_begin; pair < pair_end; pair++) {
+                    uintmax_t begin = pair * run_size * 2;
+                    uintmax_t middle = std::min(begin + run_size, key_count);
+                    uintmax_t end = std::min(begin + run_size * 2, key_count);
+                    std::merge(source + begin, source + middle, source + middle, source + end, target + begin);
+                }
+            });
+            std::swap(source, target);
+        }
+        if (source != batch.sort_keys.data()) batch.sort_keys.swap(batch.sort_scratch);
+    }
+
+    const std::vector<SpriteDrawRun>& flush_sprite_batch(SpriteBatch& batch, JobSystem& jobs)
+    {
+        PROFILE_ZONE("Sprite batch flush");
+        sort_sprite_keys(batch, jobs);
+
+        uintmax_t sprite_count = batch.sort_keys.size();
+        if (sprite_count == 0) return batch.draw_runs;
+
+        // Unsynchronized is safe, `begin_sprite_batch` already waited on this segment's fence
+        GLintptr segment_offset = (GLintptr)(batch.segment * batch.max_sprite_count * 4 * sizeof(SpriteVertex));
+        glBindBuffer(GL_ARRAY_BUFFER, batch.VBO);
+        SpriteVertex* vertices = (SpriteVertex*)glMapBufferRange(GL_ARRAY_BUFFER, segment_offset, (GLsizeiptr)(sprite_count * 4 * sizeof(SpriteVertex)),
+            GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        if (!vertices) {
+            LOG_ERROR("[SPRITE] Failed to map the streaming vertex buffer");
+            return batch.draw_runs;
+        }
+
+        // Disjoint ranges of the mapping per batch, only the GL calls have to stay on this thread
+        uintmax_t vertex_batch_size = (sprite_count < SPRITE_BATCH_PARALLEL_THRESHOLD) ? sprite_count : SPRITE_BATCH_PARALLEL_THRESHOLD / 4;
+        parallel_for(jobs, sprite_count, vertex_batch_size, [&batch, vertices](uintmax_t begin, uintmax_t end) {
+            for (uintmax_t i = begin; i < end; i++) {
+                write_sprite_vertices(batch.sprites[(uintmax_t)(batch.sort_keys[i] & 0xFFFFFFFF)], &vertices[i * 4]);
+            }
+        });
+
+        for (uintmax_t i = 0; i < sprite_count; i++) {
+            GLuint program = batch.sprite_programs[(uintmax_t)(batch.sort_keys[i] & 0xFFFFFFFF)];
+            if (batch.draw_runs.empty() || batch.draw_runs.back().program != program) {
+                batch.draw_runs.push_back(SpriteDrawRun{ program, i, 0 });
+            }
+            batch.draw_runs.back().sprite_count++;
+        }
+
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+
+        return batch.draw_runs;
+    }
+
+    void draw_sprite_run(const SpriteBatch& batch, const SpriteDrawRun& run)
+    {
+        GLint base_vertex = (GLint)(batch.segment * batch.max_sprite_count * 4);
+
+        glBindVertexArray(batch.VAO);
+        glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)(run.sprite_count * 6), GL_UNSIGNED_INT, (void*)(run.first_sprite * 6 * sizeof(GLuint)), base_vertex);
+        PROFILE_COUNT(PROFILE_COUNTER_DRAW_CALLS, 1);
+    }
+
+    void end_sprite_batch(SpriteBatch& batch)
+    {
+        if (!batch.sprites.empty()) {
+            batch.segment_fences[batch.segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        batch.segment = (batch.segment + 1) % SPRITE_BATCH_FRAME_COUNT;
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "logging.h"
+#include "job_system.h"
+#include "profiler.h"
+
+// Frames the GPU may lag behind, each owns one segment of the streaming vertex buffer
+#define SPRITE_BATCH_FRAME_COUNT 3
+
+// Below this sprite count sorting and vertex expansion stay on the calling thread
+#define SPRITE_BATCH_PARALLEL_THRESHOLD 16384
+
+namespace Engine
+{
+    struct Sprite {
+        glm::vec2 position = glm::vec2(0.0f);  // Top left corner
+        glm::vec2 size = glm::vec2(1.0f);
+        float rotation = 0.0f;                 // Radians, around the sprite center
+        glm::vec4 uv_rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+        float material_layer = 0.0f;           // Layer in the `MaterialAtlas`
+    };
+
+    // Matches `sprite_batch.vs`
+    struct SpriteVertex {
+        float position[2];
+        float UV[2];
+        float material_layer;
+    };
+
+    // Contiguous sprites sharing a program after sorting, drawn with a single call
+    struct SpriteDrawRun {
+        GLuint program;
+        uintmax_t first_sprite;
+        uintmax_t sprite_count;
+    };
+
+    struct SpriteBatch {
+        uintmax_t max_sprite_count = 0;  // Per frame
+        GLuint VAO = 0;
+        GLuint VBO = 0;
+        GLuint EBO = 0;
+
+        GLsync segment_fences[SPRITE_BATCH_FRAME_COUNT] = {};
+        uintmax_t segment = 0;
+
+        std::vector<Sprite> sprites;
+        std::vector<GLuint> sprite_programs;
+        std::vector<uint64_t> sort_keys;  // (program, material, submission index)
+        std::vector<uint64_t> sort_scratch;  // Merge target for the parallel sort
+        std::vector<SpriteDrawRun> draw_runs;
+    };
+
+    void create_sprite_batch(SpriteBatch& batch, uintmax_t max_sprite_count);
+    void destroy_sprite_batch(SpriteBatch& batch);
+
+    // Per frame: begin, submit, flush, draw every run, end
+    void begin_sprite_batch(SpriteBatch& batch);
+    void submit_sprite(SpriteBatch& batch, const Sprite& sprite, GLuint program);
+
+    // Axis aligned bounds of the rotated sprite
+    void get_sprite_bounds(const Sprite& sprite, glm::vec2& min, glm::vec2& max);
+
+    // Sorts by program then material and streams the vertices into this frame's segment
+    const std::vector<SpriteDrawRun>& flush_sprite_batch(SpriteBatch& batch, JobSystem& jobs);
+
+    // Expects `run.program` to be bound with its uniforms set
+    void draw_sprite_run(const SpriteBatch& batch, const SpriteDrawRun& run);
+
+    // Fences the segment so it is not overwritten while the GPU still reads it
+    void end_sprite_batch(SpriteBatch& batch);
+}
@@ -0,0 +1,248 @@
+#include "texture_loader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <SDL2/SDL.h>
+#include <stb/stb_image.h>
+
+namespace Engine
+{
+    static int get_format_channel_count(GLenum texture_format)
+    {
+        switch (texture_format) {
+            case GL_RED:  return 1;
+            case GL_RG:   return 2;
+            case GL_RGB:  return 3;
+            default:      return 4;
+        }
+    }
+
+    static void decode_texture_job(void* data)
+    {
+        PROFILE_ZONE("Texture decode");
+        DecodedTexture* decoded = (DecodedTexture*)data;
+        TextureLoader* loader = decoded->loader;
+
+        int file_channel_count;
+        stbi_set_flip_vertically_on_load_thread(true);
+        decoded->data = stbi_load(decoded->path.c_str(), &decoded->width, &decoded->height, &file_channel_count, decoded->channel_count);
+
+        // Lock-free push
+        decoded->next = loader->completed.load(std::memory_order_relaxed);
+        while (!loader->completed.compare_exchange_weak(decoded->next, decoded, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    void start_texture_loader(TextureLoader& loader, JobSystem& jobs)
+    {
+        log_debug("[TEXTURE] Starting loader on " + std::to_string(get_job_thread_count(jobs)) + " job threads");
+
+        loader.jobs = &jobs;
+        glGenBuffers(TEXTURE_LOADER_PBO_COUNT, loader.pixel_buffers);
+    }
+
+    void stop_texture_loader(TextureLoader& loader)
+    {
+        // Decodes already started cannot be cancelled
+        if (loader.jobs) wait_for_counter(*loader.jobs, loader.decode_counter);
+
+        DecodedTexture* decoded = loader.completed.exchange(nullptr, std::memory_order_acquire);
+        while (decoded) {
+            DecodedTexture* next = decoded->next;
+            stbi_image_free(decoded->data);
+            delete decoded;
+            decoded = next;
+        }
+
+        glDeleteBuffers(TEXTURE_LOADER_PBO_COUNT, loader.pixel_buffers);
+
+        for (TextureRequest& request : loader.requests) {
+            stbi_image_free(request.image_data);
+            request.image_data = nullptr;
+        }
+    }
+
+    static TextureHandle queue_request(TextureLoader& loader, const TextureRequest& request)
+    {
+        if (loader.pending_count == 0) loader.batch_start_counter = SDL_GetPerformanceCounter();
+
+        TextureHandle handle = (TextureHandle)loader.requests.size();
+        loader.requests.push_back(request);
+        loader.pending_count++;
+
+        DecodedTexture* decoded = new DecodedTexture();
+        decoded->loader = &loader;
+        decoded->handle = handle;
+        decoded->path = request.path;
+        decoded->data = nullptr;
+        decoded->channel_count = get_format_channel_count(request.texture_format);
+        submit_job(*loader.jobs, decode_texture_job, decoded, &loader.decode_counter);
+
+        return handle;
+    }
+
+    void attach_texture_pack(TextureLoader& loader, const TexturePack* pack, const std::string& pack_root)
+    {
+        loader.pack = pack;
+        loader.pack_root = pack_root;
+    }
+
+    TextureHandle request_texture(TextureLoader& loader, const char* path, GLint wrap_mode, GLint min_filter_mode, GLint mag_filter_mode, GLenum texture_format, GLint internal_format)
+    {
+        static const unsigned char placeholder_texel[4] = { 255, 255, 255, 255 };
+
+        TextureRequest request;
+        request.path = path;
+        request.wrap_mode = wrap_mode;
+        request.min_filter_mode = min_filter_mode;
+        request.mag_filter_mode = mag_filter_mode;
+        request.texture_format = texture_format;
+        request.internal_format = internal_format;
+
+        // Cooked textures only need the mapped mip chain handed to the driver. Entries that can not fill the requested
+        // format are decoded from the source file instead
+        const TexturePackEntry* pack_entry = nullptr;
+        if (loader.pack && request.path.compare(0, loader.pack_root.size(), loader.pack_root) == 0) {
+            pack_entry = find_texture_pack_entry(*loader.pack, request.path.substr(loader.pack_root.size()));
+        }
+        if (pack_entry) {
+            uint64_t start_counter = SDL_GetPerformanceCounter();
+            request.texture = load_packed_texture(*loader.pack, *pack_entry, wrap_mode, min_filter_mode, mag_filter_mode, internal_format, request.texture_info);
+            if (request.texture) {
+                request.ready = true;
+
+                double elapsed_ms = (double)(SDL_GetPerformanceCounter() - start_counter) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+                LOG_DEBUG("[TEXTURE] `{}` uploaded from pack in {} ms", request.path, elapsed_ms);
+
+                loader.requests.push_back(request);
+                return (TextureHandle)(loader.requests.size() - 1);
+            }
+        }
+
+        glGenTextures(1, &request.texture);
+        glBindTexture(GL_TEXTURE_2D, request.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_mode);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_mode);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);  // Placeholder has no mipmaps
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter_mode);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder_texel);
+
+        return queue_request(loader, request);
+    }
+
+    TextureHandle request_image(TextureLoader& loader, const char* path, int channel_count)
+    {
+        static const GLenum formats[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+
+        TextureRequest request;
+        request.path = path;
+        request.texture_format = formats[std::clamp(channel_count, 1, 4) - 1];
+        request.keep_image = true;
+
+        return queue_request(loader, request);
+    }
+
+    const unsigned char* get_image_data(const TextureLoader& loader, TextureHandle handle)
+    {
+        return loader.requests[handle].image_data;
+    }
+
+    void release_image(TextureLoader& loader, TextureHandle handle)
+    {
+        stbi_image_free(loader.requests[handle].image_data);
+        loader.requests[handle].image_data = nullptr;
+    }
+
+    static void upload_decoded_texture(TextureLoader& loader, const DecodedTexture& decoded)
+    {
+        TextureRequest& request = loader.requests[decoded.handle];
+        if (!decoded.data) {
+            LOG_ERROR("[TEXTURE] Could not load texture from `{}`!", request.path);
+            request.failed = true;
+            return;
+        }
+
+        if (request.keep_image) {
+            request.image_data = decoded.data;
+            request.texture_info.width = (uintmax_t)decoded.width;
+            request.texture_info.height = (uintmax_t)decoded.height;
+            request.ready = true;
+            return;
+        }
+
+        GLsizeiptr size = (GLsizeiptr)decoded.width * decoded.height * decoded.channel_count;
+
+        // Orphan and fill the staging buffer, `glTexImage2D` then sources from it without blocking on the copy
+        GLuint pixel_buffer = loader.pixel_buffers[loader.next_pixel_buffer];
+        loader.next_pixel_buffer = (loader.next_pixel_buffer + 1) % TEXTURE_LOADER_PBO_COUNT;
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+        void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (mapped) {
+            memcpy(mapped, decoded.data, (size_t)size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D, request.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, request.min_filter_mode);
+        if (mapped) {
+            glTexImage2D(GL_TEXTURE_2D, 0, request.internal_format, decoded.width, decoded.height, 0, request.texture_format, GL_UNSIGNED_BYTE, (void*)0);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (!mapped) {
+            glTexImage2D(GL_TEXTURE_2D, 0, request.internal_format, decoded.width, decoded.height, 0, request.texture_format, GL_UNSIGNED_BYTE, decoded.data);
+        }
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        request.texture_info.width = (uintmax_t)decoded.width;
+        request.texture_info.height = (uintmax_t)decoded.height;
+        request.ready = true;
+    }
+
+    void update_texture_loader(TextureLoader& loader, bool wait)
+    {
+        PROFILE_ZONE("Texture streaming");
+        while (loader.pending_count > 0) {
+            DecodedTexture* decoded = loader.completed.exchange(nullptr, std::memory_order_acquire);
+            if (!decoded) {
+                // With a single job thread nothing decodes unless this thread helps, so it waits even when asked not to
+                if (!wait && get_job_thread_count(*loader.jobs) > 1) return;
+
+                wait_for_counter(*loader.jobs, loader.decode_counter);
+                continue;
+            }
+
+            while (decoded) {
+                DecodedTexture* next = decoded->next;
+                upload_decoded_texture(loader, *decoded);
+                if (!loader.requests[decoded->handle].keep_image) stbi_image_free(decoded->data);
+                delete decoded;
+                decoded = next;
+                loader.pending_count--;
+            }
+
+            if (loader.pending_count == 0) {
+                double elapsed_ms = (double)(SDL_GetPerformanceCounter() - loader.batch_start_counter) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+                log_info("[TEXTURE] " + std::to_string(loader.requests.size()) + " textures ready after " + std::to_string(elapsed_ms) + " ms (" + std::to_string(get_job_thread_count(*loader.jobs)) + " job threads)");
+            }
+        }
+    }
+
+    GLuint get_texture(const TextureLoader& loader, TextureHandle handle)
+    {
+        return loader.requests[handle].texture;
+    }
+
+    const TextureInfo& get_texture_info(const TextureLoader& loader, TextureHandle handle)
+    {
+        return loader.requests[handle].texture_info;
+    }
+
+    bool is_texture_ready(const TextureLoader& loader, TextureHandle handle)
+    {
+        return loader.requests[handle].ready;
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "logging.h"
+#include "texture_utils.h"
+#include "texture_pack.h"
+#include "job_system.h"
+
+// Staging pixel unpack buffers used round-robin for uploads
+#define TEXTURE_LOADER_PBO_COUNT 2
+
+namespace Engine
+{
+    typedef uintmax_t TextureHandle;
+
+    struct TextureRequest {
+        std::string path;
+        GLint wrap_mode;
+        GLint min_filter_mode;
+        GLint mag_filter_mode;
+        GLenum texture_format;
+        GLint internal_format;
+
+        // Written by the GL thread only
+        GLuint texture = 0;
+        TextureInfo texture_info;
+        bool ready = false;
+        bool failed = false;
+
+        // Image requests keep the decoded texels on the CPU instead of uploading them
+        bool keep_image = false;
+        unsigned char* image_data = nullptr;
+    };
+
+    struct TextureLoader;
+
+    // One decode job, pushed onto the lock-free completion list once decoded
+    struct DecodedTexture {
+        TextureLoader* loader;
+        TextureHandle handle;
+        std::string path;
+        unsigned char* data;  // NULL if decoding failed
+        int width;
+        int height;
+        int channel_count;
+        DecodedTexture* next;
+    };
+
+    struct TextureLoader {
+        JobSystem* jobs = nullptr;
+        JobCounter decode_counter;  // Decode jobs not yet on the completion list
+
+        // Multi-producer (decode jobs), single-consumer (GL thread) stack
+        std::atomic<DecodedTexture*> completed{ nullptr };
+
+        // GL thread only, decode jobs carry their own copy of the path
+        std::deque<TextureRequest> requests;
+        uintmax_t pending_count = 0;  // GL thread only
+
+        GLuint pixel_buffers[TEXTURE_LOADER_PBO_COUNT] = {};
+        uintmax_t next_pixel_buffer = 0;
+
+        uint64_t batch_start_counter = 0;
+
+        // Optional cooked pack, requests under `pack_root` are served from it synchronously
+        const TexturePack* pack = nullptr;
+        std::string pack_root;
+    };
+
+    // Images are decoded as jobs on `jobs`, which must outlive the loader
+    void start_texture_loader(TextureLoader& loader, JobSystem& jobs);
+    void stop_texture_loader(TextureLoader& loader);
+
+    // `pack` must outlive the loader. A request for `pack_root + name` uses the pack entry `name` when present
+    void attach_texture_pack(TextureLoader& loader, const TexturePack* pack, const std::string& pack_root);
+
+    // Returns immediately, the texture holds a 1x1 white placeholder until `update_texture_loader` uploads it
+    TextureHandle request_texture(TextureLoader& loader, const char* path, GLint wrap_mode, GLint min_filter_mode, GLint mag_filter_mode, GLenum texture_format, GLint internal_format);
+
+    // Decode only, the texels stay available through `get_image_data` until `release_image`
+    TextureHandle request_image(TextureLoader& loader, const char* path, int channel_count);
+    const unsigned char* get_image_data(const TextureLoader& loader, TextureHandle handle);
+    void release_image(TextureLoader& loader, TextureHandle handle);
+
+    // GL thread only. Uploads every decoded texture, `wait` blocks until no request is pending
+    void update_texture_loader(TextureLoader& loader, bool wait = false);
+
+    GLuint get_texture(const TextureLoader& loader, TextureHandle handle);
+    const TextureInfo& get_texture_info(const TextureLoader& loader, TextureHandle handle);
+    bool is_texture_ready(const TextureLoader& loader, TextureHandle handle);
+}
@@ -0,0 +1,172 @@
+#include "texture_pack.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace Engine
+{
+    static bool map_file(TexturePack& pack, const char* path)
+    {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER file_size;
+        GetFileSizeEx(file, &file_size);
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping) {
+            CloseHandle(file);
+            return false;
+        }
+
+        pack.data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        pack.size = (uintmax_t)file_size.QuadPart;
+        pack.file_handle = file;
+        pack.mapping_handle = mapping;
+#else
+        int file = open(path, O_RDONLY);
+        if (file < 0) return false;
+
+        struct stat file_stat;
+        fstat(file, &file_stat);
+        void* mapping = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);  // The mapping keeps the file alive
+
+        pack.data = (mapping == MAP_FAILED) ? nullptr : (const unsigned char*)mapping;
+        pack.size = (uintmax_t)file_stat.st_size;
+#endif
+        return pack.data != nullptr;
+    }
+
+    static void unmap_file(TexturePack& pack)
+    {
+#ifdef _WIN32
+        if (pack.data) UnmapViewOfFile(pack.data);
+        if (pack.mapping_handle) CloseHandle((HANDLE)pack.mapping_handle);
+        if (pack.file_handle) CloseHandle((HANDLE)pack.file_handle);
+#else
+        if (pack.data) munmap((void*)pack.data, (size_t)pack.size);
+#endif
+    }
+
+    // Every mip has to hold exactly the tightly packed texels the uploads read and lie inside the mapping
+    static bool is_texture_pack_entry_valid(const TexturePackEntry& entry, uintmax_t pack_size)
+    {
+        if (entry.width == 0 || entry.height == 0) return false;
+        if (entry.mip_count < 1 || entry.mip_count > TEXTURE_PACK_MAX_MIP_COUNT || entry.channel_count < 1 || entry.channel_count > 4) return false;
+
+        for (uint32_t mip = 0; mip < entry.mip_count; mip++) {
+            uint64_t texel_count = (uint64_t)std::max(entry.width >> mip, 1u) * (uint64_t)std::max(entry.height >> mip, 1u);
+            if (texel_count > pack_size) return false;  // Also keeps the size below from overflowing
+
+            uint64_t mip_size = texel_count * entry.channel_count;
+            if (entry.mip_sizes[mip] != mip_size) return false;
+            if (mip_size > pack_size || entry.mip_offsets[mip] > pack_size - mip_size) return false;
+        }
+        return true;
+    }
+
+    bool open_texture_pack(TexturePack& pack, const char* path)
+    {
+        if (!map_file(pack, path)) {
+            close_texture_pack(pack);
+            return false;
+        }
+
+        pack.header = (const TexturePackHeader*)pack.data;
+        pack.entries = (const TexturePackEntry*)(pack.data + sizeof(TexturePackHeader));
+
+        // Validate everything `load_packed_texture` and `upload_packed_material` dereference later
+        bool valid = pack.size >= sizeof(TexturePackHeader) && pack.header->magic == TEXTURE_PACK_MAGIC && pack.header->version == TEXTURE_PACK_VERSION;
+        valid = valid && pack.size >= sizeof(TexturePackHeader) + (uintmax_t)pack.header->texture_count * sizeof(TexturePackEntry);
+        for (uint32_t i = 0; valid && i < pack.header->texture_count; i++) {
+            valid = is_texture_pack_entry_valid(pack.entries[i], pack.size);
+        }
+
+        if (!valid) {
+            log_error("[TEXTURE] `" + (std::string)path + "` is not a valid texture pack (version " + std::to_string(TEXTURE_PACK_VERSION) + ")");
+            close_texture_pack(pack);
+            return false;
+        }
+
+        log_debug("[TEXTURE] Mapped texture pack `" + (std::string)path + "` with " + std::to_string(pack.header->texture_count) + " textures");
+        return true;
+    }
+
+    void close_texture_pack(TexturePack& pack)
+    {
+        unmap_file(pack);
+        pack = TexturePack();
+    }
+
+    const TexturePackEntry* find_texture_pack_entry(const TexturePack& pack, const std::string& name)
+    {
+        if (!pack.header) return nullptr;
+
+        for (uint32_t i = 0; i < pack.header->texture_count; i++) {
+            if (strncmp(pack.entries[i].name, name.c_str(), TEXTURE_PACK_NAME_LENGTH) == 0) return &pack.entries[i];
+        }
+
+        return nullptr;
+    }
+
+    // Channels `internal_format` stores, 0 for formats a pack of 8 bit channels can not fill
+    static uint32_t get_internal_format_channel_count(GLint internal_format)
+    {
+        switch (internal_format) {
+            case GL_RED: case GL_R8: return 1;
+            case GL_RG: case GL_RG8: return 2;
+            case GL_RGB: case GL_RGB8: case GL_SRGB: case GL_SRGB8: return 3;
+            case GL_RGBA: case GL_RGBA8: case GL_SRGB_ALPHA: case GL_SRGB8_ALPHA8: return 4;
+            default: return 0;
+        }
+    }
+
+    GLuint load_packed_texture(const TexturePack& pack, const TexturePackEntry& entry, GLint wrap_mode, GLint min_filter_mode, GLint mag_filter_mode, GLint internal_format, TextureInfo& texture_info)
+    {
+        static const GLenum formats[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+        GLenum format = formats[entry.channel_count - 1];
+
+        // GL would fill the missing channels with 0 and 1, the decoded file expands grey into every channel instead
+        uint32_t channel_count = get_internal_format_channel_count(internal_format);
+        if (channel_count == 0 || channel_count > entry.channel_count) {
+            LOG_ERROR("[TEXTURE] `{}` was cooked with {} channels, it can not be uploaded as internal format {}", entry.name, entry.channel_count, internal_format);
+            return 0;
+        }
+
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_mode);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_mode);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter_mode);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag_filter_mode);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)entry.mip_count - 1);
+
+        // Mip chain is baked, no `glGenerateMipmap`
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (uint32_t mip = 0; mip < entry.mip_count; mip++) {
+            GLsizei width = (GLsizei)std::max(entry.width >> mip, 1u);
+            GLsizei height = (GLsizei)std::max(entry.height >> mip, 1u);
+            glTexImage2D(GL_TEXTURE_2D, (GLint)mip, internal_format, width, height, 0, format, GL_UNSIGNED_BYTE, pack.data + entry.mip_offsets[mip]);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        texture_info.width = (uintmax_t)entry.width;
+        texture_info.height = (uintmax_t)entry.height;
+
+        return texture;
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "typedefs.h"
+
+#include <string>
+
+#include <glad/glad.h>
+
+#include "logging.h"
+#include "texture_utils.h"
+#include "texture_pack_format.h"
+
+namespace Engine
+{
+    // Read-only memory mapping of a cooked texture pack
+    struct TexturePack {
+        const unsigned char* data = nullptr;
+        uintmax_t size = 0;
+        const TexturePackHeader* header = nullptr;
+        const TexturePackEntry* entries = nullptr;
+
+        void* file_handle = nullptr;  // Platform handles, see `texture_pack.cpp`
+        void* mapping_handle = nullptr;
+    };
+
+    bool open_texture_pack(TexturePack& pack, const char* path);
+    void close_texture_pack(TexturePack& pack);
+
+    const TexturePackEntry* find_texture_pack_entry(const TexturePack& pack, const std::string& name);
+
+    // Uploads every mip level straight from the mapping as `internal_format`. Returns 0 without creating a texture if
+    // the entry was cooked with fewer channels than the format stores, or the format is not a plain 8 bit one
+    GLuint load_packed_texture(const TexturePack& pack, const TexturePackEntry& entry, GLint wrap_mode, GLint min_filter_mode, GLint mag_filter_mode, GLint internal_format, TextureInfo& texture_info);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "typedefs.h"
+
+// On-disk layout of a cooked texture pack, shared by `tools/texture_cook.cpp` and the runtime loader.
+// [TexturePackHeader][TexturePackEntry * texture_count][payloads, each TEXTURE_PACK_ALIGNMENT aligned]
+
+#define TEXTURE_PACK_MAGIC 0x4B505854  // "TXPK"
+#define TEXTURE_PACK_VERSION 1
+#define TEXTURE_PACK_ALIGNMENT 64
+#define TEXTURE_PACK_NAME_LENGTH 64
+#define TEXTURE_PACK_MAX_MIP_COUNT 16
+
+// Files expected in a material directory. The cook tool adds the channel-packed surface texture as `MATERIAL_SURFACE_NAME`
+#define MATERIAL_DIFFUSE_NAME "diffuse.jpg"
+#define MATERIAL_NORMAL_NAME "normal.jpg"
+#define MATERIAL_AO_NAME "ao.jpg"
+#define MATERIAL_ROUGHNESS_NAME "roughness.jpg"
+#define MATERIAL_SURFACE_NAME "surface"
+
+namespace Engine
+{
+    struct TexturePackHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t texture_count;
+        uint32_t reserved;
+    };
+
+    // Raw 8-bit texels, rows bottom-up like `stbi_set_flip_vertically_on_load(true)`, tightly packed
+    struct TexturePackEntry {
+        char name[TEXTURE_PACK_NAME_LENGTH];  // Path relative to the cooked directory, `/` separated
+        uint32_t width;
+        uint32_t height;
+        uint32_t channel_count;
+        uint32_t mip_count;
+        uint64_t mip_offsets[TEXTURE_PACK_MAX_MIP_COUNT];  // From the start of the file
+        uint64_t mip_sizes[TEXTURE_PACK_MAX_MIP_COUNT];
+    };
+
+    static_assert(sizeof(TexturePackHeader) == 16, "Texture pack header layout");
+    static_assert(sizeof(TexturePackEntry) == TEXTURE_PACK_NAME_LENGTH + 16 + 16 * TEXTURE_PACK_MAX_MIP_COUNT, "Texture pack entry layout");
+}
@@ -1,8 +1,11 @@
+#pragma once
+
 #include "typedefs.h"
 
 #include <glad/glad.h>
 
 #include "logging.h"
+#include "profiler.h"
 
 namespace Engine
 {
@@ -13,4 +16,12 @@ namespace Engine
 
     GLuint load_texture(const char* path, GLint wrap_mode, GLint min_filter_mode, GLint mag_filter_mode, GLenum texture_format, GLint internal_format, TextureInfo& texture_info);
     GLuint load_texture(const char* path, GLint wrap_mode, GLint min_filter_mode, GLint mag_filter_mode, GLenum texture_format, GLint internal_format);
+
+    // Binds `texture` to texture unit `unit`, counted by the profiler
+    inline void bind_texture(GLuint unit, GLenum target, GLuint texture)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        PROFILE_COUNT(PROFILE_COUNTER_TEXTURE_BINDS, 1);
+    }
 }
\ No newline at end of file
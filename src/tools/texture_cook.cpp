@@ -0,0 +1,208 @@
+// Offline texture cooker: decodes every image under a directory, bakes its mip chain and writes one texture pack.
+// Usage: texture_cook.exe <input directory> <output file>
+
+#include "../typedefs.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include "../logging.h"
+#include "../texture_pack_format.h"
+
+namespace fs = std::filesystem;
+
+struct CookedTexture {
+    Engine::TexturePackEntry entry;
+    std::vector<std::vector<unsigned char>> mips;
+};
+
+// 2x2 box filter, odd edges reuse the last row/column
+static std::vector<unsigned char> downsample(const std::vector<unsigned char>& source, uint32_t width, uint32_t height, uint32_t channel_count)
+{
+    uint32_t target_width = std::max(width / 2, 1u);
+    uint32_t target_height = std::max(height / 2, 1u);
+    std::vector<unsigned char> target((size_t)target_width * target_height * channel_count);
+
+    for (uint32_t y = 0; y < target_height; y++) {
+        uint32_t y0 = std::min(y * 2, height - 1);
+        uint32_t y1 = std::min(y * 2 + 1, height - 1);
+        for (uint32_t x = 0; x < target_width; x++) {
+            uint32_t x0 = std::min(x * 2, width - 1);
+            uint32_t x1 = std::min(x * 2 + 1, width - 1);
+            for (uint32_t c = 0; c < channel_count; c++) {
+                uint32_t sum = source[((size_t)y0 * width + x0) * channel_count + c] + source[((size_t)y0 * width + x1) * channel_count + c] +
+                               source[((size_t)y1 * width + x0) * channel_count + c] + source[((size_t)y1 * width + x1) * channel_count + c];
+                target[((size_t)y * target_width + x) * channel_count + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+
+    return target;
+}
+
+static void build_mip_chain(CookedTexture& cooked)
+{
+    uint32_t mip_width = cooked.entry.width;
+    uint32_t mip_height = cooked.entry.height;
+    while ((mip_width > 1 || mip_height > 1) && cooked.mips.size() < TEXTURE_PACK_MAX_MIP_COUNT) {
+        cooked.mips.push_back(downsample(cooked.mips.back(), mip_width, mip_height, cooked.entry.channel_count));
+        mip_width = std::max(mip_width / 2, 1u);
+        mip_height = std::max(mip_height / 2, 1u);
+    }
+    cooked.entry.mip_count = (uint32_t)cooked.mips.size();
+}
+
+static bool cook_texture(const fs::path& path, const std::string& name, CookedTexture& cooked)
+{
+    if (name.size() >= TEXTURE_PACK_NAME_LENGTH) {
+        log_error("[COOK] Name `" + name + "` is longer than " + std::to_string(TEXTURE_PACK_NAME_LENGTH - 1) + " characters");
+        return false;
+    }
+
+    int width, height, channel_count;
+    unsigned char* data = stbi_load(path.string().c_str(), &width, &height, &channel_count, 0);
+    if (!data) {
+        log_error("[COOK] Could not decode `" + path.string() + "`: " + stbi_failure_reason());
+        return false;
+    }
+
+    memset(&cooked.entry, 0, sizeof(cooked.entry));
+    memcpy(cooked.entry.name, name.c_str(), name.size());
+    cooked.entry.width = (uint32_t)width;
+    cooked.entry.height = (uint32_t)height;
+    cooked.entry.channel_count = (uint32_t)channel_count;
+
+    cooked.mips.emplace_back(data, data + (size_t)width * height * channel_count);
+    stbi_image_free(data);
+    build_mip_chain(cooked);
+
+    log_info("[COOK] " + name + ": " + std::to_string(width) + "x" + std::to_string(height) + ", " + std::to_string(channel_count) + " channels, " + std::to_string(cooked.entry.mip_count) + " mips");
+    return true;
+}
+
+static const CookedTexture* find_cooked(const std::vector<CookedTexture>& textures, const std::string& name)
+{
+    for (const CookedTexture& cooked : textures) {
+        if (name == cooked.entry.name) return &cooked;
+    }
+    return nullptr;
+}
+
+// Material directories get an extra RGBA texture: normal.x, normal.y, ao, roughness. See `materials.h`
+static void cook_surface_textures(std::vector<CookedTexture>& textures)
+{
+    std::vector<CookedTexture> surfaces;
+    for (const CookedTexture& cooked : textures) {
+        std::string name = cooked.entry.name;
+        if (name.size() < strlen(MATERIAL_NORMAL_NAME) || name.compare(name.size() - strlen(MATERIAL_NORMAL_NAME), std::string::npos, MATERIAL_NORMAL_NAME) != 0) continue;
+
+        std::string directory = name.substr(0, name.size() - strlen(MATERIAL_NORMAL_NAME));
+        const CookedTexture* normal = &cooked;
+        const CookedTexture* ao = find_cooked(textures, directory + MATERIAL_AO_NAME);
+        const CookedTexture* roughness = find_cooked(textures, directory + MATERIAL_ROUGHNESS_NAME);
+        if (!ao || !roughness) continue;
+
+        if (ao->entry.width != normal->entry.width || ao->entry.height != normal->entry.height || roughness->entry.width != normal->entry.width || roughness->entry.height != normal->entry.height) {
+            log_warning("[COOK] Material `" + directory + "` has mismatched map sizes, not packing a surface texture");
+            continue;
+        }
+
+        CookedTexture surface;
+        surface.entry = normal->entry;
+        memset(surface.entry.name, 0, sizeof(surface.entry.name));
+        memcpy(surface.entry.name, (directory + MATERIAL_SURFACE_NAME).c_str(), directory.size() + strlen(MATERIAL_SURFACE_NAME));
+        surface.entry.channel_count = 4;
+
+        size_t texel_count = (size_t)normal->entry.width * normal->entry.height;
+        std::vector<unsigned char> texels(texel_count * 4);
+        for (size_t i = 0; i < texel_count; i++) {
+            texels[i * 4 + 0] = normal->mips[0][i * normal->entry.channel_count + 0];
+            texels[i * 4 + 1] = normal->mips[0][i * normal->entry.channel_count + std::min(1u, normal->entry.channel_count - 1)];
+            texels[i * 4 + 2] = ao->mips[0][i * ao->entry.channel_count];
+            texels[i * 4 + 3] = roughness->mips[0][i * roughness->entry.channel_count];
+        }
+        surface.mips.push_back(std::move(texels));
+        build_mip_chain(surface);
+
+        log_info("[COOK] " + std::string(surface.entry.name) + ": packed normal.xy, ao, roughness");
+        surfaces.push_back(std::move(surface));
+    }
+
+    for (CookedTexture& surface : surfaces) textures.push_back(std::move(surface));
+}
+
+static uint64_t align_offset(uint64_t offset)
+{
+    return (offset + TEXTURE_PACK_ALIGNMENT - 1) & ~(uint64_t)(TEXTURE_PACK_ALIGNMENT - 1);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3) {
+        log_error("Usage: texture_cook <input directory> <output file>");
+        return 1;
+    }
+
+    const fs::path input_directory = argv[1];
+    const char* output_path = argv[2];
+
+    // Same orientation the runtime loader uploads with
+    stbi_set_flip_vertically_on_load(true);
+
+    std::vector<fs::path> image_paths;
+    for (const fs::directory_entry& file : fs::recursive_directory_iterator(input_directory)) {
+        std::string extension = file.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+        if (file.is_regular_file() && (extension == ".jpg" || extension == ".jpeg" || extension == ".png" || extension == ".tga" || extension == ".bmp")) {
+            image_paths.push_back(file.path());
+        }
+    }
+    std::sort(image_paths.begin(), image_paths.end());  // Stable output for identical input
+
+    std::vector<CookedTexture> textures;
+    for (const fs::path& path : image_paths) {
+        CookedTexture cooked;
+        if (!cook_texture(path, fs::relative(path, input_directory).generic_string(), cooked)) return 1;
+        textures.push_back(std::move(cooked));
+    }
+
+    cook_surface_textures(textures);
+
+    // Lay out payloads after the entry table
+    uint64_t offset = align_offset(sizeof(Engine::TexturePackHeader) + textures.size() * sizeof(Engine::TexturePackEntry));
+    for (CookedTexture& cooked : textures) {
+        for (uint32_t mip = 0; mip < cooked.entry.mip_count; mip++) {
+            cooked.entry.mip_offsets[mip] = offset;
+            cooked.entry.mip_sizes[mip] = cooked.mips[mip].size();
+            offset = align_offset(offset + cooked.mips[mip].size());
+        }
+    }
+
+    std::ofstream output(output_path, std::ios::binary | std::ios::trunc);
+    if (!output) {
+        log_error("[COOK] Could not open `" + (std::string)output_path + "` for writing");
+        return 1;
+    }
+
+    Engine::TexturePackHeader header = { TEXTURE_PACK_MAGIC, TEXTURE_PACK_VERSION, (uint32_t)textures.size(), 0 };
+    output.write((const char*)&header, sizeof(header));
+    for (const CookedTexture& cooked : textures) output.write((const char*)&cooked.entry, sizeof(cooked.entry));
+
+    static const char padding[TEXTURE_PACK_ALIGNMENT] = {};
+    for (const CookedTexture& cooked : textures) {
+        for (uint32_t mip = 0; mip < cooked.entry.mip_count; mip++) {
+            output.write(padding, (std::streamsize)(cooked.entry.mip_offsets[mip] - (uint64_t)output.tellp()));
+            output.write((const char*)cooked.mips[mip].data(), (std::streamsize)cooked.mips[mip].size());
+        }
+    }
+
+    log_info("[COOK] Wrote " + std::to_string(textures.size()) + " textures (" + std::to_string((uint64_t)output.tellp()) + " bytes) to `" + output_path + "`");
+    return output.good() ? 0 : 1;
+}